@@ -155,9 +155,11 @@ if ! $skip_gnulib; then
       locale
       localename
       lock
+      md5
       memmove
       memset
       minmax
+      nproc
       obstack
       open
       openmp
@@ -186,6 +188,7 @@ if ! $skip_gnulib; then
       sys_stat
       sys_time
       term-styled-ostream
+      thread
       unilbrk/ulc-width-linebreaks
       uniname/uniname
       unistd
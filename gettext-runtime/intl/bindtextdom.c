@@ -182,6 +182,9 @@ set_binding_values (const char *domainname,
 		      free (binding->codeset);
 
 		      binding->codeset = result;
+#if defined _LIBC || HAVE_ICONV
+		      binding->encoding = _nl_intern_encoding (result);
+#endif
 		      modified = 1;
 		    }
 		}
@@ -271,6 +274,12 @@ set_binding_values (const char *domainname,
 	}
       else
 	new_binding->codeset = NULL;
+#if defined _LIBC || HAVE_ICONV
+      new_binding->encoding =
+	(new_binding->codeset != NULL
+	 ? _nl_intern_encoding (new_binding->codeset)
+	 : NULL);
+#endif
 
       /* Now enqueue it.  */
       if (_nl_domain_bindings == NULL
@@ -310,7 +319,10 @@ set_binding_values (const char *domainname,
 
   /* If we modified any binding, we flush the caches.  */
   if (modified)
-    ++_nl_msg_cat_cntr;
+    {
+      ++_nl_msg_cat_cntr;
+      _nl_reclaim_known_translations ();
+    }
 
   gl_rwlock_unlock (_nl_state_lock);
 }
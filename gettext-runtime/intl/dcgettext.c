@@ -49,6 +49,18 @@ DCGETTEXT (const char *domainname, const char *msgid, int category)
   return DCIGETTEXT (domainname, msgid, NULL, 0, 0, category);
 }
 
+#ifndef _LIBC
+/* Look up MSGID in the DOMAINNAME message catalog for the current CATEGORY
+   locale.  MSGID_HASH is the hash code of MSGID.  */
+char *
+libintl_dcgettext_hashed (const char *domainname, const char *msgid,
+			  unsigned long int msgid_hash, int category)
+{
+  return libintl_dcigettext_hashed (domainname, msgid, msgid_hash, NULL, 0, 0,
+				    category);
+}
+#endif
+
 #ifdef _LIBC
 /* Alias for function name in GNU C Library.  */
 INTDEF(__dcgettext)
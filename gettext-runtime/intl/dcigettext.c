@@ -67,6 +67,13 @@ extern int errno;
 # include <unistd.h>
 #endif
 
+#if HAVE_GETTIMEOFDAY && !defined _LIBC
+# include <sys/time.h>
+#endif
+#ifndef _LIBC
+# include <time.h>
+#endif
+
 #include <locale.h>
 
 #ifdef _LIBC
@@ -137,7 +144,6 @@ extern int errno;
 # ifndef stpcpy
 #  define stpcpy __stpcpy
 # endif
-# define tfind __tfind
 #else
 # if !defined HAVE_GETCWD
 char *getwd ();
@@ -157,22 +163,6 @@ static void *mempcpy (void *dest, const void *src, size_t n);
 # endif
 #endif
 
-/* Use a replacement if the system does not provide the `tsearch' function
-   family.  */
-#if HAVE_TSEARCH || defined _LIBC
-# include <search.h>
-#else
-# define tsearch libintl_tsearch
-# define tfind libintl_tfind
-# define tdelete libintl_tdelete
-# define twalk libintl_twalk
-# include "tsearch.h"
-#endif
-
-#ifdef _LIBC
-# define tsearch __tsearch
-#endif
-
 /* Amount to increase buffer size by in each try.  */
 #define PATH_INCR 32
 
@@ -232,10 +222,13 @@ static void *mempcpy (void *dest, const void *src, size_t n);
 # define HAVE_PER_THREAD_LOCALE
 #endif
 
-/* This is the type used for the search tree where known translations
+/* This is the type used for the table where known translations
    are stored.  */
 struct known_translation_t
 {
+  /* Hash code of the msgid.  */
+  unsigned long int hash;
+
   /* Domain in which to search.  */
   const char *domainname;
 
@@ -252,8 +245,9 @@ struct known_translation_t
   const char *encoding;
 #endif
 
-  /* State of the catalog counter at the point the string was found.  */
-  int counter;
+  /* State of the catalog counter at the point the string was found, or -1
+     while the entry is being updated.  */
+  int volatile counter;
 
   /* Catalog where the string was found.  */
   struct loaded_l10nfile *domain;
@@ -271,49 +265,388 @@ struct known_translation_t
   msgid;
 };
 
-gl_rwlock_define_initialized (static, tree_lock)
+/* The known translations are stored in an open hash table with linear
+   probing.  A slot, once filled, always points to the same entry.  The key
+   of an entry never changes.  When the catalogs have changed, an outdated
+   entry is updated in place: its counter is set to -1, then the other
+   fields are modified, and finally the counter is set to the current
+   value.  Therefore the memory used by the entries is bounded by the number
+   of different keys.  An entry whose counter is the current value is not
+   modified until the counter changes.
+   When the table becomes too full, it is replaced by a larger copy.  The
+   replaced table cannot be freed at once, because another thread may still
+   be searching it; it is freed the next time _nl_state_lock is taken for
+   writing, since all searches are done while holding _nl_state_lock.  */
+struct known_translations_table
+{
+  /* Number of slots.  A power of 2.  */
+  size_t size;
+  /* Number of non-empty slots.  */
+  size_t filled;
+  /* Next table in the list of replaced tables.  */
+  struct known_translations_table *retired;
+  /* The slots.  */
+  struct known_translation_t * volatile slots[ZERO];
+};
 
-/* Root of the search tree with known translations.  */
-static void *root;
+/* Initial number of slots.  */
+#define KNOWN_TRANSLATIONS_INITIAL_SIZE 256
+
+/* With GCC, readers search the table without taking a lock: a writer
+   stores a pointer to a new entry or table, or the counter of an updated
+   entry, with release semantics, and a reader loads it with acquire
+   semantics, so that a reader that sees the pointer or the counter also
+   sees the contents.  Older GCC versions lack these builtins; there a full
+   memory barrier before the store does the same, except on Alpha, where a
+   reader would need a barrier as well.  With other compilers, readers take
+   known_translations_lock for reading.  Writers always take it for
+   writing.
+   release_fence () orders the preceding stores before the following
+   stores, and acquire_fence () the preceding loads before the following
+   loads.  */
+#if defined __ATOMIC_ACQUIRE
+# define KNOWN_TRANSLATIONS_LOCKFREE 1
+# define load_acquire(p) __atomic_load_n (&(p), __ATOMIC_ACQUIRE)
+# define store_release(p, v) __atomic_store_n (&(p), (v), __ATOMIC_RELEASE)
+# define release_fence() __atomic_thread_fence (__ATOMIC_RELEASE)
+# define acquire_fence() __atomic_thread_fence (__ATOMIC_ACQUIRE)
+#elif (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)) \
+      && !defined __alpha__
+# define KNOWN_TRANSLATIONS_LOCKFREE 1
+# define load_acquire(p) (p)
+# define store_release(p, v) (__sync_synchronize (), (p) = (v))
+# define release_fence() __sync_synchronize ()
+# define acquire_fence() __sync_synchronize ()
+#else
+# define KNOWN_TRANSLATIONS_LOCKFREE 0
+# define load_acquire(p) (p)
+# define store_release(p, v) ((p) = (v))
+# define release_fence() ((void) 0)
+# define acquire_fence() ((void) 0)
+#endif
 
-/* Function to compare two entries in the table of known translations.  */
-static int
-transcmp (const void *p1, const void *p2)
+/* Tell the CPU that the memory at ADDR will soon be read.  */
+#if __GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 1)
+# define PREFETCH(addr) __builtin_prefetch ((const void *) (addr))
+#else
+# define PREFETCH(addr) ((void) 0)
+#endif
+
+#ifdef HAVE_PER_THREAD_LOCALE
+
+gl_rwlock_define_initialized (static, known_translations_lock)
+
+/* The table of known translations.  */
+static struct known_translations_table * volatile known_translations;
+
+/* List of replaced tables.  Protected by known_translations_lock.  */
+static struct known_translations_table *retired_tables;
+
+/* Return nonzero if the entries S1 and S2 have the same key.  */
+static inline int
+transequal (const struct known_translation_t *s1,
+	    const struct known_translation_t *s2)
 {
-  const struct known_translation_t *s1;
-  const struct known_translation_t *s2;
-  int result;
+  /* We compare the category first, since it is the cheapest operation,
+     and the msgid next, since it is the most likely to differ.  */
+  return (s1->hash == s2->hash
+	  && s1->category == s2->category
+	  && strcmp (s1->domain != NULL ? s1->msgid.appended : s1->msgid.ptr,
+		     s2->domain != NULL ? s2->msgid.appended : s2->msgid.ptr)
+	     == 0
+	  && strcmp (s1->domainname, s2->domainname) == 0
+	  && strcmp (s1->localename, s2->localename) == 0
+#ifdef IN_LIBGLOCALE
+	  && strcmp (s1->encoding, s2->encoding) == 0
+#endif
+	  );
+}
 
-  s1 = (const struct known_translation_t *) p1;
-  s2 = (const struct known_translation_t *) p2;
+/* Look up the entry with the same key as SEARCH in the table of known
+   translations.  Return NULL if there is none or if it is outdated.
+   The caller must hold _nl_state_lock.  */
+static struct known_translation_t *
+known_translations_find (const struct known_translation_t *search)
+{
+  struct known_translations_table *table;
+  struct known_translation_t *found;
 
-  result = strcmp (s1->domain != NULL ? s1->msgid.appended : s1->msgid.ptr,
-		   s2->domain != NULL ? s2->msgid.appended : s2->msgid.ptr);
-  if (result == 0)
+  found = NULL;
+#if !KNOWN_TRANSLATIONS_LOCKFREE
+  gl_rwlock_rdlock (known_translations_lock);
+#endif
+  table = load_acquire (known_translations);
+  if (table != NULL)
     {
-      result = strcmp (s1->domainname, s2->domainname);
-      if (result == 0)
+      size_t mask = table->size - 1;
+      size_t idx;
+
+      for (idx = search->hash & mask; ; idx = (idx + 1) & mask)
 	{
-#ifdef HAVE_PER_THREAD_LOCALE
-	  result = strcmp (s1->localename, s2->localename);
-	  if (result == 0)
+	  struct known_translation_t *entry = load_acquire (table->slots[idx]);
+
+	  if (entry == NULL)
+	    break;
+	  if (transequal (entry, search))
+	    {
+	      /* The counter cannot change while the caller holds
+		 _nl_state_lock, unless the entry is outdated.  */
+	      if (load_acquire (entry->counter) == _nl_msg_cat_cntr)
+		found = entry;
+	      break;
+	    }
+	}
+    }
+#if !KNOWN_TRANSLATIONS_LOCKFREE
+  gl_rwlock_unlock (known_translations_lock);
+#endif
+
+  return found;
+}
+
+#if KNOWN_TRANSLATIONS_LOCKFREE
+/* Fetch the slot where a search for the hash code HASH starts into the
+   CPU cache.  */
+static inline void
+known_translations_prefetch (unsigned long int hash)
+{
+  struct known_translations_table *table = load_acquire (known_translations);
+
+  if (table != NULL)
+    PREFETCH (&table->slots[hash & (table->size - 1)]);
+}
 #endif
+
+/* Store the entry NEWP, whose key is not yet in the table of known
+   translations, in the table.  The caller holds known_translations_lock
+   for writing.  Return 0 if memory is exhausted.  */
+static int
+known_translations_add (struct known_translation_t *newp)
+{
+  struct known_translations_table *table = known_translations;
+  size_t mask;
+  size_t idx;
+
+  /* Keep the table at most 3/4 full, so that probe sequences stay short.  */
+  if (table == NULL || 4 * (table->filled + 1) > 3 * table->size)
+    {
+      size_t new_size =
+	(table != NULL ? 2 * table->size : KNOWN_TRANSLATIONS_INITIAL_SIZE);
+      struct known_translations_table *new_table =
+	(struct known_translations_table *)
+	calloc (1, offsetof (struct known_translations_table, slots)
+		   + new_size * sizeof (struct known_translation_t *));
+
+      if (new_table == NULL)
+	return 0;
+      new_table->size = new_size;
+
+      if (table != NULL)
+	{
+	  size_t new_mask = new_size - 1;
+	  size_t i;
+
+	  for (i = 0; i < table->size; i++)
 	    {
+	      struct known_translation_t *entry = table->slots[i];
+
+	      if (entry != NULL)
+		{
+		  for (idx = entry->hash & new_mask;
+		       new_table->slots[idx] != NULL;
+		       idx = (idx + 1) & new_mask)
+		    ;
+		  new_table->slots[idx] = entry;
+		}
+	    }
+	  new_table->filled = table->filled;
+
+	  table->retired = retired_tables;
+	  retired_tables = table;
+	}
+
+      store_release (known_translations, new_table);
+      table = new_table;
+    }
+
+  mask = table->size - 1;
+  for (idx = newp->hash & mask;
+       table->slots[idx] != NULL;
+       idx = (idx + 1) & mask)
+    ;
+  table->filled++;
+  store_release (table->slots[idx], newp);
+  return 1;
+}
+
+/* Record the translation of MSGID1, which was found in DOMAIN: starting at
+   TRANSLATION, TRANSLATION_LENGTH bytes, in the table of known
+   translations.  An outdated entry with the same key is updated; otherwise
+   a new entry is created.  Return the entry, or NULL if memory is
+   exhausted.  The caller holds _nl_state_lock for reading.  */
+static struct known_translation_t *
+#ifdef IN_LIBGLOCALE
+remember_translation (const char *msgid1, unsigned long int msgid_hash,
+		      const char *domainname, size_t domainname_len,
+		      int category, const char *localename,
+		      const char *encoding,
+		      struct loaded_l10nfile *domain,
+		      const char *translation, size_t translation_length)
+#else
+remember_translation (const char *msgid1, unsigned long int msgid_hash,
+		      const char *domainname, size_t domainname_len,
+		      int category, const char *localename,
+		      struct loaded_l10nfile *domain,
+		      const char *translation, size_t translation_length)
+#endif
+{
+  struct known_translation_t search;
+  struct known_translation_t *entry;
+  struct known_translations_table *table;
+
+  search.domainname = domainname;
+  search.category = category;
+  search.hash = msgid_hash;
+  search.localename = localename;
+#ifdef IN_LIBGLOCALE
+  search.encoding = encoding;
+#endif
+  search.domain = NULL;
+  search.msgid.ptr = msgid1;
+
+  gl_rwlock_wrlock (known_translations_lock);
+
+  entry = NULL;
+  table = known_translations;
+  if (table != NULL)
+    {
+      size_t mask = table->size - 1;
+      size_t idx;
+
+      for (idx = msgid_hash & mask;
+	   table->slots[idx] != NULL;
+	   idx = (idx + 1) & mask)
+	if (transequal (table->slots[idx], &search))
+	  {
+	    entry = table->slots[idx];
+	    break;
+	  }
+    }
+
+  if (entry != NULL)
+    {
+      /* Another thread may have updated the entry already.  Otherwise it
+	 is outdated, and no reader uses its contents.  */
+      if (entry->counter != _nl_msg_cat_cntr)
+	{
+	  entry->counter = -1;
+	  release_fence ();
+	  entry->domain = domain;
+	  entry->translation = translation;
+	  entry->translation_length = translation_length;
+	  store_release (entry->counter, _nl_msg_cat_cntr);
+	}
+    }
+  else
+    {
+      size_t msgid_len = strlen (msgid1) + 1;
+      size_t size = offsetof (struct known_translation_t, msgid)
+		    + msgid_len + domainname_len + 1 + strlen (localename) + 1;
+
+      entry = (struct known_translation_t *) malloc (size);
+      if (entry != NULL)
+	{
+	  char *new_domainname;
+	  char *new_localename;
+
+	  new_domainname =
+	    (char *) mempcpy (entry->msgid.appended, msgid1, msgid_len);
+	  memcpy (new_domainname, domainname, domainname_len + 1);
+	  new_localename = new_domainname + domainname_len + 1;
+	  strcpy (new_localename, localename);
+	  entry->hash = msgid_hash;
+	  entry->domainname = new_domainname;
+	  entry->category = category;
+	  entry->localename = new_localename;
 #ifdef IN_LIBGLOCALE
-	      result = strcmp (s1->encoding, s2->encoding);
-	      if (result == 0)
+	  entry->encoding = encoding;
 #endif
-		/* We compare the category last (though this is the cheapest
-		   operation) since it is hopefully always the same (namely
-		   LC_MESSAGES).  */
-		result = s1->category - s2->category;
+	  entry->counter = _nl_msg_cat_cntr;
+	  entry->domain = domain;
+	  entry->translation = translation;
+	  entry->translation_length = translation_length;
+
+	  if (!known_translations_add (entry))
+	    {
+	      /* The insert failed.  */
+	      free (entry);
+	      entry = NULL;
 	    }
 	}
     }
 
-  return result;
+  gl_rwlock_unlock (known_translations_lock);
+  return entry;
+}
+
+#endif
+
+/* Free the tables of known translations that have been replaced.  The
+   caller holds _nl_state_lock for writing, so that no other thread is
+   searching them.  */
+void
+_nl_reclaim_known_translations (void)
+{
+#ifdef HAVE_PER_THREAD_LOCALE
+  gl_rwlock_wrlock (known_translations_lock);
+  while (retired_tables != NULL)
+    {
+      struct known_translations_table *table = retired_tables;
+      retired_tables = table->retired;
+      free (table);
+    }
+  gl_rwlock_unlock (known_translations_lock);
+#endif
 }
 
+/* Whether to keep a small cache of recent lookups in each thread.  It sits
+   in front of the table of known translations and is consulted before any
+   lock is taken.  */
+#if defined HAVE_PER_THREAD_LOCALE && !defined IN_LIBGLOCALE \
+    && !defined _LIBC && HAVE_THREAD_LOCAL_STORAGE \
+    && KNOWN_TRANSLATIONS_LOCKFREE
+# define USE_THREAD_CACHE 1
+#else
+# define USE_THREAD_CACHE 0
+#endif
+
+#if USE_THREAD_CACHE
+
+/* Number of entries in the cache of each thread.  A power of 2.  */
+# define THREAD_CACHE_SIZE 128
+
+/* An entry of the cache.  The key consists of the arguments MSGID1,
+   DOMAINNAME and CATEGORY of the lookup, compared as pointers.  ENTRY is
+   an entry of the table of known translations; such entries are never
+   freed, but they are updated when they are outdated.  */
+struct thread_cache_entry
+{
+  const char *msgid;
+  const char *domainname;
+  int category;
+  const struct known_translation_t *entry;
+};
+
+static __thread struct thread_cache_entry thread_cache[THREAD_CACHE_SIZE];
+
+/* Return the cache entry of the current thread for MSGID1 and CATEGORY.  */
+# define THREAD_CACHE_SLOT(msgid1, category) \
+  (&thread_cache[(((size_t) (msgid1) >> 3) ^ ((size_t) (msgid1) >> 11)	      \
+		  ^ (size_t) (category))					      \
+		 & (THREAD_CACHE_SIZE - 1)])
+
+#endif
+
 /* Name of the default domain used for gettext(3) prior any call to
    textdomain(3).  The default value for this is "messages".  */
 const char _nl_default_default_domain[] attribute_hidden = "messages";
@@ -345,6 +678,19 @@ struct binding *_nl_domain_bindings;
 #endif
 
 /* Prototypes for local functions.  */
+#ifdef IN_LIBGLOCALE
+static char *find_msg (struct loaded_l10nfile *domain_file,
+		       struct binding *domainbinding, const char *encoding,
+		       const char *msgid, unsigned long int msgid_hash,
+		       size_t *lengthp)
+     internal_function;
+#else
+static char *find_msg (struct loaded_l10nfile *domain_file,
+		       struct binding *domainbinding,
+		       const char *msgid, unsigned long int msgid_hash,
+		       int convert, size_t *lengthp)
+     internal_function;
+#endif
 static char *plural_lookup (struct loaded_l10nfile *domain,
 			    unsigned long int n,
 			    const char *translation, size_t translation_len)
@@ -372,6 +718,13 @@ static const char *category_to_name (int category) internal_function;
 static const char *get_output_charset (struct binding *domainbinding)
      internal_function;
 #endif
+#ifndef _LIBC
+/* In log.c.  */
+extern void _nl_log_untranslated (const char *logfilename,
+				  const char *domainname,
+				  const char *msgid1, const char *msgid2,
+				  int plural);
+#endif
 
 
 /* For those loosing systems which don't have `alloca' we have to add
@@ -472,20 +825,177 @@ static int enable_secure;
 /* Get the function to evaluate the plural expression.  */
 #include "eval-plural.h"
 
+#if !defined IN_LIBGLOCALE && !defined _LIBC
+
+/* Lock that serializes the reloading of message catalogs.  */
+__libc_lock_define_initialized (static, reload_lock)
+
+/* Load again the message catalogs whose files have been replaced or
+   modified since they were loaded, and those that have appeared since they
+   were found missing.  The old contents of a reloaded catalog are not
+   freed, because the translations returned from it may still be in use.  */
+int
+libintl_reload_textdomains (void)
+{
+  struct loaded_l10nfile **files;
+  struct loaded_domain **new_data;
+  size_t nfiles;
+  size_t i;
+  int saved_errno = errno;
+  int count = 0;
+
+  __libc_lock_lock (reload_lock);
+
+  files = _nl_loaded_domain_files (&nfiles);
+  if (files != NULL)
+    {
+      new_data = (struct loaded_domain **)
+		 malloc ((nfiles > 0 ? nfiles : 1)
+			 * sizeof (struct loaded_domain *));
+      if (new_data != NULL)
+	{
+	  /* Load the new files without holding _nl_state_lock, so that
+	     lookups can go on meanwhile.  */
+	  for (i = 0; i < nfiles; i++)
+	    {
+	      new_data[i] = _nl_reload_domain (files[i]);
+	      if (new_data[i] != NULL)
+		count++;
+	    }
+
+	  if (count > 0)
+	    {
+	      /* Lookups that search the catalogs hold _nl_state_lock for
+		 reading.  Those that use the table of known translations or
+		 the cache of a thread see that the counter has changed and
+		 search the catalogs again; until then, plural_lookup may
+		 already see the new data.  */
+	      gl_rwlock_wrlock (_nl_state_lock);
+	      for (i = 0; i < nfiles; i++)
+		if (new_data[i] != NULL)
+		  store_release (files[i]->data, new_data[i]);
+	      ++_nl_msg_cat_cntr;
+	      _nl_reclaim_known_translations ();
+	      gl_rwlock_unlock (_nl_state_lock);
+	    }
+
+	  free (new_data);
+	}
+      free (files);
+    }
+
+  __libc_lock_unlock (reload_lock);
+
+  __set_errno (saved_errno);
+  return count;
+}
+
+/* The interval, in seconds, between two automatic checks for modified
+   message catalogs, or 0 if there are no automatic checks.  Set from the
+   environment variable GETTEXT_RELOAD_INTERVAL; -1 until then.  */
+static int reload_interval = -1;
+
+/* The time of the last automatic check.  */
+static time_t volatile last_reload_time;
+
+/* Check for modified message catalogs if the interval has elapsed.  */
+static void
+reload_textdomains_periodically (void)
+{
+  time_t now;
+
+  if (reload_interval < 0)
+    {
+      /* Like OUTPUT_CHARSET, this user variable is looked at only once.  */
+      const char *value = getenv ("GETTEXT_RELOAD_INTERVAL");
+      int interval = (value != NULL ? atoi (value) : 0);
+
+      last_reload_time = time (NULL);
+      reload_interval = (interval > 0 ? interval : 0);
+      return;
+    }
+
+  now = time (NULL);
+  if (now - last_reload_time >= reload_interval)
+    {
+      last_reload_time = now;
+      libintl_reload_textdomains ();
+    }
+}
+
+#endif
+
+#if !defined IN_LIBGLOCALE && !defined _LIBC
+
+/* Nonzero if lookups are counted; -1 until determined.  */
+static int statistics_level = -1;
+
+/* The number of translations that the current thread has converted to
+   another character set, for the statistics.  */
+# if HAVE_THREAD_LOCAL_STORAGE
+static __thread unsigned long int conversions_done;
+# else
+static unsigned long int conversions_done;
+# endif
+
+/* Return nonzero if lookups are counted, as requested through the
+   environment variable GETTEXT_STATISTICS.  */
+static int
+statistics_enabled (void)
+{
+  if (statistics_level < 0)
+    {
+      const char *filename = getenv ("GETTEXT_STATISTICS");
+      int level = 0;
+
+      /* Like GETTEXT_LOG_UNTRANSLATED, this is ignored in SUID binaries.  */
+      DETERMINE_SECURE;
+      if (filename != NULL && filename[0] != '\0' && !ENABLE_SECURE)
+	{
+	  const char *per_msgid = getenv ("GETTEXT_STATISTICS_MSGIDS");
+
+	  level = _nl_statistics_init (filename,
+				       per_msgid != NULL
+				       && per_msgid[0] != '\0');
+	}
+      statistics_level = level;
+    }
+  return statistics_level;
+}
+
+# define RECORD_LOOKUP(domainname, msgid, msgid_hash, outcome, \
+		       catalog_misses, conversions) \
+  do								      \
+    if (__builtin_expect (statistics_level != 0, 0)		      \
+	&& statistics_enabled ())					      \
+      _nl_statistics_record (domainname, msgid, msgid_hash, outcome,   \
+			     catalog_misses, conversions);		      \
+  while (0)
+#else
+# define RECORD_LOOKUP(domainname, msgid, msgid_hash, outcome, \
+		       catalog_misses, conversions) \
+  ((void) (catalog_misses))
+#endif
+
 /* Look up MSGID in the DOMAINNAME message catalog for the current
    CATEGORY locale and, if PLURAL is nonzero, search over string
-   depending on the plural form determined by N.  */
+   depending on the plural form determined by N.  If HASHED is nonzero,
+   MSGID_HASH is the value of __hash_string (MSGID1).  */
 #ifdef IN_LIBGLOCALE
-char *
-gl_dcigettext (const char *domainname,
-	       const char *msgid1, const char *msgid2,
-	       int plural, unsigned long int n,
-	       int category,
-	       const char *localename, const char *encoding)
+static char *
+dcigettext_internal (const char *domainname,
+		     const char *msgid1, const char *msgid2,
+		     int plural, unsigned long int n,
+		     int category,
+		     const char *localename, const char *encoding,
+		     int hashed, unsigned long int msgid_hash)
 #else
-char *
-DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
-	    int plural, unsigned long int n, int category)
+static char *
+dcigettext_internal (const char *domainname,
+		     const char *msgid1, const char *msgid2,
+		     int plural, unsigned long int n,
+		     int category,
+		     int hashed, unsigned long int msgid_hash)
 #endif
 {
 #ifndef HAVE_ALLOCA
@@ -502,11 +1012,18 @@ DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
   size_t retlen;
   int saved_errno;
   struct known_translation_t search;
-  struct known_translation_t **foundp = NULL;
 #if defined HAVE_PER_THREAD_LOCALE && !defined IN_LIBGLOCALE
   const char *localename;
+#endif
+#if USE_THREAD_CACHE
+  struct thread_cache_entry *tce;
+  const char *requested_domainname = domainname;
 #endif
   size_t domainname_len;
+  unsigned int catalog_misses = 0;
+#if !defined IN_LIBGLOCALE && !defined _LIBC
+  unsigned long int conversions_before = conversions_done;
+#endif
 
   /* If no real MSGID is given return NULL.  */
   if (msgid1 == NULL)
@@ -524,6 +1041,67 @@ DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
   /* Preserve the `errno' value.  */
   saved_errno = errno;
 
+#if !defined IN_LIBGLOCALE && !defined _LIBC
+  if (__builtin_expect (reload_interval != 0, 0))
+    reload_textdomains_periodically ();
+#endif
+
+#if USE_THREAD_CACHE
+  /* Try the cache of the current thread first.  A hit needs no lock.
+     The cached entry is outdated if the catalogs, the default domain or
+     the bindings have changed since it was made, or if the locale of the
+     thread is a different one.  The caller may have reused the memory of
+     MSGID1 or DOMAINNAME for a different string, therefore the strings
+     are compared as well, against the entry, whose data is likely in the
+     cache of the CPU.  */
+  tce = THREAD_CACHE_SLOT (msgid1, category);
+  if (tce->msgid == msgid1 && tce->domainname == domainname
+      && tce->category == category)
+    {
+      const struct known_translation_t *entry = tce->entry;
+      int counter = load_acquire (entry->counter);
+      struct loaded_l10nfile *entry_domain = entry->domain;
+      const char *translation = entry->translation;
+      size_t translation_length = entry->translation_length;
+
+      /* Another thread may be updating the entry, if the catalogs have
+	 just changed.  The values read are consistent only if the counter
+	 has stayed the same.  */
+      acquire_fence ();
+      if (counter == _nl_msg_cat_cntr && entry->counter == counter)
+	{
+	  localename =
+	    _nl_locale_name_thread_unsafe (entry->category,
+					   category_to_name (entry->category));
+	  if (localename == NULL)
+	    localename = "";
+	  if (strcmp (msgid1, entry->msgid.appended) == 0
+	      && (domainname == NULL
+		  || strcmp (domainname, entry->domainname) == 0)
+	      && strcmp (localename, entry->localename) == 0)
+	    {
+	      RECORD_LOOKUP (entry->domainname, msgid1, entry->hash,
+			     STATISTICS_CACHE_HIT, 0, 0);
+
+	      /* Now deal with plural.  */
+	      if (plural)
+		retval = plural_lookup (entry_domain, n, translation,
+					translation_length);
+	      else
+		retval = (char *) translation;
+
+	      __set_errno (saved_errno);
+	      return retval;
+	    }
+	}
+    }
+#endif
+
+  /* The hash code is needed for the table of known translations and for
+     the hash tables of the catalogs.  */
+  if (!hashed)
+    msgid_hash = __hash_string (msgid1);
+
 #ifdef _LIBC
   __libc_rwlock_define (extern, __libc_setlocale_lock attribute_hidden)
   __libc_rwlock_rdlock (__libc_setlocale_lock);
@@ -550,6 +1128,7 @@ DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
   search.domainname = domainname;
   search.category = category;
 #ifdef HAVE_PER_THREAD_LOCALE
+  search.hash = msgid_hash;
 # ifndef IN_LIBGLOCALE
 #  ifdef _LIBC
   localename = _strdupa (_current_locale_name (category));
@@ -566,30 +1145,36 @@ DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
   search.encoding = encoding;
 # endif
 
-  /* Since tfind/tsearch manage a balanced tree, concurrent tfind and
-     tsearch calls can be fatal.  */
-  gl_rwlock_rdlock (tree_lock);
-
-  foundp = (struct known_translation_t **) tfind (&search, &root, transcmp);
+  {
+    struct known_translation_t *found = known_translations_find (&search);
+
+    if (found != NULL)
+      {
+# if USE_THREAD_CACHE
+	tce->msgid = msgid1;
+	tce->domainname = requested_domainname;
+	tce->category = category;
+	tce->entry = found;
+# endif
 
-  gl_rwlock_unlock (tree_lock);
+	RECORD_LOOKUP (domainname, msgid1, msgid_hash,
+		       STATISTICS_CACHE_HIT, 0, 0);
 
-  if (foundp != NULL && (*foundp)->counter == _nl_msg_cat_cntr)
-    {
-      /* Now deal with plural.  */
-      if (plural)
-	retval = plural_lookup ((*foundp)->domain, n, (*foundp)->translation,
-				(*foundp)->translation_length);
-      else
-	retval = (char *) (*foundp)->translation;
+	/* Now deal with plural.  */
+	if (plural)
+	  retval = plural_lookup (found->domain, n, found->translation,
+				  found->translation_length);
+	else
+	  retval = (char *) found->translation;
 
-      gl_rwlock_unlock (_nl_state_lock);
+	gl_rwlock_unlock (_nl_state_lock);
 # ifdef _LIBC
-      __libc_rwlock_unlock (__libc_setlocale_lock);
+	__libc_rwlock_unlock (__libc_setlocale_lock);
 # endif
-      __set_errno (saved_errno);
-      return retval;
-    }
+	__set_errno (saved_errno);
+	return retval;
+      }
+  }
 #endif
 
   /* See whether this is a SUID binary or not.  */
@@ -630,247 +1215,1125 @@ DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
 	  char *resolved_dirname;
 	  char *ret;
 
-	  path_max = (unsigned int) PATH_MAX;
-	  path_max += 2;		/* The getcwd docs say to do this.  */
+	  path_max = (unsigned int) PATH_MAX;
+	  path_max += 2;		/* The getcwd docs say to do this.  */
+
+	  for (;;)
+	    {
+	      resolved_dirname = (char *) alloca (path_max + dirname_len);
+	      ADD_BLOCK (block_list, tmp_dirname);
+
+	      __set_errno (0);
+	      ret = getcwd (resolved_dirname, path_max);
+	      if (ret != NULL || errno != ERANGE)
+		break;
+
+	      path_max += path_max / 2;
+	      path_max += PATH_INCR;
+	    }
+
+	  if (ret == NULL)
+	    /* We cannot get the current working directory.  Don't signal an
+	       error but simply return the default string.  */
+	    goto return_untranslated;
+
+	  stpcpy (stpcpy (strchr (resolved_dirname, '\0'), "/"), dirname);
+	  dirname = resolved_dirname;
+	}
+#ifndef IN_LIBGLOCALE
+    }
+#endif
+
+  /* Now determine the symbolic name of CATEGORY and its value.  */
+#ifndef CATEGORYNAME_INITIALIZED
+  categoryname = category_to_name (category);
+#endif
+#ifdef IN_LIBGLOCALE
+  categoryvalue = guess_category_value (category, categoryname, localename);
+#else
+  categoryvalue = guess_category_value (category, categoryname);
+#endif
+
+  domainname_len = strlen (domainname);
+  xdomainname = (char *) alloca (strlen (categoryname)
+				 + domainname_len + 5);
+  ADD_BLOCK (block_list, xdomainname);
+
+  stpcpy ((char *) mempcpy (stpcpy (stpcpy (xdomainname, categoryname), "/"),
+			    domainname, domainname_len),
+	  ".mo");
+
+  /* Creating working area.  */
+  single_locale = (char *) alloca (strlen (categoryvalue) + 1);
+  ADD_BLOCK (block_list, single_locale);
+
+
+  /* Search for the given string.  This is a loop because we perhaps
+     got an ordered list of languages to consider for the translation.  */
+  while (1)
+    {
+      /* Make CATEGORYVALUE point to the next element of the list.  */
+      while (categoryvalue[0] != '\0' && categoryvalue[0] == ':')
+	++categoryvalue;
+      if (categoryvalue[0] == '\0')
+	{
+	  /* The whole contents of CATEGORYVALUE has been searched but
+	     no valid entry has been found.  We solve this situation
+	     by implicitly appending a "C" entry, i.e. no translation
+	     will take place.  */
+	  single_locale[0] = 'C';
+	  single_locale[1] = '\0';
+	}
+      else
+	{
+	  char *cp = single_locale;
+	  while (categoryvalue[0] != '\0' && categoryvalue[0] != ':')
+	    *cp++ = *categoryvalue++;
+	  *cp = '\0';
+
+	  /* When this is a SUID binary we must not allow accessing files
+	     outside the dedicated directories.  */
+	  if (ENABLE_SECURE && IS_PATH_WITH_DIR (single_locale))
+	    /* Ingore this entry.  */
+	    continue;
+	}
+
+      /* If the current locale value is C (or POSIX) we don't load a
+	 domain.  Return the MSGID.  */
+      if (strcmp (single_locale, "C") == 0
+	  || strcmp (single_locale, "POSIX") == 0)
+	break;
+
+      /* Find structure describing the message catalog matching the
+	 DOMAINNAME and CATEGORY.  */
+      domain = _nl_find_domain (dirname, single_locale, xdomainname, binding);
+
+      if (domain != NULL)
+	{
+#if defined IN_LIBGLOCALE
+	  retval = find_msg (domain, binding, encoding, msgid1, msgid_hash,
+			     &retlen);
+#else
+	  retval = find_msg (domain, binding, msgid1, msgid_hash, 1, &retlen);
+#endif
+
+	  if (retval == NULL)
+	    {
+	      int cnt;
+
+	      catalog_misses++;
+	      for (cnt = 0; domain->successor[cnt] != NULL; ++cnt)
+		{
+#if defined IN_LIBGLOCALE
+		  retval = find_msg (domain->successor[cnt], binding,
+				     encoding, msgid1, msgid_hash, &retlen);
+#else
+		  retval = find_msg (domain->successor[cnt], binding,
+				     msgid1, msgid_hash, 1, &retlen);
+#endif
+
+		  if (retval != NULL)
+		    {
+		      domain = domain->successor[cnt];
+		      break;
+		    }
+		  catalog_misses++;
+		}
+	    }
+
+	  /* Returning -1 means that some resource problem exists
+	     (likely memory) and that the strings could not be
+	     converted.  Return the original strings.  */
+	  if (__builtin_expect (retval == (char *) -1, 0))
+	    break;
+
+	  if (retval != NULL)
+	    {
+	      /* Found the translation of MSGID1 in domain DOMAIN:
+		 starting at RETVAL, RETLEN bytes.  */
+	      FREE_BLOCKS (block_list);
+#ifdef HAVE_PER_THREAD_LOCALE
+	      {
+		struct known_translation_t *newp =
+# ifdef IN_LIBGLOCALE
+		  remember_translation (msgid1, search.hash,
+					domainname, domainname_len, category,
+					localename, encoding,
+					domain, retval, retlen);
+# else
+		  remember_translation (msgid1, search.hash,
+					domainname, domainname_len, category,
+					localename,
+					domain, retval, retlen);
+# endif
+
+# if USE_THREAD_CACHE
+		if (newp != NULL)
+		  {
+		    tce->msgid = msgid1;
+		    tce->domainname = requested_domainname;
+		    tce->category = category;
+		    tce->entry = newp;
+		  }
+# else
+		(void) newp;
+# endif
+	      }
+#endif
+
+	      RECORD_LOOKUP (domainname, msgid1, msgid_hash,
+			     STATISTICS_TRANSLATED, catalog_misses,
+			     conversions_done - conversions_before);
+
+	      __set_errno (saved_errno);
+
+	      /* Now deal with plural.  */
+	      if (plural)
+		retval = plural_lookup (domain, n, retval, retlen);
+
+	      gl_rwlock_unlock (_nl_state_lock);
+#ifdef _LIBC
+	      __libc_rwlock_unlock (__libc_setlocale_lock);
+#endif
+	      return retval;
+	    }
+	}
+    }
+
+ return_untranslated:
+  /* Return the untranslated MSGID.  */
+  FREE_BLOCKS (block_list);
+  RECORD_LOOKUP (domainname, msgid1, msgid_hash, STATISTICS_UNTRANSLATED,
+		 catalog_misses, conversions_done - conversions_before);
+  gl_rwlock_unlock (_nl_state_lock);
+#ifdef _LIBC
+  __libc_rwlock_unlock (__libc_setlocale_lock);
+#endif
+#ifndef _LIBC
+  if (!ENABLE_SECURE)
+    {
+      const char *logfilename = getenv ("GETTEXT_LOG_UNTRANSLATED");
+
+      if (logfilename != NULL && logfilename[0] != '\0')
+	_nl_log_untranslated (logfilename, domainname, msgid1, msgid2, plural);
+    }
+#endif
+  __set_errno (saved_errno);
+  return (plural == 0
+	  ? (char *) msgid1
+	  /* Use the Germanic plural rule.  */
+	  : n == 1 ? (char *) msgid1 : (char *) msgid2);
+}
+
+#ifdef IN_LIBGLOCALE
+char *
+gl_dcigettext (const char *domainname,
+	       const char *msgid1, const char *msgid2,
+	       int plural, unsigned long int n,
+	       int category,
+	       const char *localename, const char *encoding)
+{
+  return dcigettext_internal (domainname, msgid1, msgid2, plural, n, category,
+			      localename, encoding, 0, 0);
+}
+#else
+char *
+DCIGETTEXT (const char *domainname, const char *msgid1, const char *msgid2,
+	    int plural, unsigned long int n, int category)
+{
+  return dcigettext_internal (domainname, msgid1, msgid2, plural, n, category,
+			      0, 0);
+}
+
+# ifndef _LIBC
+/* Like DCIGETTEXT, except that the caller passes the hash code of MSGID1,
+   as computed by __hash_string.  */
+char *
+libintl_dcigettext_hashed (const char *domainname,
+			   const char *msgid1, unsigned long int msgid1_hash,
+			   const char *msgid2,
+			   int plural, unsigned long int n, int category)
+{
+  return dcigettext_internal (domainname, msgid1, msgid2, plural, n, category,
+			      1, msgid1_hash);
+}
+
+/* Return the binding of DOMAINNAME, or NULL if there is none.  */
+static struct binding *
+find_binding (const char *domainname)
+{
+  struct binding *binding;
+
+  for (binding = _nl_domain_bindings; binding != NULL; binding = binding->next)
+    {
+      int compare = strcmp (domainname, binding->domainname);
+      if (compare == 0)
+	return binding;
+      if (compare < 0)
+	break;
+    }
+  return NULL;
+}
+
+/* Return DIRNAME, prefixed with the current directory if it is relative,
+   in freshly allocated memory.  Return NULL upon failure.  */
+static char *
+absolute_dirname (const char *dirname)
+{
+  size_t dirname_len = strlen (dirname) + 1;
+  size_t path_max;
+  char *resolved_dirname;
+
+  if (IS_ABSOLUTE_PATH (dirname))
+    {
+      resolved_dirname = (char *) malloc (dirname_len);
+      if (resolved_dirname != NULL)
+	memcpy (resolved_dirname, dirname, dirname_len);
+      return resolved_dirname;
+    }
+
+  path_max = (unsigned int) PATH_MAX;
+  path_max += 2;		/* The getcwd docs say to do this.  */
+
+  for (;;)
+    {
+      resolved_dirname = (char *) malloc (path_max + dirname_len);
+      if (resolved_dirname == NULL)
+	return NULL;
+
+      __set_errno (0);
+      if (getcwd (resolved_dirname, path_max) != NULL)
+	break;
+      free (resolved_dirname);
+      if (errno != ERANGE)
+	return NULL;
+
+      path_max += path_max / 2;
+      path_max += PATH_INCR;
+    }
+
+  stpcpy (stpcpy (strchr (resolved_dirname, '\0'), "/"), dirname);
+  return resolved_dirname;
+}
+
+/* The key under which an item of a batch is looked up.  */
+struct batch_key
+{
+  /* The msgid, or the msgctxt and the msgid joined by an EOT byte.  */
+  const char *msgid;
+  unsigned long int hash;
+  /* Memory for the joined msgctxt and msgid.  */
+  char *buffer;
+  size_t buffer_size;
+};
+
+/* Set up KEY for ITEM.  Return 0 if memory is exhausted.  */
+static int
+prepare_batch_key (struct batch_key *key, const struct gettext_batch_item *item)
+{
+  if (item->msgctxt != NULL)
+    {
+      size_t msgctxt_len = strlen (item->msgctxt);
+      size_t size = msgctxt_len + 1 + strlen (item->msgid) + 1;
+
+      if (size > key->buffer_size)
+	{
+	  char *new_buffer = (char *) realloc (key->buffer, 2 * size);
+
+	  if (new_buffer == NULL)
+	    return 0;
+	  key->buffer = new_buffer;
+	  key->buffer_size = 2 * size;
+	}
+      memcpy (key->buffer, item->msgctxt, msgctxt_len);
+      key->buffer[msgctxt_len] = '\004';
+      strcpy (key->buffer + msgctxt_len + 1, item->msgid);
+      key->msgid = key->buffer;
+    }
+  else
+    key->msgid = item->msgid;
+  key->hash = __hash_string (key->msgid);
+  return 1;
+}
+
+/* Look up the COUNT messages described by ITEMS in the DOMAINNAME message
+   catalog for the current CATEGORY locale, and store their translations in
+   TRANSLATIONS.  The result for each item is the same as that of
+   dcgettext or dcngettext, resp. pgettext and npgettext from "gettext.h".
+   But the lock is acquired, the locale is determined and the list of
+   catalogs to search is built only once for the whole batch.  */
+void
+libintl_dcgettext_batch (const char *domainname,
+			 const struct gettext_batch_item *items, size_t count,
+			 const char **translations, int category)
+{
+  struct binding *binding;
+  const char *categoryname;
+  const char *categoryvalue;
+  char *dirname;
+  char *xdomainname = NULL;
+  char *single_locale = NULL;
+  /* The catalogs to search, in this order, including the successors of
+     each catalog.  They are found as needed, while ALL_DOMAINS_FOUND is
+     zero.  */
+  struct loaded_l10nfile **domains = NULL;
+  size_t ndomains = 0;
+  size_t domains_allocated = 0;
+  int all_domains_found = 0;
+  struct batch_key keys[2];
+  const char *logfilename;
+  int saved_errno;
+  size_t domainname_len;
+  size_t i;
+#ifdef HAVE_PER_THREAD_LOCALE
+  const char *localename;
+  struct known_translation_t search;
+#endif
+
+  if (count == 0)
+    return;
+
+  saved_errno = errno;
+
+  if (__builtin_expect (reload_interval != 0, 0))
+    reload_textdomains_periodically ();
+
+  keys[0].buffer = NULL;
+  keys[0].buffer_size = 0;
+  keys[1].buffer = NULL;
+  keys[1].buffer_size = 0;
+
+  gl_rwlock_rdlock (_nl_state_lock);
+
+  if (domainname == NULL)
+    domainname = _nl_current_default_domain;
+  domainname_len = strlen (domainname);
+
+#ifdef LC_MESSAGES_COMPAT
+  if (category == LC_MESSAGES_COMPAT)
+    category = LC_MESSAGES;
+#endif
+
+  categoryname = category_to_name (category);
+#ifdef HAVE_PER_THREAD_LOCALE
+  localename = _nl_locale_name_thread_unsafe (category, categoryname);
+  if (localename == NULL)
+    localename = "";
+  search.domain = NULL;
+  search.domainname = domainname;
+  search.category = category;
+  search.localename = localename;
+#endif
+
+  DETERMINE_SECURE;
+
+  logfilename = (ENABLE_SECURE ? NULL : getenv ("GETTEXT_LOG_UNTRANSLATED"));
+  if (logfilename != NULL && logfilename[0] == '\0')
+    logfilename = NULL;
+
+  binding = find_binding (domainname);
+  dirname = absolute_dirname (binding != NULL
+			      ? binding->dirname : _nl_default_dirname);
+  if (dirname == NULL)
+    /* Don't signal an error but simply return the original strings.  */
+    all_domains_found = 1;
+
+  categoryvalue = guess_category_value (category, categoryname);
+
+  if (!all_domains_found)
+    {
+      xdomainname =
+	(char *) malloc (strlen (categoryname) + domainname_len + 5);
+      single_locale = (char *) malloc (strlen (categoryvalue) + 1);
+      if (xdomainname == NULL || single_locale == NULL)
+	all_domains_found = 1;
+      else
+	stpcpy ((char *) mempcpy (stpcpy (stpcpy (xdomainname, categoryname),
+					  "/"),
+				  domainname, domainname_len),
+		".mo");
+    }
+
+  if (!prepare_batch_key (&keys[0], &items[0]))
+    keys[0].msgid = NULL;
+
+  for (i = 0; i < count; i++)
+    {
+      const struct gettext_batch_item *item = &items[i];
+      struct batch_key *key = &keys[i & 1];
+      const char *msgid = key->msgid;
+      struct loaded_l10nfile *domain = NULL;
+      const char *retval = NULL;
+      size_t retlen = 0;
+      int outcome = STATISTICS_CACHE_HIT;
+      unsigned int catalog_misses = 0;
+      unsigned long int conversions_before = conversions_done;
+
+      /* Prepare the key of the next item, and bring the buckets where it
+	 will be searched into the CPU cache, while this item is looked
+	 up.  */
+      if (i + 1 < count)
+	{
+	  struct batch_key *next_key = &keys[(i + 1) & 1];
+
+	  if (prepare_batch_key (next_key, &items[i + 1]))
+	    {
+#if defined HAVE_PER_THREAD_LOCALE && KNOWN_TRANSLATIONS_LOCKFREE
+	      known_translations_prefetch (next_key->hash);
+#endif
+	      if (ndomains > 0 && domains[0]->data != NULL)
+		{
+		  const struct loaded_domain *data =
+		    (const struct loaded_domain *) domains[0]->data;
+
+		  if (data->hash_tab != NULL)
+		    PREFETCH (&data->hash_tab[(nls_uint32) next_key->hash
+					      % data->hash_size]);
+		}
+	    }
+	  else
+	    next_key->msgid = NULL;
+	}
+
+      if (msgid == NULL)
+	{
+	  /* Memory is exhausted.  Return the original strings.  */
+	  translations[i] =
+	    (item->msgid_plural == NULL || item->n == 1
+	     ? item->msgid : item->msgid_plural);
+	  continue;
+	}
+
+#ifdef HAVE_PER_THREAD_LOCALE
+      /* Try the table of known translations first.  */
+      search.msgid.ptr = msgid;
+      search.hash = key->hash;
+      {
+	struct known_translation_t *found = known_translations_find (&search);
+
+	if (found != NULL)
+	  {
+	    domain = found->domain;
+	    retval = found->translation;
+	    retlen = found->translation_length;
+	  }
+      }
+#endif
+
+      if (retval == NULL)
+	{
+	  size_t d;
+
+	  outcome = STATISTICS_TRANSLATED;
+
+	  /* Search the catalogs in order, finding more of them as needed.  */
+	  for (d = 0; ; d++)
+	    {
+	      char *result;
+
+	      while (d == ndomains && !all_domains_found)
+		{
+		  struct loaded_l10nfile *found_domain;
+
+		  /* Make CATEGORYVALUE point to the next element of the
+		     list.  */
+		  while (categoryvalue[0] == ':')
+		    ++categoryvalue;
+		  if (categoryvalue[0] == '\0')
+		    {
+		      /* An implicit "C" entry ends the list.  */
+		      all_domains_found = 1;
+		      break;
+		    }
+		  else
+		    {
+		      char *cp = single_locale;
+		      while (categoryvalue[0] != '\0' && categoryvalue[0] != ':')
+			*cp++ = *categoryvalue++;
+		      *cp = '\0';
+
+		      /* When this is a SUID binary we must not allow
+			 accessing files outside the dedicated
+			 directories.  */
+		      if (ENABLE_SECURE && IS_PATH_WITH_DIR (single_locale))
+			continue;
+		    }
+
+		  if (strcmp (single_locale, "C") == 0
+		      || strcmp (single_locale, "POSIX") == 0)
+		    {
+		      all_domains_found = 1;
+		      break;
+		    }
+
+		  found_domain =
+		    _nl_find_domain (dirname, single_locale, xdomainname,
+				     binding);
+		  if (found_domain != NULL)
+		    {
+		      size_t nsuccessors;
+		      size_t cnt;
+
+		      for (nsuccessors = 0;
+			   found_domain->successor[nsuccessors] != NULL;
+			   nsuccessors++)
+			;
+		      if (ndomains + 1 + nsuccessors > domains_allocated)
+			{
+			  size_t new_allocated =
+			    2 * domains_allocated + 1 + nsuccessors;
+			  struct loaded_l10nfile **new_domains =
+			    (struct loaded_l10nfile **)
+			    realloc (domains,
+				     new_allocated
+				     * sizeof (struct loaded_l10nfile *));
+
+			  if (new_domains == NULL)
+			    {
+			      all_domains_found = 1;
+			      break;
+			    }
+			  domains = new_domains;
+			  domains_allocated = new_allocated;
+			}
+		      domains[ndomains++] = found_domain;
+		      for (cnt = 0; cnt < nsuccessors; cnt++)
+			domains[ndomains++] = found_domain->successor[cnt];
+		    }
+		}
+	      if (d == ndomains)
+		break;
+
+	      result = find_msg (domains[d], binding, msgid, key->hash, 1,
+				 &retlen);
+	      if (result == (char *) -1)
+		/* Some resource problem exists (likely memory) and the
+		   string could not be converted.  */
+		break;
+	      if (result != NULL)
+		{
+		  domain = domains[d];
+		  retval = result;
+#ifdef HAVE_PER_THREAD_LOCALE
+		  remember_translation (msgid, key->hash,
+					domainname, domainname_len, category,
+					localename,
+					domain, retval, retlen);
+#endif
+		  break;
+		}
+	      catalog_misses++;
+	    }
+	}
+
+      if (retval != NULL)
+	translations[i] =
+	  (item->msgid_plural != NULL
+	   ? plural_lookup (domain, item->n, retval, retlen)
+	   : retval);
+      else
+	{
+	  outcome = STATISTICS_UNTRANSLATED;
+	  if (logfilename != NULL)
+	    _nl_log_untranslated (logfilename, domainname,
+				  msgid, item->msgid_plural,
+				  item->msgid_plural != NULL);
+	  translations[i] =
+	    (item->msgid_plural == NULL || item->n == 1
+	     ? item->msgid : item->msgid_plural);
+	}
+
+      RECORD_LOOKUP (domainname, msgid, key->hash, outcome, catalog_misses,
+		     conversions_done - conversions_before);
+    }
+
+  gl_rwlock_unlock (_nl_state_lock);
+
+  free (domains);
+  free (single_locale);
+  free (xdomainname);
+  free (dirname);
+  free (keys[1].buffer);
+  free (keys[0].buffer);
+  __set_errno (saved_errno);
+}
+# endif
+#endif
+
+
+#if defined _LIBC || HAVE_ICONV
+
+/* This lock primarily protects the memory management variables freemem,
+   freemem_size in find_msg.  It also protects write accesses to
+   convd->conv_tab.  It's not worth using a separate lock (such as
+   domain->conversions_lock) for this purpose, because when modifying
+   convd->conv_tab, we also need to lock freemem, freemem_size for most of
+   the time.  */
+__libc_lock_define_initialized (static, convert_lock)
+
+/* The output encodings that have been used so far, each stored once, so
+   that two encodings are equal if and only if their names are the same
+   pointer.  The list only grows; readers don't take the lock if
+   KNOWN_TRANSLATIONS_LOCKFREE.  */
+struct interned_encoding
+{
+  struct interned_encoding *next;
+  char name[ZERO];
+};
+
+static struct interned_encoding * volatile interned_encodings;
+gl_lock_define_initialized (static, interned_encodings_lock)
+
+/* Return the unique copy of the encoding name ENCODING, or NULL if memory
+   is exhausted.  */
+const char *
+_nl_intern_encoding (const char *encoding)
+{
+  struct interned_encoding *p;
+  size_t len;
+
+# if !KNOWN_TRANSLATIONS_LOCKFREE
+  gl_lock_lock (interned_encodings_lock);
+# endif
+  for (p = load_acquire (interned_encodings); p != NULL; p = p->next)
+    if (p->name == encoding || strcmp (p->name, encoding) == 0)
+      break;
+# if !KNOWN_TRANSLATIONS_LOCKFREE
+  gl_lock_unlock (interned_encodings_lock);
+# endif
+  if (p != NULL)
+    return p->name;
+
+  len = strlen (encoding) + 1;
+  gl_lock_lock (interned_encodings_lock);
+  /* Maybe in the meantime somebody added it.  Recheck.  */
+  for (p = interned_encodings; p != NULL; p = p->next)
+    if (strcmp (p->name, encoding) == 0)
+      break;
+  if (p == NULL)
+    {
+      p = (struct interned_encoding *)
+	malloc (offsetof (struct interned_encoding, name) + len);
+      if (p != NULL)
+	{
+	  memcpy (p->name, encoding, len);
+	  p->next = interned_encodings;
+	  store_release (interned_encodings, p);
+	}
+    }
+  gl_lock_unlock (interned_encodings_lock);
+  return (p != NULL ? p->name : NULL);
+}
+
+# ifndef IN_LIBGLOCALE
+/* Return the output charset for DOMAINBINDING, as returned by
+   _nl_intern_encoding, or NULL if memory is exhausted.  A codeset set
+   through bind_textdomain_codeset has been interned when it was set.  */
+static const char *
+get_output_encoding (struct binding *domainbinding)
+{
+  /* The last output charset that did not come from bind_textdomain_codeset.
+     The locale's charset may change, and locale_charset may return it in a
+     static buffer, therefore the name is compared, not the pointer.  */
+  static const char * volatile last_encoding;
+  const char *charset;
+  const char *encoding;
+
+  if (domainbinding != NULL && domainbinding->codeset != NULL)
+    {
+      encoding = domainbinding->encoding;
+      if (encoding != NULL)
+	return encoding;
+      return _nl_intern_encoding (domainbinding->codeset);
+    }
+
+  charset = get_output_charset (domainbinding);
+  encoding = load_acquire (last_encoding);
+  if (encoding == NULL || strcmp (encoding, charset) != 0)
+    {
+      encoding = _nl_intern_encoding (charset);
+      if (encoding != NULL)
+	store_release (last_encoding, encoding);
+    }
+  return encoding;
+}
+# endif
+
+#endif
+
+#if !defined _LIBC && HAVE_ICONV
+
+/* Return nonzero if all translations of a catalog should be converted as
+   soon as a conversion to a new encoding is set up, rather than each one
+   when it is first looked up.  */
+static int
+eager_conversion_enabled (void)
+{
+  /* Like OUTPUT_CHARSET, this user variable is looked at only once.  */
+  static int cached = -1;
+
+  if (cached < 0)
+    {
+      const char *value = getenv ("GETTEXT_EAGER_CONVERSION");
+
+      cached = (value != NULL && value[0] != '\0');
+    }
+  return cached;
+}
+
+/* Convert all translations of DOMAIN through CONVD->conv and fill
+   CONVD->conv_tab.  The converted strings, with the same layout as those
+   made by find_msg, are all stored in a single block of memory, which is
+   not written to afterwards: a process that forks after this point shares
+   these pages with its children.  Translations that cannot be converted
+   are left to find_msg, which will reject them.  If memory is exhausted,
+   CONVD->conv_tab is left NULL, and find_msg converts lazily.  */
+static void
+convert_domain (struct loaded_domain *domain, struct converted_domain *convd)
+{
+  size_t nstrings = domain->nstrings;
+  size_t n = nstrings + domain->n_sysdep_strings;
+  char **conv_tab;
+  size_t *offsets;
+  char *block;
+  size_t block_size;
+  size_t used;
+  size_t act;
+
+  conv_tab = (char **) calloc (n, sizeof (char *));
+  offsets = (size_t *) malloc (n * sizeof (size_t));
+  if (conv_tab == NULL || offsets == NULL)
+    goto fail;
+  block = NULL;
+  block_size = 0;
+  used = 0;
 
-	  for (;;)
-	    {
-	      resolved_dirname = (char *) alloca (path_max + dirname_len);
-	      ADD_BLOCK (block_list, tmp_dirname);
+  for (act = 0; act < n; act++)
+    {
+      const char *result;
+      size_t resultlen;
 
-	      __set_errno (0);
-	      ret = getcwd (resolved_dirname, path_max);
-	      if (ret != NULL || errno != ERANGE)
-		break;
+      if (act < nstrings)
+	{
+	  result =
+	    domain->data + W (domain->must_swap, domain->trans_tab[act].offset);
+	  resultlen = W (domain->must_swap, domain->trans_tab[act].length) + 1;
+	}
+      else
+	{
+	  result = domain->trans_sysdep_tab[act - nstrings].pointer;
+	  resultlen = domain->trans_sysdep_tab[act - nstrings].length;
+	}
 
-	      path_max += path_max / 2;
-	      path_max += PATH_INCR;
+      offsets[act] = (size_t) -1;
+      for (;;)
+	{
+	  if (block_size - used > sizeof (size_t))
+	    {
+	      const char *inptr = result;
+	      size_t inleft = resultlen;
+	      char *start = block + used + sizeof (size_t);
+	      char *outptr = start;
+	      size_t outleft = block_size - used - sizeof (size_t);
+
+	      if (iconv (convd->conv, (ICONV_CONST char **) &inptr, &inleft,
+			 &outptr, &outleft)
+		  != (size_t) (-1))
+		{
+		  *(size_t *) (block + used) = outptr - start;
+		  offsets[act] = used;
+		  used = outptr - block;
+		  used = (used + alignof (size_t) - 1)
+			 & ~ (size_t) (alignof (size_t) - 1);
+		  break;
+		}
+	      /* Return to the initial state before retrying.  */
+	      iconv (convd->conv, NULL, NULL, NULL, NULL);
+	      if (errno != E2BIG)
+		/* Leave this translation to find_msg.  */
+		break;
 	    }
 
-	  if (ret == NULL)
-	    /* We cannot get the current working directory.  Don't signal an
-	       error but simply return the default string.  */
-	    goto return_untranslated;
+	  {
+	    size_t new_size = 2 * block_size + 4 * resultlen + 64;
+	    char *new_block = (char *) realloc (block, new_size);
 
-	  stpcpy (stpcpy (strchr (resolved_dirname, '\0'), "/"), dirname);
-	  dirname = resolved_dirname;
+	    if (new_block == NULL)
+	      {
+		free (block);
+		goto fail;
+	      }
+	    block = new_block;
+	    block_size = new_size;
+	  }
 	}
-#ifndef IN_LIBGLOCALE
     }
-#endif
 
-  /* Now determine the symbolic name of CATEGORY and its value.  */
-#ifndef CATEGORYNAME_INITIALIZED
-  categoryname = category_to_name (category);
-#endif
-#ifdef IN_LIBGLOCALE
-  categoryvalue = guess_category_value (category, categoryname, localename);
-#else
-  categoryvalue = guess_category_value (category, categoryname);
+  if (used < block_size)
+    {
+      /* Give back the unused memory at the end of the block.  */
+      char *new_block = (char *) realloc (block, used > 0 ? used : 1);
+
+      if (new_block != NULL)
+	block = new_block;
+    }
+
+  for (act = 0; act < n; act++)
+    if (offsets[act] != (size_t) -1)
+      {
+	conv_tab[act] = block + offsets[act];
+# ifndef IN_LIBGLOCALE
+	conversions_done++;
+# endif
+      }
+
+  free (offsets);
+  convd->conv_tab = conv_tab;
+  return;
+
+ fail:
+  free (offsets);
+  free (conv_tab);
+}
+
 #endif
 
-  domainname_len = strlen (domainname);
-  xdomainname = (char *) alloca (strlen (categoryname)
-				 + domainname_len + 5);
-  ADD_BLOCK (block_list, xdomainname);
+#if !defined IN_LIBGLOCALE && !defined _LIBC
 
-  stpcpy ((char *) mempcpy (stpcpy (stpcpy (xdomainname, categoryname), "/"),
-			    domainname, domainname_len),
-	  ".mo");
+/* Return the current time in microseconds, or 0 if unknown.  */
+static unsigned long int
+current_microseconds (void)
+{
+# if HAVE_GETTIMEOFDAY
+  struct timeval tv;
 
-  /* Creating working area.  */
-  single_locale = (char *) alloca (strlen (categoryvalue) + 1);
-  ADD_BLOCK (block_list, single_locale);
+  if (gettimeofday (&tv, NULL) == 0)
+    return (unsigned long int) tv.tv_sec * 1000000UL + tv.tv_usec;
+# endif
+  return 0;
+}
+
+/* Load the catalog of DOMAINNAME for LOCALE and CATEGORYNAME, and prepare
+   it according to FLAGS.  Return 1 if a catalog was found, 0 otherwise.  */
+static int
+preload_catalog (const char *domainname, const char *locale,
+		 int category, const char *categoryname, int flags,
+		 void (*report) (const struct textdomain_preload_report *,
+				 void *),
+		 void *report_data)
+{
+  struct textdomain_preload_report info;
+  struct binding *binding;
+  struct loaded_l10nfile *domain_file = NULL;
+  char *dirname;
+  char *xdomainname;
+  char *single_locale;
+  size_t domainname_len = strlen (domainname);
+  size_t locale_len = strlen (locale) + 1;
+  unsigned long int start;
 
+  /* When this is a SUID binary we must not allow accessing files
+     outside the dedicated directories.  */
+  if (ENABLE_SECURE && IS_PATH_WITH_DIR (locale))
+    return 0;
 
-  /* Search for the given string.  This is a loop because we perhaps
-     got an ordered list of languages to consider for the translation.  */
-  while (1)
+  start = current_microseconds ();
+
+  info.domainname = domainname;
+  info.locale = locale;
+  info.filename = NULL;
+  info.nmessages = 0;
+  info.size = 0;
+
+  gl_rwlock_rdlock (_nl_state_lock);
+
+  binding = find_binding (domainname);
+  dirname = absolute_dirname (binding != NULL
+			      ? binding->dirname : _nl_default_dirname);
+  xdomainname = (char *) malloc (strlen (categoryname) + domainname_len + 5);
+  single_locale = (char *) malloc (locale_len);
+
+  if (dirname != NULL && xdomainname != NULL && single_locale != NULL)
     {
-      /* Make CATEGORYVALUE point to the next element of the list.  */
-      while (categoryvalue[0] != '\0' && categoryvalue[0] == ':')
-	++categoryvalue;
-      if (categoryvalue[0] == '\0')
-	{
-	  /* The whole contents of CATEGORYVALUE has been searched but
-	     no valid entry has been found.  We solve this situation
-	     by implicitly appending a "C" entry, i.e. no translation
-	     will take place.  */
-	  single_locale[0] = 'C';
-	  single_locale[1] = '\0';
-	}
-      else
+      struct loaded_l10nfile *found;
+
+      stpcpy ((char *) mempcpy (stpcpy (stpcpy (xdomainname, categoryname),
+					"/"),
+				domainname, domainname_len),
+	      ".mo");
+      memcpy (single_locale, locale, locale_len);
+
+      /* This loads the catalog, if it exists.  */
+      found = _nl_find_domain (dirname, single_locale, xdomainname, binding);
+      if (found != NULL)
 	{
-	  char *cp = single_locale;
-	  while (categoryvalue[0] != '\0' && categoryvalue[0] != ':')
-	    *cp++ = *categoryvalue++;
-	  *cp = '\0';
+	  if (found->data != NULL)
+	    domain_file = found;
+	  else
+	    {
+	      int cnt;
 
-	  /* When this is a SUID binary we must not allow accessing files
-	     outside the dedicated directories.  */
-	  if (ENABLE_SECURE && IS_PATH_WITH_DIR (single_locale))
-	    /* Ingore this entry.  */
-	    continue;
+	      for (cnt = 0; found->successor[cnt] != NULL; cnt++)
+		if (found->successor[cnt]->data != NULL)
+		  {
+		    domain_file = found->successor[cnt];
+		    break;
+		  }
+	    }
 	}
+    }
 
-      /* If the current locale value is C (or POSIX) we don't load a
-	 domain.  Return the MSGID.  */
-      if (strcmp (single_locale, "C") == 0
-	  || strcmp (single_locale, "POSIX") == 0)
-	break;
+  if (domain_file != NULL)
+    {
+      struct loaded_domain *domain =
+	(struct loaded_domain *) domain_file->data;
 
-      /* Find structure describing the message catalog matching the
-	 DOMAINNAME and CATEGORY.  */
-      domain = _nl_find_domain (dirname, single_locale, xdomainname, binding);
+      if (flags & PRELOAD_TEXTDOMAINS_POPULATE)
+	_nl_prefault_domain (domain);
 
-      if (domain != NULL)
+# if HAVE_ICONV
+      if (flags & PRELOAD_TEXTDOMAINS_CONVERT)
 	{
-#if defined IN_LIBGLOCALE
-	  retval = _nl_find_msg (domain, binding, encoding, msgid1, &retlen);
-#else
-	  retval = _nl_find_msg (domain, binding, msgid1, 1, &retlen);
-#endif
+	  size_t len;
+	  const char *encoding;
 
-	  if (retval == NULL)
+	  /* Looking up the header entry sets up the conversion to the
+	     output character set.  */
+	  find_msg (domain_file, binding, "", __hash_string (""), 1, &len);
+
+	  encoding = get_output_encoding (binding);
+	  if (encoding != NULL)
 	    {
-	      int cnt;
+	      struct converted_domain *convd = NULL;
+	      size_t i;
+
+	      gl_rwlock_rdlock (domain->conversions_lock);
+	      for (i = 0; i < domain->nconversions; i++)
+		if (domain->conversions[i].encoding == encoding)
+		  {
+		    convd = &domain->conversions[i];
+		    break;
+		  }
+	      gl_rwlock_unlock (domain->conversions_lock);
 
-	      for (cnt = 0; domain->successor[cnt] != NULL; ++cnt)
+	      /* Convert all translations now.  */
+	      if (convd != NULL && convd->conv != (iconv_t) -1)
 		{
-#if defined IN_LIBGLOCALE
-		  retval = _nl_find_msg (domain->successor[cnt], binding,
-					 encoding, msgid1, &retlen);
-#else
-		  retval = _nl_find_msg (domain->successor[cnt], binding,
-					 msgid1, 1, &retlen);
-#endif
-
-		  if (retval != NULL)
-		    {
-		      domain = domain->successor[cnt];
-		      break;
-		    }
+		  __libc_lock_lock (convert_lock);
+		  if (convd->conv_tab == NULL)
+		    convert_domain (domain, convd);
+		  __libc_lock_unlock (convert_lock);
 		}
 	    }
+	}
+# endif
 
-	  /* Returning -1 means that some resource problem exists
-	     (likely memory) and that the strings could not be
-	     converted.  Return the original strings.  */
-	  if (__builtin_expect (retval == (char *) -1, 0))
-	    break;
-
-	  if (retval != NULL)
-	    {
-	      /* Found the translation of MSGID1 in domain DOMAIN:
-		 starting at RETVAL, RETLEN bytes.  */
-	      FREE_BLOCKS (block_list);
-	      if (foundp == NULL)
-		{
-		  /* Create a new entry and add it to the search tree.  */
-		  size_t msgid_len;
-		  size_t size;
-		  struct known_translation_t *newp;
-
-		  msgid_len = strlen (msgid1) + 1;
-		  size = offsetof (struct known_translation_t, msgid)
-			 + msgid_len + domainname_len + 1;
-#ifdef HAVE_PER_THREAD_LOCALE
-		  size += strlen (localename) + 1;
-#endif
-		  newp = (struct known_translation_t *) malloc (size);
-		  if (newp != NULL)
-		    {
-		      char *new_domainname;
-#ifdef HAVE_PER_THREAD_LOCALE
-		      char *new_localename;
-#endif
+      info.filename = domain_file->filename;
+      info.nmessages = domain->nstrings + domain->n_sysdep_strings;
+      info.size = domain->mmap_size;
+    }
 
-		      new_domainname =
-			(char *) mempcpy (newp->msgid.appended, msgid1,
-					  msgid_len);
-		      memcpy (new_domainname, domainname, domainname_len + 1);
-#ifdef HAVE_PER_THREAD_LOCALE
-		      new_localename = new_domainname + domainname_len + 1;
-		      strcpy (new_localename, localename);
-#endif
-		      newp->domainname = new_domainname;
-		      newp->category = category;
-#ifdef HAVE_PER_THREAD_LOCALE
-		      newp->localename = new_localename;
-#endif
-#ifdef IN_LIBGLOCALE
-		      newp->encoding = encoding;
-#endif
-		      newp->counter = _nl_msg_cat_cntr;
-		      newp->domain = domain;
-		      newp->translation = retval;
-		      newp->translation_length = retlen;
+  gl_rwlock_unlock (_nl_state_lock);
 
-		      gl_rwlock_wrlock (tree_lock);
+  free (single_locale);
+  free (xdomainname);
+  free (dirname);
 
-		      /* Insert the entry in the search tree.  */
-		      foundp = (struct known_translation_t **)
-			tsearch (newp, &root, transcmp);
+  if (report != NULL)
+    {
+      info.microseconds = current_microseconds () - start;
+      report (&info, report_data);
+    }
 
-		      gl_rwlock_unlock (tree_lock);
+  return domain_file != NULL;
+}
 
-		      if (foundp == NULL
-			  || __builtin_expect (*foundp != newp, 0))
-			/* The insert failed.  */
-			free (newp);
-		    }
-		}
-	      else
-		{
-		  /* We can update the existing entry.  */
-		  (*foundp)->counter = _nl_msg_cat_cntr;
-		  (*foundp)->domain = domain;
-		  (*foundp)->translation = retval;
-		  (*foundp)->translation_length = retlen;
-		}
+/* Load the message catalogs of the domains DOMAINNAMES, for the CATEGORY
+   of the locales LOCALES, in advance.  */
+int
+libintl_preload_textdomains (const char * const *domainnames,
+			     const char * const *locales,
+			     int category, int flags,
+			     void (*report)
+			       (const struct textdomain_preload_report *,
+				void *),
+			     void *report_data)
+{
+  const char *categoryname;
+  const char *categoryvalue = NULL;
+  int saved_errno = errno;
+  int count = 0;
 
-	      __set_errno (saved_errno);
+  if (category < 0 || category == LC_ALL)
+    return 0;
+# ifdef LC_MESSAGES_COMPAT
+  if (category == LC_MESSAGES_COMPAT)
+    category = LC_MESSAGES;
+# endif
+  categoryname = category_to_name (category);
 
-	      /* Now deal with plural.  */
-	      if (plural)
-		retval = plural_lookup (domain, n, retval, retlen);
+  /* Needed by preload_catalog, which may run before any lookup.  */
+  DETERMINE_SECURE;
 
-	      gl_rwlock_unlock (_nl_state_lock);
-#ifdef _LIBC
-	      __libc_rwlock_unlock (__libc_setlocale_lock);
-#endif
-	      return retval;
-	    }
-	}
+  /* By default, use the locales that a lookup would use.  */
+  if (locales == NULL)
+    {
+      gl_rwlock_rdlock (_nl_state_lock);
+      categoryvalue = guess_category_value (category, categoryname);
+      gl_rwlock_unlock (_nl_state_lock);
     }
 
- return_untranslated:
-  /* Return the untranslated MSGID.  */
-  FREE_BLOCKS (block_list);
-  gl_rwlock_unlock (_nl_state_lock);
-#ifdef _LIBC
-  __libc_rwlock_unlock (__libc_setlocale_lock);
-#endif
-#ifndef _LIBC
-  if (!ENABLE_SECURE)
+  for (; *domainnames != NULL; domainnames++)
     {
-      extern void _nl_log_untranslated (const char *logfilename,
-					const char *domainname,
-					const char *msgid1, const char *msgid2,
-					int plural);
-      const char *logfilename = getenv ("GETTEXT_LOG_UNTRANSLATED");
+      if (locales != NULL)
+	{
+	  const char * const *lp;
+
+	  for (lp = locales; *lp != NULL; lp++)
+	    if ((*lp)[0] != '\0'
+		&& strcmp (*lp, "C") != 0 && strcmp (*lp, "POSIX") != 0)
+	      count += preload_catalog (*domainnames, *lp, category,
+					categoryname, flags,
+					report, report_data);
+	}
+      else
+	{
+	  /* CATEGORYVALUE is a colon-separated list.  */
+	  const char *p = categoryvalue;
 
-      if (logfilename != NULL && logfilename[0] != '\0')
-	_nl_log_untranslated (logfilename, domainname, msgid1, msgid2, plural);
+	  while (*p != '\0')
+	    {
+	      const char *end = strchr (p, ':');
+	      size_t len = (end != NULL ? end - p : strlen (p));
+
+	      if (len > 0)
+		{
+		  char *locale = (char *) malloc (len + 1);
+
+		  if (locale != NULL)
+		    {
+		      memcpy (locale, p, len);
+		      locale[len] = '\0';
+		      if (strcmp (locale, "C") != 0
+			  && strcmp (locale, "POSIX") != 0)
+			count += preload_catalog (*domainnames, locale,
+						  category, categoryname,
+						  flags, report, report_data);
+		      free (locale);
+		    }
+		}
+	      p += len;
+	      if (*p == ':')
+		p++;
+	    }
+	}
     }
-#endif
+
   __set_errno (saved_errno);
-  return (plural == 0
-	  ? (char *) msgid1
-	  /* Use the Germanic plural rule.  */
-	  : n == 1 ? (char *) msgid1 : (char *) msgid2);
+  return count;
 }
 
+#endif
 
 /* Look up the translation of msgid within DOMAIN_FILE and DOMAINBINDING.
    Return it if found.  Return NULL if not found or in case of a conversion
@@ -884,11 +2347,35 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 	      struct binding *domainbinding, const char *encoding,
 	      const char *msgid,
 	      size_t *lengthp)
+{
+  return find_msg (domain_file, domainbinding, encoding,
+		   msgid, __hash_string (msgid), lengthp);
+}
 #else
 _nl_find_msg (struct loaded_l10nfile *domain_file,
 	      struct binding *domainbinding,
 	      const char *msgid, int convert,
 	      size_t *lengthp)
+{
+  return find_msg (domain_file, domainbinding,
+		   msgid, __hash_string (msgid), convert, lengthp);
+}
+#endif
+
+/* Like _nl_find_msg, with MSGID_HASH being the value of
+   __hash_string (MSGID).  */
+static char *
+internal_function
+#ifdef IN_LIBGLOCALE
+find_msg (struct loaded_l10nfile *domain_file,
+	  struct binding *domainbinding, const char *encoding,
+	  const char *msgid, unsigned long int msgid_hash,
+	  size_t *lengthp)
+#else
+find_msg (struct loaded_l10nfile *domain_file,
+	  struct binding *domainbinding,
+	  const char *msgid, unsigned long int msgid_hash, int convert,
+	  size_t *lengthp)
 #endif
 {
   struct loaded_domain *domain;
@@ -912,7 +2399,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
     {
       /* Use the hashing table.  */
       nls_uint32 len = strlen (msgid);
-      nls_uint32 hash_val = __hash_string (msgid);
+      nls_uint32 hash_val = msgid_hash;
       nls_uint32 idx = hash_val % domain->hash_size;
       nls_uint32 incr = 1 + (hash_val % (domain->hash_size - 2));
 
@@ -1002,25 +2489,32 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 # endif
     {
       /* We are supposed to do a conversion.  */
-# ifndef IN_LIBGLOCALE
-      const char *encoding = get_output_charset (domainbinding);
+# ifdef IN_LIBGLOCALE
+      const char *interned = _nl_intern_encoding (encoding);
+# else
+      const char *interned = get_output_encoding (domainbinding);
 # endif
       size_t nconversions;
       struct converted_domain *convd;
       size_t i;
 
+      if (__builtin_expect (interned == NULL, 0))
+	/* Nothing we can do, no more memory.  */
+	return (char *) -1;
+
       /* Protect against reallocation of the table.  */
       gl_rwlock_rdlock (domain->conversions_lock);
 
       /* Search whether a table with converted translations for this
-	 encoding has already been allocated.  */
+	 encoding has already been allocated.  Interned encodings can be
+	 compared as pointers.  */
       nconversions = domain->nconversions;
       convd = NULL;
 
       for (i = nconversions; i > 0; )
 	{
 	  i--;
-	  if (strcmp (domain->conversions[i].encoding, encoding) == 0)
+	  if (domain->conversions[i].encoding == interned)
 	    {
 	      convd = &domain->conversions[i];
 	      break;
@@ -1040,7 +2534,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 	  for (i = nconversions; i > 0; )
 	    {
 	      i--;
-	      if (strcmp (domain->conversions[i].encoding, encoding) == 0)
+	      if (domain->conversions[i].encoding == interned)
 		{
 		  convd = &domain->conversions[i];
 		  goto found_convd;
@@ -1061,22 +2555,14 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 	      {
 		/* Nothing we can do, no more memory.  We cannot use the
 		   translation because it might be encoded incorrectly.  */
-	      unlock_fail:
 		gl_rwlock_unlock (domain->conversions_lock);
 		return (char *) -1;
 	      }
 
 	    domain->conversions = new_conversions;
 
-	    /* Copy the 'encoding' string to permanent storage.  */
-	    encoding = strdup (encoding);
-	    if (__builtin_expect (encoding == NULL, 0))
-	      /* Nothing we can do, no more memory.  We cannot use the
-		 translation because it might be encoded incorrectly.  */
-	      goto unlock_fail;
-
 	    convd = &new_conversions[nconversions];
-	    convd->encoding = encoding;
+	    convd->encoding = interned;
 
 	    /* Find out about the character set the file is encoded with.
 	       This can be found (in textual form) in the entry "".  If this
@@ -1127,7 +2613,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		      charset[len] = '\0';
 # endif
 
-		      outcharset = encoding;
+		      outcharset = interned;
 
 # ifdef _LIBC
 		      /* We always want to use transliteration.  */
@@ -1143,7 +2629,6 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 			  if (__builtin_expect (r != __GCONV_NULCONV, 1))
 			    {
 			      gl_rwlock_unlock (domain->conversions_lock);
-			      free ((char *) encoding);
 			      return NULL;
 			    }
 
@@ -1180,6 +2665,10 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		}
 	    }
 	    convd->conv_tab = NULL;
+# if !defined _LIBC && HAVE_ICONV
+	    if (convd->conv != (iconv_t) -1 && eager_conversion_enabled ())
+	      convert_domain (domain, convd);
+# endif
 	    /* Here domain->conversions is still == new_conversions.  */
 	    domain->nconversions++;
 	  }
@@ -1207,17 +2696,9 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 	     handle this case by converting RESULTLEN bytes, including
 	     NULs.  */
 
-	  /* This lock primarily protects the memory management variables
-	     freemem, freemem_size.  It also protects write accesses to
-	     convd->conv_tab.  It's not worth using a separate lock (such
-	     as domain->conversions_lock) for this purpose, because when
-	     modifying convd->conv_tab, we also need to lock freemem,
-	     freemem_size for most of the time.  */
-	  __libc_lock_define_initialized (static, lock)
-
 	  if (__builtin_expect (convd->conv_tab == NULL, 0))
 	    {
-	      __libc_lock_lock (lock);
+	      __libc_lock_lock (convert_lock);
 	      if (convd->conv_tab == NULL)
 		{
 		  convd->conv_tab =
@@ -1228,7 +2709,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		  /* Mark that we didn't succeed allocating a table.  */
 		  convd->conv_tab = (char **) -1;
 		}
-	      __libc_lock_unlock (lock);
+	      __libc_lock_unlock (convert_lock);
 	    }
 
 	  if (__builtin_expect (convd->conv_tab == (char **) -1, 0))
@@ -1254,7 +2735,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 	      transmem_block_t *transmem_list;
 # endif
 
-	      __libc_lock_lock (lock);
+	      __libc_lock_lock (convert_lock);
 	    not_translated_yet:
 
 	      inbuf = (const unsigned char *) result;
@@ -1287,7 +2768,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		    {
 		      /* We should not use the translation at all, it
 			 is incorrectly encoded.  */
-		      __libc_lock_unlock (lock);
+		      __libc_lock_unlock (convert_lock);
 		      return NULL;
 		    }
 
@@ -1313,7 +2794,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		    }
 		  if (errno != E2BIG)
 		    {
-		      __libc_lock_unlock (lock);
+		      __libc_lock_unlock (convert_lock);
 		      return NULL;
 		    }
 #  endif
@@ -1349,7 +2830,7 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		    {
 		      freemem = NULL;
 		      freemem_size = 0;
-		      __libc_lock_unlock (lock);
+		      __libc_lock_unlock (convert_lock);
 		      return (char *) -1;
 		    }
 
@@ -1373,13 +2854,16 @@ _nl_find_msg (struct loaded_l10nfile *domain_file,
 		 into the table of conversions.  */
 	      *(size_t *) freemem = outbuf - freemem - sizeof (size_t);
 	      convd->conv_tab[act] = (char *) freemem;
+# if !defined IN_LIBGLOCALE && !defined _LIBC
+	      conversions_done++;
+# endif
 	      /* Shrink freemem, but keep it aligned.  */
 	      freemem_size -= outbuf - freemem;
 	      freemem = outbuf;
 	      freemem += freemem_size & (alignof (size_t) - 1);
 	      freemem_size = freemem_size & ~ (alignof (size_t) - 1);
 
-	      __libc_lock_unlock (lock);
+	      __libc_lock_unlock (convert_lock);
 	    }
 
 	  /* Now convd->conv_tab[act] contains the translation of all
@@ -1404,11 +2888,16 @@ internal_function
 plural_lookup (struct loaded_l10nfile *domain, unsigned long int n,
 	       const char *translation, size_t translation_len)
 {
-  struct loaded_domain *domaindata = (struct loaded_domain *) domain->data;
+  /* DOMAIN->data may be replaced by libintl_reload_textdomains meanwhile.  */
+  struct loaded_domain *domaindata =
+    (struct loaded_domain *) load_acquire (domain->data);
   unsigned long int index;
   const char *p;
 
-  index = plural_eval (domaindata->plural, n);
+  if (domaindata->plural_program != NULL)
+    index = plural_eval_program (domaindata->plural_program, n);
+  else
+    index = plural_eval (domaindata->plural, n);
   if (index >= domaindata->nplurals)
     /* This should never happen.  It means the plural expression and the
        given maximum value do not match.  */
@@ -1664,10 +3153,6 @@ mempcpy (void *dest, const void *src, size_t n)
 }
 #endif
 
-#if !_LIBC && !HAVE_TSEARCH
-# include "tsearch.c"
-#endif
-
 
 #ifdef _LIBC
 /* If we want to free all resources we have to do some work at
@@ -1691,9 +3176,29 @@ libc_freeres_fn (free_mem)
     /* Yes, again a pointer comparison.  */
     free ((char *) _nl_current_default_domain);
 
-  /* Remove the search tree with the known translations.  */
-  __tdestroy (root, free);
-  root = NULL;
+  /* Remove the table with the known translations.  */
+  if (known_translations != NULL)
+    {
+      size_t i;
+
+      for (i = 0; i < known_translations->size; i++)
+	free (known_translations->slots[i]);
+      free (known_translations);
+      known_translations = NULL;
+    }
+  while (retired_tables != NULL)
+    {
+      struct known_translations_table *table = retired_tables;
+      retired_tables = table->retired;
+      free (table);
+    }
+
+  while (interned_encodings != NULL)
+    {
+      struct interned_encoding *p = interned_encodings;
+      interned_encodings = p->next;
+      free (p);
+    }
 
   while (transmem_list != NULL)
     {
@@ -51,6 +51,20 @@ DCNGETTEXT (const char *domainname,
   return DCIGETTEXT (domainname, msgid1, msgid2, 1, n, category);
 }
 
+#ifndef _LIBC
+/* Look up MSGID1 in the DOMAINNAME message catalog for the current CATEGORY
+   locale.  MSGID1_HASH is the hash code of MSGID1.  */
+char *
+libintl_dcngettext_hashed (const char *domainname,
+			   const char *msgid1, unsigned long int msgid1_hash,
+			   const char *msgid2, unsigned long int n,
+			   int category)
+{
+  return libintl_dcigettext_hashed (domainname, msgid1, msgid1_hash, msgid2,
+				    1, n, category);
+}
+#endif
+
 #ifdef _LIBC
 /* Alias for function name in GNU C Library.  */
 weak_alias (__dcngettext, dcngettext);
@@ -106,3 +106,127 @@ plural_eval (const struct expression *pexp, unsigned long int n)
   /* NOTREACHED */
   return 0;
 }
+
+/* Evaluate the compiled plural expression and return an index value.
+   The result is the same as that of plural_eval on the expression that
+   was compiled.  */
+STATIC
+unsigned long int
+internal_function
+plural_eval_program (const struct plural_program *prog, unsigned long int n)
+{
+  unsigned long int stack[PLURAL_STACK_MAX];
+  unsigned long int *sp;
+  unsigned long int acc;
+  const struct plural_instruction *code;
+  const struct plural_instruction *ip;
+
+  if (prog->formula != NULL)
+    return prog->formula (n);
+
+  sp = stack;
+  acc = 0;
+  code = prog->code;
+  for (ip = code; ; ip++)
+    {
+      unsigned long int leftarg;
+      unsigned long int rightarg;
+
+      switch (ip->opcode)
+	{
+	case pl_var:
+	  if (ip->flags & PLURAL_PUSH)
+	    *sp++ = acc;
+	  acc = n;
+	  continue;
+	case pl_num:
+	  if (ip->flags & PLURAL_PUSH)
+	    *sp++ = acc;
+	  acc = ip->arg;
+	  continue;
+	case pl_lnot:
+	  acc = ! acc;
+	  continue;
+	case pl_bool:
+	  acc = (acc != 0);
+	  continue;
+	case pl_jump:
+	  ip = code + ip->arg - 1;
+	  continue;
+	case pl_jump_if_zero:
+	  if (acc == 0)
+	    ip = code + ip->arg - 1;
+	  continue;
+	case pl_lor:
+	  if (acc != 0)
+	    {
+	      acc = 1;
+	      ip = code + ip->arg - 1;
+	    }
+	  continue;
+	case pl_return:
+	  return acc;
+	default:
+	  break;
+	}
+
+      /* A binary operator.  */
+      if (ip->flags & PLURAL_IMMEDIATE)
+	{
+	  leftarg = acc;
+	  rightarg = ip->arg;
+	}
+      else
+	{
+	  leftarg = *--sp;
+	  rightarg = acc;
+	}
+      switch (ip->opcode)
+	{
+	case pl_mult:
+	  acc = leftarg * rightarg;
+	  break;
+	case pl_divide:
+#if !INTDIV0_RAISES_SIGFPE
+	  if (rightarg == 0)
+	    raise (SIGFPE);
+#endif
+	  acc = leftarg / rightarg;
+	  break;
+	case pl_module:
+#if !INTDIV0_RAISES_SIGFPE
+	  if (rightarg == 0)
+	    raise (SIGFPE);
+#endif
+	  acc = leftarg % rightarg;
+	  break;
+	case pl_plus:
+	  acc = leftarg + rightarg;
+	  break;
+	case pl_minus:
+	  acc = leftarg - rightarg;
+	  break;
+	case pl_less_than:
+	  acc = leftarg < rightarg;
+	  break;
+	case pl_greater_than:
+	  acc = leftarg > rightarg;
+	  break;
+	case pl_less_or_equal:
+	  acc = leftarg <= rightarg;
+	  break;
+	case pl_greater_or_equal:
+	  acc = leftarg >= rightarg;
+	  break;
+	case pl_equal:
+	  acc = leftarg == rightarg;
+	  break;
+	case pl_not_equal:
+	  acc = leftarg != rightarg;
+	  break;
+	default:
+	  /* NOTREACHED */
+	  return 0;
+	}
+    }
+}
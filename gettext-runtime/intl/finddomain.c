@@ -52,6 +52,9 @@
 /* List of already loaded domains.  */
 static struct loaded_l10nfile *_nl_loaded_domains;
 
+/* We need to protect modifying the _NL_LOADED_DOMAINS data.  */
+gl_rwlock_define_initialized (static, lock)
+
 
 /* Return a data structure describing the message catalog described by
    the DOMAINNAME and CATEGORY parameters with respect to the currently
@@ -84,8 +87,6 @@ _nl_find_domain (const char *dirname, char *locale,
 		(4) modifier
    */
 
-  /* We need to protect modifying the _NL_LOADED_DOMAINS data.  */
-  gl_rwlock_define_initialized (static, lock);
   gl_rwlock_rdlock (lock);
 
   /* If we have already tested for this locale entry there has to
@@ -191,6 +192,44 @@ out:
 }
 
 
+#ifndef _LIBC
+/* Return a freshly allocated array of the entries of the list of loaded
+   domains that designate a catalog file, and store its size in *COUNTP.
+   The entries themselves stay valid until the end of the program.  Return
+   NULL if memory is exhausted.  */
+struct loaded_l10nfile **
+internal_function
+_nl_loaded_domain_files (size_t *countp)
+{
+  struct loaded_l10nfile **result;
+  struct loaded_l10nfile *runp;
+  size_t count;
+
+  gl_rwlock_rdlock (lock);
+
+  count = 0;
+  for (runp = _nl_loaded_domains; runp != NULL; runp = runp->next)
+    if (runp->filename != NULL)
+      count++;
+
+  result = (struct loaded_l10nfile **)
+	   malloc ((count > 0 ? count : 1) * sizeof (struct loaded_l10nfile *));
+  if (result != NULL)
+    {
+      count = 0;
+      for (runp = _nl_loaded_domains; runp != NULL; runp = runp->next)
+	if (runp->filename != NULL)
+	  result[count++] = runp;
+      *countp = count;
+    }
+
+  gl_rwlock_unlock (lock);
+
+  return result;
+}
+#endif
+
+
 #ifdef _LIBC
 /* This is called from iconv/gconv_db.c's free_mem, as locales must
    be freed before freeing gconv steps arrays.  */
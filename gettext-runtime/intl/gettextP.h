@@ -21,6 +21,10 @@
 #define _GETTEXTP_H
 
 #include <stddef.h>		/* Get size_t.  */
+#ifndef _LIBC
+# include <sys/types.h>	/* Get dev_t, ino_t, off_t.  */
+# include <time.h>		/* Get time_t.  */
+#endif
 
 #ifdef _LIBC
 # include "../iconv/gconv_int.h"
@@ -81,6 +85,12 @@ extern char *libintl_dcigettext (const char *__domainname,
 				 const char *__msgid1, const char *__msgid2,
 				 int __plural, unsigned long int __n,
 				 int __category);
+extern char *libintl_dcigettext_hashed (const char *__domainname,
+					const char *__msgid1,
+					unsigned long int __msgid1_hash,
+					const char *__msgid2,
+					int __plural, unsigned long int __n,
+					int __category);
 # endif
 #endif
 
@@ -140,7 +150,7 @@ struct sysdep_string_desc
    basis.  */
 struct converted_domain
 {
-  /* The target encoding name.  */
+  /* The target encoding name, as returned by _nl_intern_encoding.  */
   const char *encoding;
   /* The descriptor for conversion from the message catalog's encoding to
      this target encoding.  */
@@ -197,6 +207,17 @@ struct loaded_domain
 
   const struct expression *plural;
   unsigned long int nplurals;
+  /* PLURAL, compiled for faster evaluation, or NULL.  */
+  struct plural_program *plural_program;
+
+#ifndef _LIBC
+  /* Identity of the file when it was loaded, for detecting that it has been
+     replaced or modified.  */
+  dev_t file_dev;
+  ino_t file_ino;
+  off_t file_size;
+  time_t file_mtime;
+#endif
 };
 
 /* We want to allocate a string at the end of the struct.  But ISO C
@@ -214,6 +235,10 @@ struct binding
   struct binding *next;
   char *dirname;
   char *codeset;
+#if defined _LIBC || HAVE_ICONV
+  /* CODESET as returned by _nl_intern_encoding, or NULL.  */
+  const char *encoding;
+#endif
   char domainname[ZERO];
 };
 
@@ -261,6 +286,38 @@ struct loaded_l10nfile *_nl_find_domain (const char *__dirname, char *__locale,
 void _nl_load_domain (struct loaded_l10nfile *__domain,
 		      struct binding *__domainbinding)
      internal_function;
+void _nl_prefault_domain (struct loaded_domain *__domain)
+     internal_function;
+#if defined _LIBC || HAVE_ICONV
+/* Return the unique copy of the encoding name ENCODING, or NULL if memory
+   is exhausted.  */
+extern const char *_nl_intern_encoding (const char *encoding)
+     attribute_hidden;
+#endif
+/* Free the memory of the table of known translations that is no longer
+   used.  The caller must hold _nl_state_lock for writing.  */
+extern void _nl_reclaim_known_translations (void) attribute_hidden;
+#ifndef _LIBC
+struct loaded_l10nfile **_nl_loaded_domain_files (size_t *__countp)
+     internal_function;
+struct loaded_domain *_nl_reload_domain (struct loaded_l10nfile *__domain)
+     internal_function;
+#endif
+
+#if !defined _LIBC && !defined IN_LIBGLOCALE
+/* In stats.c.  */
+/* How a lookup ended.  */
+# define STATISTICS_CACHE_HIT 0		/* found among the known translations */
+# define STATISTICS_TRANSLATED 1	/* found in a catalog */
+# define STATISTICS_UNTRANSLATED 2	/* not found */
+extern int _nl_statistics_init (const char *__filename, int __per_msgid);
+extern void _nl_statistics_record (const char *__domainname,
+				   const char *__msgid,
+				   unsigned long int __msgid_hash,
+				   int __outcome,
+				   unsigned int __catalog_misses,
+				   unsigned long int __conversions);
+#endif
 
 #ifdef IN_LIBGLOCALE
 char *_nl_find_msg (struct loaded_l10nfile *domain_file,
@@ -0,0 +1,93 @@
+/* Compile-time hash codes of message ids, for C++.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Library General Public License as published
+   by the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,
+   USA.  */
+
+#ifndef _LIBINTL_HASH_H
+#define _LIBINTL_HASH_H 1
+
+#if defined __cplusplus && __cplusplus >= 201103L
+
+#include <libintl.h>
+
+/* The hash code of a string, as used in the hash table of a message catalog
+   and by dcgettext_hashed and dcngettext_hashed.  This is the 'hashpjw'
+   function by P.J. Weinberger, with the same result as the function in
+   libintl.  */
+
+namespace libintl_hash_detail
+{
+  /* Fold the bits 28..31 of HVAL back into the lower bits.  */
+  constexpr unsigned long int
+  fold (unsigned long int hval)
+  {
+    return hval
+           ^ ((hval & ((unsigned long int) 0xf << 28)) >> 24)
+           ^ (hval & ((unsigned long int) 0xf << 28));
+  }
+}
+
+#if __cplusplus >= 201402L
+constexpr unsigned long int
+libintl_msgid_hash (const char *str)
+{
+  unsigned long int hval = 0;
+  while (*str != '\0')
+    hval = libintl_hash_detail::fold ((hval << 4) + (unsigned char) *str++);
+  return hval;
+}
+#else
+/* C++11 allows only a single return statement; this recursion is limited
+   by the constexpr nesting depth of the compiler (512 in GCC), i.e. by the
+   length of the string.  */
+constexpr unsigned long int
+libintl_msgid_hash (const char *str, unsigned long int hval = 0)
+{
+  return (*str == '\0'
+          ? hval
+          : libintl_msgid_hash (str + 1,
+                                libintl_hash_detail::fold
+                                  ((hval << 4) + (unsigned char) *str)));
+}
+#endif
+
+/* Force the computation of the hash code of the string literal MSGID at
+   compile time.  */
+template <unsigned long int Hash>
+struct libintl_hash_constant
+{
+  static constexpr unsigned long int value = Hash;
+};
+#define libintl_hash_literal(Msgid) \
+  (libintl_hash_constant<libintl_msgid_hash (Msgid)>::value)
+
+/* Variants of gettext, dgettext, ngettext and dngettext for string literals,
+   whose hash code is computed at compile time.  */
+#define gettext_hashed(Msgid) \
+  dcgettext_hashed (NULL, Msgid, libintl_hash_literal (Msgid), LC_MESSAGES)
+#define dgettext_hashed(Domainname, Msgid) \
+  dcgettext_hashed (Domainname, Msgid, libintl_hash_literal (Msgid), \
+                    LC_MESSAGES)
+#define ngettext_hashed(Msgid1, Msgid2, N) \
+  dcngettext_hashed (NULL, Msgid1, libintl_hash_literal (Msgid1), Msgid2, \
+                     N, LC_MESSAGES)
+#define dngettext_hashed(Domainname, Msgid1, Msgid2, N) \
+  dcngettext_hashed (Domainname, Msgid1, libintl_hash_literal (Msgid1), \
+                     Msgid2, N, LC_MESSAGES)
+
+#endif
+
+#endif /* _LIBINTL_HASH_H */
@@ -56,6 +56,7 @@ char *alloca ();
 # endif
 #endif
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -63,6 +64,13 @@ char *alloca ();
 # include <unistd.h>
 #endif
 
+#if HAVE_DIRENT_H && !defined _LIBC
+# include <dirent.h>
+# define USE_DIRECTORY_INDEX 1
+#else
+# define USE_DIRECTORY_INDEX 0
+#endif
+
 #ifdef _LIBC
 # include <langinfo.h>
 # include <locale.h>
@@ -773,6 +781,219 @@ get_sysdep_segment_value (const char *name)
   return NULL;
 }
 
+#if USE_DIRECTORY_INDEX
+
+/* Before a catalog is opened, the name of its locale directory, such as
+   "de_DE.UTF-8" in DIR/de_DE.UTF-8/LC_MESSAGES/DOMAIN.mo, is looked up in
+   an index of the entries of DIR.  For most variants of a locale name no
+   such directory exists, and the failed open() calls would dominate the
+   cost of the first lookups in a program.  The index of a directory is
+   made with a single opendir/readdir pass, and is made anew after a call
+   to textdomain or bindtextdomain, because a program may install catalogs
+   at run time.  All accesses are protected by load_lock.  */
+struct directory_index
+{
+  struct directory_index *next;
+  /* Value of _nl_msg_cat_cntr when the index was made.  */
+  int counter;
+  /* 1 if the directory does not exist, 0 if ENTRIES is valid, -1 if the
+     directory could not be read.  */
+  int state;
+  /* The entries of the directory, sorted with compare_entry_names.  */
+  char **entries;
+  size_t nentries;
+  char dirname[ZERO];
+};
+
+static struct directory_index *directory_indexes;
+
+/* Compare two directory entry names, ignoring the case of ASCII letters,
+   because the file system may do the same.  */
+static int
+compare_entry_names (const char *s1, const char *s2)
+{
+  for (;; s1++, s2++)
+    {
+      unsigned char c1 = *s1;
+      unsigned char c2 = *s2;
+
+      if (c1 >= 'A' && c1 <= 'Z')
+	c1 += 'a' - 'A';
+      if (c2 >= 'A' && c2 <= 'Z')
+	c2 += 'a' - 'A';
+      if (c1 != c2 || c1 == '\0')
+	return (int) c1 - (int) c2;
+    }
+}
+
+static int
+compare_entries (const void *p1, const void *p2)
+{
+  return compare_entry_names (*(char * const *) p1, *(char * const *) p2);
+}
+
+/* Fill INDEX with the entries of the directory INDEX->dirname.  */
+static void
+read_directory_index (struct directory_index *index)
+{
+  DIR *dirp;
+  struct dirent *dp;
+  size_t allocated = 0;
+
+  index->counter = _nl_msg_cat_cntr;
+  index->state = -1;
+  index->nentries = 0;
+
+  dirp = opendir (index->dirname[0] != '\0' ? index->dirname : "/");
+  if (dirp == NULL)
+    {
+      if (errno == ENOENT || errno == ENOTDIR)
+	index->state = 1;
+      return;
+    }
+
+  while ((dp = readdir (dirp)) != NULL)
+    {
+      char *name;
+
+      if (dp->d_name[0] == '.'
+	  && (dp->d_name[1] == '\0'
+	      || (dp->d_name[1] == '.' && dp->d_name[2] == '\0')))
+	continue;
+
+      if (index->nentries == allocated)
+	{
+	  size_t new_allocated = 2 * allocated + 64;
+	  char **new_entries =
+	    (char **) realloc (index->entries, new_allocated * sizeof (char *));
+
+	  if (new_entries == NULL)
+	    goto fail;
+	  index->entries = new_entries;
+	  allocated = new_allocated;
+	}
+      {
+	size_t len = strlen (dp->d_name) + 1;
+
+	name = (char *) malloc (len);
+	if (name == NULL)
+	  goto fail;
+	memcpy (name, dp->d_name, len);
+      }
+      index->entries[index->nentries++] = name;
+    }
+
+  closedir (dirp);
+  qsort (index->entries, index->nentries, sizeof (char *), compare_entries);
+  index->state = 0;
+  return;
+
+ fail:
+  closedir (dirp);
+  while (index->nentries > 0)
+    free (index->entries[--index->nentries]);
+}
+
+/* Return 0 if the catalog FILENAME, of the form
+   DIR/LOCALE/CATEGORY/DOMAIN.mo, cannot exist because DIR has no entry
+   LOCALE, or 1 if it may exist.  */
+static int
+catalog_may_exist (const char *filename)
+{
+  const char *end = filename + strlen (filename);
+  const char *locale_start;
+  const char *locale_end;
+  size_t dirname_len;
+  struct directory_index *index;
+  int slashes;
+
+  /* Find the last three slashes.  */
+  locale_end = NULL;
+  slashes = 0;
+  for (locale_start = end; locale_start > filename; locale_start--)
+    if (locale_start[-1] == '/')
+      {
+	if (++slashes == 2)
+	  locale_end = locale_start - 1;
+	else if (slashes == 3)
+	  break;
+      }
+  if (slashes < 3)
+    return 1;
+
+  /* Don't try to be clever with unusual locale names.  */
+  {
+    const char *p;
+
+    if (locale_start == locale_end)
+      return 1;
+    for (p = locale_start; p < locale_end; p++)
+      if (*p == '\\' || (unsigned char) *p >= 0x80)
+	return 1;
+  }
+
+  dirname_len = locale_start - 1 - filename;
+  for (index = directory_indexes; index != NULL; index = index->next)
+    if (strncmp (index->dirname, filename, dirname_len) == 0
+	&& index->dirname[dirname_len] == '\0')
+      break;
+
+  if (index == NULL)
+    {
+      index = (struct directory_index *)
+	malloc (offsetof (struct directory_index, dirname) + dirname_len + 1);
+      if (index == NULL)
+	return 1;
+      memcpy (index->dirname, filename, dirname_len);
+      index->dirname[dirname_len] = '\0';
+      index->entries = NULL;
+      index->nentries = 0;
+      read_directory_index (index);
+      index->next = directory_indexes;
+      directory_indexes = index;
+    }
+  else if (index->counter != _nl_msg_cat_cntr)
+    {
+      while (index->nentries > 0)
+	free (index->entries[--index->nentries]);
+      read_directory_index (index);
+    }
+
+  if (index->state != 0)
+    return index->state < 0;
+
+  {
+    size_t locale_len = locale_end - locale_start;
+    char *locale = (char *) malloc (locale_len + 1);
+    int found;
+
+    if (locale == NULL)
+      return 1;
+    memcpy (locale, locale_start, locale_len);
+    locale[locale_len] = '\0';
+    found = (bsearch (&locale, index->entries, index->nentries,
+		      sizeof (char *), compare_entries)
+	     != NULL);
+    free (locale);
+    return found;
+  }
+}
+
+/* Make the indexes of the directories anew at their next use.  */
+static void
+invalidate_directory_indexes (void)
+{
+  struct directory_index *index;
+
+  for (index = directory_indexes; index != NULL; index = index->next)
+    index->counter = _nl_msg_cat_cntr - 1;
+}
+
+#endif
+
+/* Lock that serializes the loading of message catalogs.  */
+__libc_lock_define_initialized_recursive (static, load_lock)
+
 /* Load the message catalogs specified by FILENAME.  If it is no valid
    message catalog do nothing.  */
 void
@@ -780,7 +1001,6 @@ internal_function
 _nl_load_domain (struct loaded_l10nfile *domain_file,
 		 struct binding *domainbinding)
 {
-  __libc_lock_define_initialized_recursive (static, lock)
   int fd = -1;
   size_t size;
 #ifdef _LIBC
@@ -795,7 +1015,7 @@ _nl_load_domain (struct loaded_l10nfile *domain_file,
   const char *nullentry;
   size_t nullentrylen;
 
-  __libc_lock_lock_recursive (lock);
+  __libc_lock_lock_recursive (load_lock);
   if (domain_file->decided != 0)
     {
       /* There are two possibilities:
@@ -824,6 +1044,12 @@ _nl_load_domain (struct loaded_l10nfile *domain_file,
   if (domain_file->filename == NULL)
     goto out;
 
+#if USE_DIRECTORY_INDEX
+  /* Avoid a failed open() if the locale directory does not exist.  */
+  if (!catalog_may_exist (domain_file->filename))
+    goto out;
+#endif
+
   /* Try to open the addressed file.  */
   fd = open (domain_file->filename, O_RDONLY | O_BINARY);
   if (fd == -1)
@@ -913,6 +1139,12 @@ _nl_load_domain (struct loaded_l10nfile *domain_file,
   domain->use_mmap = use_mmap;
   domain->mmap_size = size;
   domain->must_swap = data->magic != _MAGIC;
+#ifndef _LIBC
+  domain->file_dev = st.st_dev;
+  domain->file_ino = st.st_ino;
+  domain->file_size = st.st_size;
+  domain->file_mtime = st.st_mtime;
+#endif
   domain->malloced = NULL;
 
   /* Fill in the information about the available tables.  */
@@ -1284,6 +1516,7 @@ _nl_load_domain (struct loaded_l10nfile *domain_file,
   nullentry = _nl_find_msg (domain_file, domainbinding, "", 0, &nullentrylen);
 #endif
   EXTRACT_PLURAL_EXPRESSION (nullentry, &domain->plural, &domain->nplurals);
+  domain->plural_program = COMPILE_PLURAL_EXPRESSION (domain->plural);
 
  out:
   if (fd != -1)
@@ -1292,7 +1525,82 @@ _nl_load_domain (struct loaded_l10nfile *domain_file,
   domain_file->decided = 1;
 
  done:
-  __libc_lock_unlock_recursive (lock);
+  __libc_lock_unlock_recursive (load_lock);
+}
+
+
+#ifndef _LIBC
+/* Check whether the file of DOMAIN_FILE has been replaced or modified since
+   it was loaded, or has appeared since it was found missing.  If so, load
+   it and return its new contents, without installing them in DOMAIN_FILE.
+   Otherwise, or if the file cannot be loaded, return NULL.  */
+struct loaded_domain *
+internal_function
+_nl_reload_domain (struct loaded_l10nfile *domain_file)
+{
+  const struct loaded_domain *old_domain;
+  struct loaded_l10nfile new_file;
+  struct stat st;
+
+  if (domain_file->filename == NULL
+      || stat (domain_file->filename, &st) != 0)
+    return NULL;
+
+  __libc_lock_lock_recursive (load_lock);
+
+  new_file.data = NULL;
+
+  /* Leave catalogs that are being loaded to _nl_load_domain.  */
+  if (domain_file->decided <= 0)
+    goto done;
+
+  old_domain = (const struct loaded_domain *) domain_file->data;
+  if (old_domain != NULL
+      && st.st_dev == old_domain->file_dev
+      && st.st_ino == old_domain->file_ino
+      && st.st_size == old_domain->file_size
+      && st.st_mtime == old_domain->file_mtime)
+    goto done;
+
+  /* Load the file into a private copy of DOMAIN_FILE, so that lookups in
+     DOMAIN_FILE can go on meanwhile.  */
+  new_file.filename = domain_file->filename;
+  new_file.decided = 0;
+  new_file.next = NULL;
+  new_file.successor[0] = NULL;
+#if USE_DIRECTORY_INDEX
+  /* The file exists, but its locale directory may have been created after
+     the index of its parent directory was made.  */
+  invalidate_directory_indexes ();
+#endif
+  _nl_load_domain (&new_file, NULL);
+
+ done:
+  __libc_lock_unlock_recursive (load_lock);
+  return (struct loaded_domain *) new_file.data;
+}
+#endif
+
+
+/* Bring all pages of the message catalog DOMAIN into memory, so that
+   later lookups in it don't cause page faults.  */
+void
+internal_function
+_nl_prefault_domain (struct loaded_domain *domain)
+{
+  const volatile char *data = domain->data;
+  size_t size = domain->mmap_size;
+  size_t i;
+
+#if defined HAVE_MMAP && HAVE_MADVISE && defined MADV_WILLNEED
+  /* Let the kernel read the whole file at once.  */
+  if (domain->use_mmap)
+    madvise ((void *) domain->data, size, MADV_WILLNEED);
+#endif
+
+  /* Touch every page.  4096 is the smallest page size in use.  */
+  for (i = 0; i < size; i += 4096)
+    (void) data[i];
 }
 
 
@@ -1305,12 +1613,12 @@ _nl_unload_domain (struct loaded_domain *domain)
 
   if (domain->plural != &__gettext_germanic_plural)
     __gettext_free_exp ((struct expression *) domain->plural);
+  free (domain->plural_program);
 
   for (i = 0; i < domain->nconversions; i++)
     {
       struct converted_domain *convd = &domain->conversions[i];
 
-      free (convd->encoding);
       if (convd->conv_tab != NULL && convd->conv_tab != (char **) -1)
 	free (convd->conv_tab);
       if (convd->conv != (__gconv_t) -1)
@@ -153,3 +153,345 @@ EXTRACT_PLURAL_EXPRESSION (const char *nullentry,
       *npluralsp = 2;
     }
 }
+
+
+/* Functions for the plural expressions that are in common use; see the
+   table in the "Plural forms" node of the GNU gettext manual.  */
+
+static unsigned long int
+plural_only_one_form (unsigned long int n)
+{
+  return 0;
+}
+
+static unsigned long int
+plural_one_other (unsigned long int n)
+{
+  return n != 1;
+}
+
+static unsigned long int
+plural_zero_one_other (unsigned long int n)
+{
+  return n > 1;
+}
+
+static unsigned long int
+plural_latvian (unsigned long int n)
+{
+  return (n % 10 == 1 && n % 100 != 11 ? 0 : n != 0 ? 1 : 2);
+}
+
+static unsigned long int
+plural_lithuanian (unsigned long int n)
+{
+  return (n % 10 == 1 && n % 100 != 11 ? 0
+	  : n % 10 >= 2 && (n % 100 < 10 || n % 100 >= 20) ? 1
+	  : 2);
+}
+
+static unsigned long int
+plural_russian (unsigned long int n)
+{
+  return (n % 10 == 1 && n % 100 != 11 ? 0
+	  : n % 10 >= 2 && n % 10 <= 4 && (n % 100 < 10 || n % 100 >= 20) ? 1
+	  : 2);
+}
+
+static unsigned long int
+plural_polish (unsigned long int n)
+{
+  return (n == 1 ? 0
+	  : n % 10 >= 2 && n % 10 <= 4 && (n % 100 < 10 || n % 100 >= 20) ? 1
+	  : 2);
+}
+
+static unsigned long int
+plural_czech (unsigned long int n)
+{
+  return (n == 1 ? 0 : n >= 2 && n <= 4 ? 1 : 2);
+}
+
+static unsigned long int
+plural_romanian (unsigned long int n)
+{
+  return (n == 1 ? 0 : n == 0 || (n % 100 > 0 && n % 100 < 20) ? 1 : 2);
+}
+
+static unsigned long int
+plural_irish (unsigned long int n)
+{
+  return (n == 1 ? 0 : n == 2 ? 1 : 2);
+}
+
+static unsigned long int
+plural_slovenian (unsigned long int n)
+{
+  return (n % 100 == 1 ? 0
+	  : n % 100 == 2 ? 1
+	  : n % 100 == 3 || n % 100 == 4 ? 2
+	  : 3);
+}
+
+static unsigned long int
+plural_arabic (unsigned long int n)
+{
+  return (n == 0 ? 0
+	  : n == 1 ? 1
+	  : n == 2 ? 2
+	  : n % 100 >= 3 && n % 100 <= 10 ? 3
+	  : n % 100 >= 11 ? 4
+	  : 5);
+}
+
+static const struct
+{
+  const char *expression;
+  unsigned long int (*formula) (unsigned long int n);
+}
+known_plurals[] =
+{
+  { "0", plural_only_one_form },
+  { "n != 1", plural_one_other },
+  { "n == 1 ? 0 : 1", plural_one_other },
+  { "n > 1", plural_zero_one_other },
+  { "n%10==1 && n%100!=11 ? 0 : n != 0 ? 1 : 2", plural_latvian },
+  { "n%10==1 && n%100!=11 ? 0 : n%10>=2 && (n%100<10 || n%100>=20) ? 1 : 2",
+    plural_lithuanian },
+  { "n%10==1 && n%100!=11 ? 0"
+    " : n%10>=2 && n%10<=4 && (n%100<10 || n%100>=20) ? 1 : 2",
+    plural_russian },
+  { "n==1 ? 0 : n%10>=2 && n%10<=4 && (n%100<10 || n%100>=20) ? 1 : 2",
+    plural_polish },
+  { "n==1 ? 0 : n>=2 && n<=4 ? 1 : 2", plural_czech },
+  { "n==1 ? 0 : n==0 || (n%100 > 0 && n%100 < 20) ? 1 : 2", plural_romanian },
+  { "n==1 ? 0 : n==2 ? 1 : 2", plural_irish },
+  { "n%100==1 ? 0 : n%100==2 ? 1 : n%100==3 || n%100==4 ? 2 : 3",
+    plural_slovenian },
+  { "n==0 ? 0 : n==1 ? 1 : n==2 ? 2"
+    " : n%100>=3 && n%100<=10 ? 3 : n%100>=11 ? 4 : 5",
+    plural_arabic }
+};
+
+/* Return nonzero if the expressions EXP1 and EXP2 are the same.  */
+static int
+expression_equal (const struct expression *exp1,
+		  const struct expression *exp2)
+{
+  int i;
+
+  if (exp1->nargs != exp2->nargs || exp1->operation != exp2->operation)
+    return 0;
+  if (exp1->nargs == 0)
+    return exp1->operation != num || exp1->val.num == exp2->val.num;
+  for (i = 0; i < exp1->nargs; i++)
+    if (!expression_equal (exp1->val.args[i], exp2->val.args[i]))
+      return 0;
+  return 1;
+}
+
+/* Return the number of nodes of the expression EXP.  */
+static size_t
+expression_size (const struct expression *exp)
+{
+  size_t size = 1;
+  int i;
+
+  for (i = 0; i < exp->nargs; i++)
+    size += expression_size (exp->val.args[i]);
+  return size;
+}
+
+/* State during the translation of an expression into a plural program.  */
+struct plural_compiler
+{
+  struct plural_instruction *code;
+  size_t length;
+  unsigned int depth;
+  int failed;
+};
+
+/* Append an instruction to PC->code and return its index.  */
+static size_t
+emit_instruction (struct plural_compiler *pc, enum plural_opcode opcode,
+		  int flags, unsigned long int arg)
+{
+  struct plural_instruction *insn = &pc->code[pc->length];
+
+  insn->opcode = opcode;
+  insn->flags = flags;
+  insn->arg = arg;
+  return pc->length++;
+}
+
+/* Append the instructions that evaluate EXP into the accumulator.  If LIVE
+   is nonzero, the accumulator holds a value that must be pushed onto the
+   stack first.  At most 2 instructions are emitted per node of EXP.  */
+static void
+compile_expression (struct plural_compiler *pc, const struct expression *exp,
+		    int live)
+{
+  size_t jump1;
+  size_t jump2;
+
+  switch (exp->nargs)
+    {
+    case 0:
+      if (live)
+	{
+	  if (++pc->depth > PLURAL_STACK_MAX)
+	    pc->failed = 1;
+	}
+      if (exp->operation == var)
+	emit_instruction (pc, pl_var, live ? PLURAL_PUSH : 0, 0);
+      else
+	emit_instruction (pc, pl_num, live ? PLURAL_PUSH : 0, exp->val.num);
+      break;
+
+    case 1:
+      /* exp->operation must be lnot.  */
+      compile_expression (pc, exp->val.args[0], live);
+      emit_instruction (pc, pl_lnot, 0, 0);
+      break;
+
+    case 2:
+      if (exp->operation == land || exp->operation == lor)
+	{
+	  compile_expression (pc, exp->val.args[0], live);
+	  jump1 = emit_instruction (pc,
+				    exp->operation == land
+				    ? pl_jump_if_zero : pl_lor,
+				    0, 0);
+	  compile_expression (pc, exp->val.args[1], 0);
+	  emit_instruction (pc, pl_bool, 0, 0);
+	  pc->code[jump1].arg = pc->length;
+	}
+      else
+	{
+	  enum plural_opcode opcode;
+	  const struct expression *right = exp->val.args[1];
+
+	  switch (exp->operation)
+	    {
+	    case mult:
+	      opcode = pl_mult;
+	      break;
+	    case divide:
+	      opcode = pl_divide;
+	      break;
+	    case module:
+	      opcode = pl_module;
+	      break;
+	    case plus:
+	      opcode = pl_plus;
+	      break;
+	    case minus:
+	      opcode = pl_minus;
+	      break;
+	    case less_than:
+	      opcode = pl_less_than;
+	      break;
+	    case greater_than:
+	      opcode = pl_greater_than;
+	      break;
+	    case less_or_equal:
+	      opcode = pl_less_or_equal;
+	      break;
+	    case greater_or_equal:
+	      opcode = pl_greater_or_equal;
+	      break;
+	    case equal:
+	      opcode = pl_equal;
+	      break;
+	    case not_equal:
+	      opcode = pl_not_equal;
+	      break;
+	    default:
+	      pc->failed = 1;
+	      return;
+	    }
+
+	  compile_expression (pc, exp->val.args[0], live);
+	  if (right->nargs == 0 && right->operation == num)
+	    emit_instruction (pc, opcode, PLURAL_IMMEDIATE, right->val.num);
+	  else
+	    {
+	      compile_expression (pc, right, 1);
+	      emit_instruction (pc, opcode, 0, 0);
+	      pc->depth--;
+	    }
+	}
+      break;
+
+    case 3:
+      /* exp->operation must be qmop.  */
+      compile_expression (pc, exp->val.args[0], live);
+      jump1 = emit_instruction (pc, pl_jump_if_zero, 0, 0);
+      compile_expression (pc, exp->val.args[1], 0);
+      jump2 = emit_instruction (pc, pl_jump, 0, 0);
+      pc->code[jump1].arg = pc->length;
+      compile_expression (pc, exp->val.args[2], 0);
+      pc->code[jump2].arg = pc->length;
+      break;
+
+    default:
+      pc->failed = 1;
+      break;
+    }
+}
+
+struct plural_program *
+internal_function
+COMPILE_PLURAL_EXPRESSION (const struct expression *exp)
+{
+  struct plural_program *prog;
+  struct plural_compiler pc;
+  size_t i;
+
+  /* Look whether EXP is one of the well-known plural expressions.  */
+  for (i = 0; i < sizeof (known_plurals) / sizeof (known_plurals[0]); i++)
+    {
+      struct parse_args args;
+
+      args.cp = known_plurals[i].expression;
+      if (PLURAL_PARSE (&args) == 0)
+	{
+	  int equal = expression_equal (args.res, exp);
+
+	  FREE_EXPRESSION (args.res);
+	  if (equal)
+	    {
+	      prog = (struct plural_program *) malloc (sizeof (*prog));
+	      if (prog == NULL)
+		return NULL;
+	      prog->formula = known_plurals[i].formula;
+	      prog->code = NULL;
+	      return prog;
+	    }
+	}
+    }
+
+  /* Otherwise translate EXP into instructions.  The program and its
+     instructions are allocated in a single block.  */
+  prog =
+    (struct plural_program *)
+    malloc (sizeof (struct plural_program)
+	    + (2 * expression_size (exp) + 1)
+	      * sizeof (struct plural_instruction));
+  if (prog == NULL)
+    return NULL;
+  pc.code = (struct plural_instruction *) (prog + 1);
+  pc.length = 0;
+  pc.depth = 0;
+  pc.failed = 0;
+  compile_expression (&pc, exp, 0);
+  if (pc.failed)
+    {
+      free (prog);
+      return NULL;
+    }
+  emit_instruction (&pc, pl_return, 0, 0);
+  prog->formula = NULL;
+  prog->code = pc.code;
+  return prog;
+}
@@ -79,6 +79,63 @@ struct parse_args
   struct expression *res;
 };
 
+/* A plural expression can be translated into a program for a small stack
+   machine, which is faster to evaluate than the tree of struct expression.
+   The machine has an accumulator, which holds the value of the innermost
+   subexpression evaluated so far, and a stack of pending left operands.  */
+enum plural_opcode
+{
+  pl_var,			/* Load "n" into the accumulator.  */
+  pl_num,			/* Load ARG into the accumulator.  */
+  pl_lnot,			/* Logical NOT of the accumulator.  */
+  pl_bool,			/* Normalize the accumulator to 0 or 1.  */
+  pl_mult,			/* Binary operators: the left operand is popped
+				   from the stack, or the accumulator if the
+				   right operand is immediate; the right operand
+				   is ARG if immediate, the accumulator
+				   otherwise.  */
+  pl_divide,
+  pl_module,
+  pl_plus,
+  pl_minus,
+  pl_less_than,
+  pl_greater_than,
+  pl_less_or_equal,
+  pl_greater_or_equal,
+  pl_equal,
+  pl_not_equal,
+  pl_jump,			/* Continue at instruction ARG.  */
+  pl_jump_if_zero,		/* Continue at instruction ARG if the
+				   accumulator is 0.  */
+  pl_lor,			/* If the accumulator is nonzero, set it to 1
+				   and continue at instruction ARG.  */
+  pl_return			/* Return the accumulator.  */
+};
+
+/* Flags of an instruction.  */
+#define PLURAL_PUSH	1	/* pl_var, pl_num: push the accumulator
+				   first.  */
+#define PLURAL_IMMEDIATE 2	/* Binary operator with immediate right
+				   operand.  */
+
+struct plural_instruction
+{
+  unsigned char opcode;		/* enum plural_opcode */
+  unsigned char flags;
+  unsigned long int arg;
+};
+
+/* Maximum depth of the stack of a plural program.  */
+#define PLURAL_STACK_MAX 32
+
+struct plural_program
+{
+  /* For well-known plural expressions: a function that evaluates it.  */
+  unsigned long int (*formula) (unsigned long int n);
+  /* For other plural expressions: the instructions.  */
+  const struct plural_instruction *code;
+};
+
 
 /* Names for the libintl functions are a problem.  This source code is used
    1. in the GNU C Library library,
@@ -95,16 +152,19 @@ struct parse_args
 # define PLURAL_PARSE __gettextparse
 # define GERMANIC_PLURAL __gettext_germanic_plural
 # define EXTRACT_PLURAL_EXPRESSION __gettext_extract_plural
+# define COMPILE_PLURAL_EXPRESSION __gettext_compile_plural
 #elif defined (IN_LIBINTL)
 # define FREE_EXPRESSION libintl_gettext_free_exp
 # define PLURAL_PARSE libintl_gettextparse
 # define GERMANIC_PLURAL libintl_gettext_germanic_plural
 # define EXTRACT_PLURAL_EXPRESSION libintl_gettext_extract_plural
+# define COMPILE_PLURAL_EXPRESSION libintl_gettext_compile_plural
 #else
 # define FREE_EXPRESSION free_plural_expression
 # define PLURAL_PARSE parse_plural_expression
 # define GERMANIC_PLURAL germanic_plural
 # define EXTRACT_PLURAL_EXPRESSION extract_plural_expression
+# define COMPILE_PLURAL_EXPRESSION compile_plural_expression
 #endif
 
 extern void FREE_EXPRESSION (struct expression *exp)
@@ -115,10 +175,19 @@ extern void EXTRACT_PLURAL_EXPRESSION (const char *nullentry,
 				       const struct expression **pluralp,
 				       unsigned long int *npluralsp)
      internal_function;
+/* Translate the plural expression EXP into a program.  Return NULL if EXP
+   is too complex or if memory is exhausted.  The result can be freed with
+   free().  */
+extern struct plural_program *COMPILE_PLURAL_EXPRESSION
+					(const struct expression *exp)
+     internal_function;
 
 #if !defined (_LIBC) && !defined (IN_LIBINTL) && !defined (IN_LIBGLOCALE)
 extern unsigned long int plural_eval (const struct expression *pexp,
 				      unsigned long int n);
+extern unsigned long int plural_eval_program
+					(const struct plural_program *prog,
+					 unsigned long int n);
 #endif
 
 
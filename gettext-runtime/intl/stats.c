@@ -0,0 +1,555 @@
+/* Lookup statistics.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Library General Public License as published
+   by the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,
+   USA.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gettextP.h"
+
+/* The lookups are counted separately in each thread, so that counting
+   needs no lock, except when a thread meets a domain or a msgid for the
+   first time.  The records of all threads are added up when the
+   statistics are written; the counters of threads that are still doing
+   lookups are read without synchronization, therefore such a snapshot is
+   only approximate.  Without thread-local storage, all threads share one
+   set of records, protected by the lock.  */
+
+/* The count of lookups of a msgid.  */
+struct msgid_count
+{
+  unsigned long int hash;
+  unsigned long int count;
+  /* The msgid, including the msgctxt, if any.  */
+  const char *msgid;
+};
+
+/* A hash table of msgid_count entries, with linear probing.  */
+struct msgid_table
+{
+  /* Number of slots.  A power of 2.  */
+  size_t size;
+  /* Number of non-empty slots.  */
+  size_t filled;
+  /* The slots.  */
+  struct msgid_count *slots[ZERO];
+};
+
+/* The statistics of a domain, as counted by one thread.  */
+struct domain_statistics
+{
+  /* Next record of the same thread.  */
+  struct domain_statistics *next;
+  /* Next record in the list of all threads.  */
+  struct domain_statistics *all_next;
+  const char *domainname;
+  unsigned long int lookups;
+  unsigned long int cache_hits;
+  unsigned long int catalog_misses;
+  unsigned long int untranslated;
+  unsigned long int conversions;
+  /* The counts of the msgids, or NULL.  */
+  struct msgid_table *msgids;
+};
+
+/* Initial number of slots of a msgid_table.  */
+#define MSGID_TABLE_INITIAL_SIZE 64
+
+/* Protects the list of all records, the tables of msgids, and the
+   variables below.  */
+__libc_lock_define_initialized (static, lock)
+
+/* The file to which the statistics are written at exit, or NULL if the
+   statistics are not enabled.  */
+static char *statistics_filename;
+
+/* Nonzero if the lookups of each msgid are counted.  */
+static int count_msgids;
+
+/* The records of all threads.  */
+static struct domain_statistics *all_statistics;
+
+/* The records of the current thread.  */
+#if HAVE_THREAD_LOCAL_STORAGE
+static __thread struct domain_statistics *thread_statistics;
+#else
+static struct domain_statistics *thread_statistics;
+#endif
+
+/* Return the record of the current thread for DOMAINNAME, or NULL if
+   memory is exhausted.  */
+static struct domain_statistics *
+get_domain_statistics (const char *domainname)
+{
+  struct domain_statistics *stats;
+  size_t domainname_len;
+
+  for (stats = thread_statistics; stats != NULL; stats = stats->next)
+    if (strcmp (stats->domainname, domainname) == 0)
+      return stats;
+
+  domainname_len = strlen (domainname) + 1;
+  stats = (struct domain_statistics *)
+	  malloc (sizeof (struct domain_statistics) + domainname_len);
+  if (stats == NULL)
+    return NULL;
+  memcpy (stats + 1, domainname, domainname_len);
+  stats->domainname = (const char *) (stats + 1);
+  stats->lookups = 0;
+  stats->cache_hits = 0;
+  stats->catalog_misses = 0;
+  stats->untranslated = 0;
+  stats->conversions = 0;
+  stats->msgids = NULL;
+
+  stats->next = thread_statistics;
+  thread_statistics = stats;
+#if HAVE_THREAD_LOCAL_STORAGE
+  __libc_lock_lock (lock);
+#endif
+  stats->all_next = all_statistics;
+  all_statistics = stats;
+#if HAVE_THREAD_LOCAL_STORAGE
+  __libc_lock_unlock (lock);
+#endif
+
+  return stats;
+}
+
+/* Store ENTRY in TABLE, which has room for it.  */
+static void
+msgid_table_put (struct msgid_table *table, struct msgid_count *entry)
+{
+  size_t mask = table->size - 1;
+  size_t idx;
+
+  for (idx = entry->hash & mask; table->slots[idx] != NULL;
+       idx = (idx + 1) & mask)
+    ;
+  table->slots[idx] = entry;
+  table->filled++;
+}
+
+/* Add a new entry for MSGID to the table of STATS.  Must be called with
+   LOCK held, when there are several threads.  */
+static struct msgid_count *
+add_msgid (struct domain_statistics *stats, const char *msgid,
+	   unsigned long int msgid_hash)
+{
+  struct msgid_table *table = stats->msgids;
+  struct msgid_count *entry;
+  size_t msgid_len;
+
+  /* Keep the table at most 3/4 full.  */
+  if (table == NULL || 4 * (table->filled + 1) > 3 * table->size)
+    {
+      size_t new_size =
+	(table != NULL ? 2 * table->size : MSGID_TABLE_INITIAL_SIZE);
+      struct msgid_table *new_table =
+	(struct msgid_table *)
+	calloc (1, offsetof (struct msgid_table, slots)
+		   + new_size * sizeof (struct msgid_count *));
+
+      if (new_table == NULL)
+	return NULL;
+      new_table->size = new_size;
+      if (table != NULL)
+	{
+	  size_t i;
+
+	  for (i = 0; i < table->size; i++)
+	    if (table->slots[i] != NULL)
+	      msgid_table_put (new_table, table->slots[i]);
+	  free (table);
+	}
+      stats->msgids = table = new_table;
+    }
+
+  /* The caller may reuse the memory of MSGID.  */
+  msgid_len = strlen (msgid) + 1;
+  entry = (struct msgid_count *) malloc (sizeof (struct msgid_count)
+					 + msgid_len);
+  if (entry == NULL)
+    return NULL;
+  memcpy (entry + 1, msgid, msgid_len);
+  entry->msgid = (const char *) (entry + 1);
+  entry->hash = msgid_hash;
+  entry->count = 0;
+  msgid_table_put (table, entry);
+
+  return entry;
+}
+
+/* Count a lookup of MSGID in STATS.  */
+static void
+count_msgid (struct domain_statistics *stats, const char *msgid,
+	     unsigned long int msgid_hash)
+{
+  struct msgid_table *table = stats->msgids;
+  struct msgid_count *entry = NULL;
+
+  if (table != NULL)
+    {
+      size_t mask = table->size - 1;
+      size_t idx;
+
+      for (idx = msgid_hash & mask; table->slots[idx] != NULL;
+	   idx = (idx + 1) & mask)
+	if (table->slots[idx]->hash == msgid_hash
+	    && strcmp (table->slots[idx]->msgid, msgid) == 0)
+	  {
+	    entry = table->slots[idx];
+	    break;
+	  }
+    }
+
+  if (entry == NULL)
+    {
+#if HAVE_THREAD_LOCAL_STORAGE
+      __libc_lock_lock (lock);
+#endif
+      entry = add_msgid (stats, msgid, msgid_hash);
+#if HAVE_THREAD_LOCAL_STORAGE
+      __libc_lock_unlock (lock);
+#endif
+      if (entry == NULL)
+	return;
+    }
+
+  entry->count++;
+}
+
+/* Count a lookup of MSGID, whose hash code is MSGID_HASH, in the domain
+   DOMAINNAME.  OUTCOME says how it ended.  CATALOG_MISSES is the number
+   of catalogs that were searched in vain, CONVERSIONS the number of
+   translations that were converted to another character set.  */
+void
+_nl_statistics_record (const char *domainname,
+		       const char *msgid, unsigned long int msgid_hash,
+		       int outcome, unsigned int catalog_misses,
+		       unsigned long int conversions)
+{
+  struct domain_statistics *stats;
+
+#if !HAVE_THREAD_LOCAL_STORAGE
+  __libc_lock_lock (lock);
+#endif
+
+  stats = get_domain_statistics (domainname);
+  if (stats != NULL)
+    {
+      stats->lookups++;
+      if (outcome == STATISTICS_CACHE_HIT)
+	stats->cache_hits++;
+      else if (outcome == STATISTICS_UNTRANSLATED)
+	stats->untranslated++;
+      stats->catalog_misses += catalog_misses;
+      stats->conversions += conversions;
+      if (count_msgids)
+	count_msgid (stats, msgid, msgid_hash);
+    }
+
+#if !HAVE_THREAD_LOCAL_STORAGE
+  __libc_lock_unlock (lock);
+#endif
+}
+
+/* The sum of the counts of a msgid over all threads.  */
+struct msgid_total
+{
+  const char *msgid;
+  unsigned long int count;
+};
+
+static int
+compare_msgid_count_pointers (const void *p1, const void *p2)
+{
+  const struct msgid_count *e1 = *(const struct msgid_count * const *) p1;
+  const struct msgid_count *e2 = *(const struct msgid_count * const *) p2;
+
+  return strcmp (e1->msgid, e2->msgid);
+}
+
+/* Sort by decreasing count, then by msgid.  */
+static int
+compare_msgid_totals (const void *p1, const void *p2)
+{
+  const struct msgid_total *t1 = (const struct msgid_total *) p1;
+  const struct msgid_total *t2 = (const struct msgid_total *) p2;
+
+  if (t1->count != t2->count)
+    return (t1->count > t2->count ? -1 : 1);
+  return strcmp (t1->msgid, t2->msgid);
+}
+
+static int
+compare_domain_statistics_pointers (const void *p1, const void *p2)
+{
+  const struct domain_statistics *s1 =
+    *(const struct domain_statistics * const *) p1;
+  const struct domain_statistics *s2 =
+    *(const struct domain_statistics * const *) p2;
+
+  return strcmp (s1->domainname, s2->domainname);
+}
+
+/* Print MSGID the way msgfmt --hot-list reads it: like a C string, but
+   without the surrounding quotes.  */
+static void
+print_msgid (FILE *stream, const char *msgid)
+{
+  for (; *msgid != '\0'; msgid++)
+    {
+      unsigned char c = (unsigned char) *msgid;
+
+      switch (c)
+	{
+	case '\n': fputs ("\\n", stream); break;
+	case '\t': fputs ("\\t", stream); break;
+	case '\r': fputs ("\\r", stream); break;
+	case '\\': fputs ("\\\\", stream); break;
+	case '"': fputs ("\\\"", stream); break;
+	default:
+	  if (c < 0x20 || c == 0x7f)
+	    fprintf (stream, "\\%03o", c);
+	  else
+	    putc (c, stream);
+	  break;
+	}
+    }
+}
+
+/* Print the statistics of the domain of the records STATS[0..N-1] to
+   STREAM.  Return 0 if memory is exhausted.  */
+static int
+print_domain_statistics (FILE *stream, struct domain_statistics **stats,
+			 size_t n)
+{
+  unsigned long int lookups = 0;
+  unsigned long int cache_hits = 0;
+  unsigned long int catalog_misses = 0;
+  unsigned long int untranslated = 0;
+  unsigned long int conversions = 0;
+  size_t nentries = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      lookups += stats[i]->lookups;
+      cache_hits += stats[i]->cache_hits;
+      catalog_misses += stats[i]->catalog_misses;
+      untranslated += stats[i]->untranslated;
+      conversions += stats[i]->conversions;
+      if (stats[i]->msgids != NULL)
+	nentries += stats[i]->msgids->filled;
+    }
+
+  fprintf (stream, "# domain: %s\n", stats[0]->domainname);
+  fprintf (stream, "# lookups: %lu\n", lookups);
+  fprintf (stream, "# cache-hits: %lu\n", cache_hits);
+  fprintf (stream, "# catalog-misses: %lu\n", catalog_misses);
+  fprintf (stream, "# untranslated: %lu\n", untranslated);
+  fprintf (stream, "# conversions: %lu\n", conversions);
+
+  if (nentries > 0)
+    {
+      struct msgid_count **entries =
+	(struct msgid_count **) malloc (nentries * sizeof (*entries));
+      struct msgid_total *totals =
+	(struct msgid_total *) malloc (nentries * sizeof (*totals));
+      size_t ntotals;
+
+      if (entries == NULL || totals == NULL)
+	{
+	  free (totals);
+	  free (entries);
+	  return 0;
+	}
+
+      /* Collect the entries of all threads, and add up the counts of the
+	 same msgid.  */
+      nentries = 0;
+      for (i = 0; i < n; i++)
+	if (stats[i]->msgids != NULL)
+	  {
+	    const struct msgid_table *table = stats[i]->msgids;
+	    size_t j;
+
+	    for (j = 0; j < table->size; j++)
+	      if (table->slots[j] != NULL)
+		entries[nentries++] = table->slots[j];
+	  }
+      qsort (entries, nentries, sizeof (*entries),
+	     compare_msgid_count_pointers);
+
+      ntotals = 0;
+      for (i = 0; i < nentries; i++)
+	if (ntotals > 0
+	    && strcmp (totals[ntotals - 1].msgid, entries[i]->msgid) == 0)
+	  totals[ntotals - 1].count += entries[i]->count;
+	else
+	  {
+	    totals[ntotals].msgid = entries[i]->msgid;
+	    totals[ntotals].count = entries[i]->count;
+	    ntotals++;
+	  }
+      qsort (totals, ntotals, sizeof (*totals), compare_msgid_totals);
+
+      for (i = 0; i < ntotals; i++)
+	{
+	  fprintf (stream, "%lu\t", totals[i].count);
+	  print_msgid (stream, totals[i].msgid);
+	  putc ('\n', stream);
+	}
+
+      free (totals);
+      free (entries);
+    }
+
+  return 1;
+}
+
+/* Write the statistics of all threads to FILENAME.  Must be called with
+   LOCK held.  */
+static int
+write_statistics_locked (const char *filename)
+{
+  struct domain_statistics **records;
+  struct domain_statistics *stats;
+  size_t nrecords;
+  size_t i;
+  FILE *stream;
+  int ok;
+
+  nrecords = 0;
+  for (stats = all_statistics; stats != NULL; stats = stats->all_next)
+    nrecords++;
+  records = (struct domain_statistics **)
+	    malloc ((nrecords > 0 ? nrecords : 1) * sizeof (*records));
+  if (records == NULL)
+    {
+      errno = ENOMEM;
+      return -1;
+    }
+  nrecords = 0;
+  for (stats = all_statistics; stats != NULL; stats = stats->all_next)
+    records[nrecords++] = stats;
+  /* Bring the records of the same domain together.  */
+  qsort (records, nrecords, sizeof (*records),
+	 compare_domain_statistics_pointers);
+
+  stream = fopen (filename, "w");
+  if (stream == NULL)
+    {
+      free (records);
+      return -1;
+    }
+
+  ok = 1;
+  for (i = 0; i < nrecords && ok; )
+    {
+      size_t j;
+
+      for (j = i + 1;
+	   j < nrecords
+	   && strcmp (records[j]->domainname, records[i]->domainname) == 0;
+	   j++)
+	;
+      ok = print_domain_statistics (stream, records + i, j - i);
+      i = j;
+    }
+  free (records);
+
+  if (!ok)
+    {
+      fclose (stream);
+      errno = ENOMEM;
+      return -1;
+    }
+  if (ferror (stream))
+    {
+      fclose (stream);
+      errno = EIO;
+      return -1;
+    }
+  return (fclose (stream) == 0 ? 0 : -1);
+}
+
+static void
+write_statistics_at_exit (void)
+{
+  __libc_lock_lock (lock);
+  write_statistics_locked (statistics_filename);
+  __libc_lock_unlock (lock);
+}
+
+/* Enable the statistics, to be written to FILENAME at exit.  If PER_MSGID
+   is nonzero, count the lookups of each msgid as well.  Return 0 if memory
+   is exhausted.  */
+int
+_nl_statistics_init (const char *filename, int per_msgid)
+{
+  int result = 1;
+
+  __libc_lock_lock (lock);
+  if (statistics_filename == NULL)
+    {
+      size_t len = strlen (filename) + 1;
+      char *copy = (char *) malloc (len);
+
+      if (copy != NULL)
+	{
+	  memcpy (copy, filename, len);
+	  statistics_filename = copy;
+	  count_msgids = per_msgid;
+	  atexit (write_statistics_at_exit);
+	}
+      else
+	result = 0;
+    }
+  __libc_lock_unlock (lock);
+
+  return result;
+}
+
+/* Write the lookup statistics collected so far to FILENAME or, if FILENAME
+   is NULL, to the file given by GETTEXT_STATISTICS.  */
+int
+libintl_dump_textdomain_statistics (const char *filename)
+{
+  int result;
+
+  __libc_lock_lock (lock);
+  if (filename == NULL)
+    filename = statistics_filename;
+  if (filename != NULL)
+    result = write_statistics_locked (filename);
+  else
+    {
+      errno = EINVAL;
+      result = -1;
+    }
+  __libc_lock_unlock (lock);
+
+  return result;
+}
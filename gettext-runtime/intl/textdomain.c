@@ -111,6 +111,7 @@ TEXTDOMAIN (const char *domainname)
   if (new_domain != NULL)
     {
       ++_nl_msg_cat_cntr;
+      _nl_reclaim_known_translations ();
 
       if (old_domain != new_domain && old_domain != _nl_default_default_domain)
 	free (old_domain);
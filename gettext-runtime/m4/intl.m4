@@ -227,10 +227,22 @@ AC_DEFUN([gt_INTL_SUBDIR_CORE],
     [AC_DEFINE([HAVE_BUILTIN_EXPECT], [1],
        [Define to 1 if the compiler understands __builtin_expect.])])
 
-  AC_CHECK_HEADERS([argz.h inttypes.h limits.h unistd.h sys/param.h])
-  AC_CHECK_FUNCS([getcwd getegid geteuid getgid getuid mempcpy munmap \
-    stpcpy strcasecmp strdup strtoul tsearch uselocale argz_count \
-    argz_stringify argz_next __fsetlocking])
+  AC_CACHE_CHECK([for thread-local storage], [gt_cv_thread_local_storage],
+    [AC_LINK_IFELSE(
+       [AC_LANG_PROGRAM(
+          [[static __thread int foo;]],
+          [[foo = 1; return foo - 1;]])],
+       [gt_cv_thread_local_storage=yes],
+       [gt_cv_thread_local_storage=no])])
+  if test $gt_cv_thread_local_storage = yes; then
+    AC_DEFINE([HAVE_THREAD_LOCAL_STORAGE], [1],
+      [Define to 1 if the compiler supports the __thread storage class.])
+  fi
+
+  AC_CHECK_HEADERS([argz.h dirent.h inttypes.h limits.h unistd.h sys/param.h])
+  AC_CHECK_FUNCS([getcwd getegid geteuid getgid getuid gettimeofday madvise \
+    mempcpy munmap stpcpy strcasecmp strdup strtoul tsearch uselocale \
+    argz_count argz_stringify argz_next __fsetlocking])
 
   dnl Use the *_unlocked functions only if they are declared.
   dnl (because some of them were defined without being declared in Solaris
@@ -0,0 +1,4 @@
+[NAME]
+msgsuggest \- suggest translations from translation memories
+[DESCRIPTION]
+.\" Add any additional description here
@@ -25,12 +25,16 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "message.h"
+#include "xalloc.h"
 #include "gettext.h"
 
 #define _(str) gettext (str)
 
+#define SIZEOF(a) (sizeof(a) / sizeof(a[0]))
+
 /* Table of all format string parsers.  */
 struct formatstring_parser *formatstring_parsers[NFORMATS] =
 {
@@ -99,6 +103,27 @@ check_msgid_msgstr_format_i (const char *msgid, const char *msgid_plural,
       const char *p_end = msgstr + msgstr_len;
       const char *p;
       unsigned int j;
+      /* The msgstr[] forms of a message are often equal to each other, for
+         example when a language distinguishes plural forms that most words
+         don't.  Parse each distinct msgstr[] form only once; the msgid
+         descriptor is likewise shared by all forms.  */
+      struct parsed_form
+      {
+        const char *string;
+        void *descr;
+        char *invalid_reason;
+      };
+      struct parsed_form small_forms[6];
+      struct parsed_form *forms;
+      unsigned int nforms;
+      unsigned int k;
+
+      nforms = 0;
+      for (p = msgstr; p < p_end; p += strlen (p) + 1)
+        nforms++;
+      forms = (nforms <= SIZEOF (small_forms)
+               ? small_forms
+               : XNMALLOC (nforms, struct parsed_form));
 
       for (p = msgstr, j = 0; p < p_end; p += strlen (p) + 1, j++)
         {
@@ -110,7 +135,26 @@ check_msgid_msgstr_format_i (const char *msgid, const char *msgid_plural,
               pretty_msgstr = buf;
             }
 
-          msgstr_descr = parser->parse (p, true, NULL, &invalid_reason);
+          for (k = 0; k < j; k++)
+            if (strcmp (forms[k].string, p) == 0)
+              break;
+          if (k < j)
+            {
+              /* Same string as msgstr[k].  Reuse its parse result.  */
+              forms[j].string = p;
+              forms[j].descr = NULL;
+              forms[j].invalid_reason = NULL;
+              msgstr_descr = forms[k].descr;
+              invalid_reason = forms[k].invalid_reason;
+            }
+          else
+            {
+              invalid_reason = NULL;
+              msgstr_descr = parser->parse (p, true, NULL, &invalid_reason);
+              forms[j].string = p;
+              forms[j].descr = msgstr_descr;
+              forms[j].invalid_reason = invalid_reason;
+            }
 
           if (msgstr_descr != NULL)
             {
@@ -140,8 +184,6 @@ check_msgid_msgstr_format_i (const char *msgid, const char *msgid_plural,
                                  strict_checking,
                                  error_logger, pretty_msgid, pretty_msgstr))
                 seen_errors++;
-
-              parser->free (msgstr_descr);
             }
           else
             {
@@ -150,10 +192,18 @@ check_msgid_msgstr_format_i (const char *msgid, const char *msgid_plural,
                             pretty_msgstr, format_language_pretty[i],
                             pretty_msgid, invalid_reason);
               seen_errors++;
-              free (invalid_reason);
             }
         }
 
+      for (k = 0; k < nforms; k++)
+        {
+          if (forms[k].descr != NULL)
+            parser->free (forms[k].descr);
+          free (forms[k].invalid_reason);
+        }
+      if (forms != small_forms)
+        free (forms);
+
       parser->free (msgid_descr);
     }
   else
@@ -0,0 +1,245 @@
+/* Bit-parallel computation of the fuzzy similarity of two strings.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+/* Specification.  */
+#include "fstrcmp-bits.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "fstrcmp.h"
+#include "xmalloca.h"
+
+
+/* fstrcmp() returns
+     (len1 + len2 - edit_count) / (len1 + len2)
+   where edit_count is the number of character insertions and deletions in
+   the diff between the two strings that the "diffseq" algorithm finds, in
+   time O((len1 + len2) * edit_count).
+
+   The smallest possible edit_count is
+     len1 + len2 - 2 * LCS (string1, string2)
+   where LCS is the length of a longest common subsequence of the two
+   strings.  The LCS length can be computed bit-parallel (L. Allison,
+   T. I. Dix: "A bit-string longest-common-subsequence algorithm", 1986;
+   H. Hyyrö: "Bit-parallel LCS-length computation revisited", 2004): Each
+   character of the shorter string is represented by a bit in a bit vector V,
+   and V is updated with a handful of word operations for each character of
+   the longer string.  This processes WORD_BITS characters at once and takes
+   time O(ceil (len1 / WORD_BITS) * len2).
+
+   The "diffseq" algorithm finds a minimal diff, except when the search for
+   the middle snake exceeds TOO_EXPENSIVE steps; then it gives up and takes
+   a partition that is not necessarily optimal.  A minimal diff with
+   edit_count edits is found after ceil (edit_count / 2) steps, and fstrcmp()
+   never sets TOO_EXPENSIVE below 256.  So we know fstrcmp()'s result
+   whenever edit_count is small enough, and in the other cases we call
+   fstrcmp_bounded() itself, so that the result is always the same.  */
+
+/* The lower bound of fstrcmp()'s TOO_EXPENSIVE value.  */
+#define MIN_TOO_EXPENSIVE 256
+
+typedef unsigned long word_t;
+#define WORD_BITS (sizeof (word_t) * CHAR_BIT)
+
+/* Return the number of bits set in X.  */
+static inline unsigned int
+count_bits (word_t x)
+{
+#if __GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4)
+  return __builtin_popcountl (x);
+#else
+  unsigned int count;
+
+  for (count = 0; x != 0; x &= x - 1)
+    count++;
+  return count;
+#endif
+}
+
+/* Return the length of a longest common subsequence of STRING1 and STRING2.
+   Requires 0 < LEN1 <= LEN2.  */
+static size_t
+lcs_length (const char *string1, size_t len1,
+            const char *string2, size_t len2)
+{
+  size_t nwords = (len1 + WORD_BITS - 1) / WORD_BITS;
+  /* match[c * nwords + k] has bit b set if string1[k * WORD_BITS + b] == c.
+     Only the rows of the characters occurring in STRING1 or STRING2 are
+     initialized.  */
+  word_t *match;
+  /* v has bit i cleared if string1[i] is the last character of a common
+     subsequence that is as long as possible.  */
+  word_t *v;
+  size_t ones;
+  size_t i;
+  size_t k;
+
+  match =
+    (word_t *) xmalloca ((UCHAR_MAX + 1) * nwords * sizeof (word_t));
+  v = (word_t *) xmalloca (nwords * sizeof (word_t));
+  /* Since LEN1 > 0, NWORDS > 0.  */
+  v[0] = ~(word_t) 0;
+  for (k = 1; k < nwords; k++)
+    v[k] = ~(word_t) 0;
+
+  for (i = 0; i < len1; i++)
+    memset (match + (unsigned char) string1[i] * nwords, 0,
+            nwords * sizeof (word_t));
+  for (i = 0; i < len2; i++)
+    memset (match + (unsigned char) string2[i] * nwords, 0,
+            nwords * sizeof (word_t));
+  for (i = 0; i < len1; i++)
+    match[(unsigned char) string1[i] * nwords + i / WORD_BITS] |=
+      (word_t) 1 << (i % WORD_BITS);
+
+  if (nwords == 1)
+    {
+      /* The common case of short strings.  */
+      word_t x = v[0];
+
+      for (i = 0; i < len2; i++)
+        {
+          word_t u = x & match[(unsigned char) string2[i]];
+          x = (x + u) | (x - u);
+        }
+      v[0] = x;
+    }
+  else
+    {
+      for (i = 0; i < len2; i++)
+        {
+          const word_t *m = match + (unsigned char) string2[i] * nwords;
+          word_t carry = 0;
+
+          /* V := (V + U) | (V - U) where U = V & M, with the addition carried
+             across the words.  Since U is a subset of V, the subtraction
+             does not need a borrow.  */
+          for (k = 0; k < nwords; k++)
+            {
+              word_t x = v[k];
+              word_t u = x & m[k];
+              word_t sum = x + u;
+              word_t next_carry = (sum < x);
+
+              sum += carry;
+              next_carry |= (sum < carry);
+              v[k] = sum | (x - u);
+              carry = next_carry;
+            }
+        }
+    }
+
+  /* Count the bits of V that are still set, ignoring the bits beyond LEN1,
+     into which the addition may have carried.  */
+  ones = 0;
+  for (k = 0; k + 1 < nwords; k++)
+    ones += count_bits (v[k]);
+  if (len1 % WORD_BITS != 0)
+    ones += count_bits (v[k] & (((word_t) 1 << (len1 % WORD_BITS)) - 1));
+  else
+    ones += count_bits (v[k]);
+
+  freea (v);
+  freea (match);
+
+  return len1 - ones;
+}
+
+double
+fstrcmp_bits_bounded (const char *string1, const char *string2,
+                      double lower_bound)
+{
+  size_t len1 = strlen (string1);
+  size_t len2 = strlen (string2);
+  int xvec_length;
+  int yvec_length;
+  int edit_count_limit;
+  int edit_count;
+
+  /* Strings that fstrcmp() cannot even represent are left to it.  */
+  if (len1 > INT_MAX / 2 || len2 > INT_MAX / 2)
+    return fstrcmp_bounded (string1, string2, lower_bound);
+  xvec_length = len1;
+  yvec_length = len2;
+
+  /* Apply the same short-circuits as fstrcmp_bounded(), so that the same
+     value is returned also when the similarity is < LOWER_BOUND.  */
+  if (xvec_length == 0 || yvec_length == 0)
+    return (xvec_length == 0 && yvec_length == 0 ? 1.0 : 0.0);
+
+  if (lower_bound > 0)
+    {
+      volatile double upper_bound =
+        (double) (2 * (xvec_length < yvec_length ? xvec_length : yvec_length))
+        / (xvec_length + yvec_length);
+
+      if (upper_bound < lower_bound)
+        return 0.0;
+
+#if CHAR_BIT <= 8
+      if (xvec_length + yvec_length >= 20)
+        {
+          int occ_diff[UCHAR_MAX + 1];
+          int sum;
+          int i;
+
+          memset (occ_diff, 0, sizeof (occ_diff));
+          for (i = xvec_length - 1; i >= 0; i--)
+            occ_diff[(unsigned char) string1[i]]++;
+          for (i = yvec_length - 1; i >= 0; i--)
+            occ_diff[(unsigned char) string2[i]]--;
+          sum = 0;
+          for (i = 0; i <= UCHAR_MAX; i++)
+            {
+              int d = occ_diff[i];
+              sum += (d >= 0 ? d : -d);
+            }
+
+          upper_bound = 1.0 - (double) sum / (xvec_length + yvec_length);
+
+          if (upper_bound < lower_bound)
+            return 0.0;
+        }
+#endif
+    }
+
+  edit_count_limit =
+    (lower_bound < 1.0
+     ? (xvec_length + yvec_length) * (1.0 - lower_bound + 0.000001)
+     : 0);
+
+  edit_count =
+    xvec_length + yvec_length
+    - 2 * (int) (len1 <= len2
+                 ? lcs_length (string1, len1, string2, len2)
+                 : lcs_length (string2, len2, string1, len1));
+
+  /* fstrcmp_bounded() aborts as soon as the edit count exceeds the limit.  */
+  if (edit_count > edit_count_limit)
+    return 0.0;
+
+  /* Here fstrcmp_bounded() might find a diff that is not minimal.  */
+  if (edit_count >= 2 * (MIN_TOO_EXPENSIVE - 1))
+    return fstrcmp_bounded (string1, string2, lower_bound);
+
+  return ((double) (xvec_length + yvec_length - edit_count)
+          / (xvec_length + yvec_length));
+}
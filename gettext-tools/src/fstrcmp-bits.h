@@ -0,0 +1,41 @@
+/* Bit-parallel computation of the fuzzy similarity of two strings.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef _FSTRCMP_BITS_H
+#define _FSTRCMP_BITS_H 1
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Return the same value as fstrcmp_bounded (STRING1, STRING2, LOWER_BOUND),
+   i.e. a similarity measure between 0.0 and 1.0, or some value
+   < LOWER_BOUND when the similarity is < LOWER_BOUND.  The computation is
+   faster than fstrcmp_bounded's for strings with many differences.
+   This function is multithread-safe.  */
+extern double
+       fstrcmp_bits_bounded (const char *string1, const char *string2,
+                             double lower_bound);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* _FSTRCMP_BITS_H */
@@ -26,7 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "fstrcmp.h"
+#include "fstrcmp-bits.h"
 #include "hash.h"
 #include "xalloc.h"
 #include "xmalloca.h"
@@ -566,7 +566,8 @@ fuzzy_search_goal_function (const message_ty *mp,
        compliant by default, to avoid that msgmerge results become platform and
        compiler option dependent.  'volatile' is a portable alternative to
        gcc's -ffloat-store option.  */
-    volatile double weight = fstrcmp_bounded (msgid, mp->msgid, lower_bound);
+    volatile double weight =
+      fstrcmp_bits_bounded (msgid, mp->msgid, lower_bound);
 
     weight += bonus;
 
@@ -38,10 +38,12 @@
 #include "read-po.h"
 #include "read-properties.h"
 #include "read-stringtable.h"
+#include "xalloc.h"
 #include "xmalloca.h"
 #include "po-charset.h"
 #include "msgl-iconv.h"
 #include "msgl-fsearch.h"
+#include "parallel.h"
 #include "c-strstr.h"
 #include "c-strcase.h"
 #include "propername.h"
@@ -62,11 +64,16 @@ static bool include_fuzzies = false;
 /* Whether to consider untranslated messages as translations.  */
 static bool include_untranslated = false;
 
+/* File in which the fuzzy index of the definitions is kept, or NULL.  */
+static const char *fuzzy_index_filename;
+
 /* Long options.  */
 static const struct option long_options[] =
 {
   { "directory", required_argument, NULL, 'D' },
+  { "fuzzy-index", required_argument, NULL, CHAR_MAX + 4 },
   { "help", no_argument, NULL, 'h' },
+  { "jobs", required_argument, NULL, 'j' },
   { "multi-domain", no_argument, NULL, 'm' },
   { "no-fuzzy-matching", no_argument, NULL, 'N' },
   { "properties-input", no_argument, NULL, 'P' },
@@ -116,7 +123,7 @@ main (int argc, char *argv[])
 
   do_help = false;
   do_version = false;
-  while ((optchar = getopt_long (argc, argv, "D:hmNPV", long_options, NULL))
+  while ((optchar = getopt_long (argc, argv, "D:hj:mNPV", long_options, NULL))
          != EOF)
     switch (optchar)
       {
@@ -131,6 +138,18 @@ main (int argc, char *argv[])
         do_help = true;
         break;
 
+      case 'j':
+        {
+          char *endp;
+          unsigned long int value = strtoul (optarg, &endp, 10);
+
+          if (endp == optarg || *endp != '\0'
+              || value == 0 || value > UINT_MAX)
+            error (EXIT_FAILURE, 0, _("invalid number of jobs: %s"), optarg);
+          parallel_set_jobs (value);
+        }
+        break;
+
       case 'm':
         multi_domain_mode = true;
         break;
@@ -159,6 +178,10 @@ main (int argc, char *argv[])
         include_untranslated = true;
         break;
 
+      case CHAR_MAX + 4:        /* --fuzzy-index */
+        fuzzy_index_filename = optarg;
+        break;
+
       default:
         usage (EXIT_FAILURE);
         break;
@@ -235,6 +258,9 @@ Input file location:\n"));
   ref.pot                     references to the sources\n"));
       printf (_("\
   -D, --directory=DIRECTORY   add DIRECTORY to list for input files search\n"));
+      printf (_("\
+      --fuzzy-index=FILE      keep the fuzzy index of def.po in FILE,\n\
+                              for reuse by later invocations\n"));
       printf ("\n");
       printf (_("\
 Operation modifiers:\n"));
@@ -246,6 +272,8 @@ Operation modifiers:\n"));
       --use-fuzzy             consider fuzzy entries\n"));
       printf (_("\
       --use-untranslated      consider untranslated entries\n"));
+      printf (_("\
+  -j, --jobs=NUMBER           use NUMBER threads for the fuzzy matching\n"));
       printf ("\n");
       printf (_("\
 Input file syntax:\n"));
@@ -298,6 +326,38 @@ remove_obsoletes (msgdomain_list_ty *mdlp)
 }
 
 
+/* The outcome of the search for a reference message among the
+   definitions.  */
+struct search_result
+{
+  message_ty *found;
+  bool fuzzy;
+};
+
+/* The state shared by the parallel fuzzy searches of match_domain.  */
+struct fuzzy_search_loop
+{
+  message_fuzzy_index_ty *findex;
+  message_list_ty *refmlp;
+  /* The indices of the reference messages that have no exact match.  */
+  size_t *missing;
+  struct search_result *results;
+};
+
+/* Search a message similar to the missing reference message number I.  */
+static void
+fuzzy_search (void *data, size_t i)
+{
+  struct fuzzy_search_loop *loop = (struct fuzzy_search_loop *) data;
+  size_t j = loop->missing[i];
+  message_ty *refmsg = loop->refmlp->item[j];
+
+  loop->results[j].found =
+    message_fuzzy_index_search (loop->findex, refmsg->msgctxt, refmsg->msgid,
+                                FUZZY_THRESHOLD, false);
+  loop->results[j].fuzzy = true;
+}
+
 static void
 match_domain (const char *fn1, const char *fn2,
               message_list_ty *defmlp, message_fuzzy_index_ty **defmlp_findex,
@@ -305,18 +365,64 @@ match_domain (const char *fn1, const char *fn2,
               message_list_ty *refmlp,
               int *nerrors)
 {
+  struct search_result *results;
+  size_t *missing;
+  size_t nmissing;
   size_t j;
 
+  /* See which messages are in the other file.  */
+  results = XNMALLOC (refmlp->nitems, struct search_result);
+  missing = XNMALLOC (refmlp->nitems, size_t);
+  nmissing = 0;
   for (j = 0; j < refmlp->nitems; j++)
     {
-      message_ty *refmsg;
-      message_ty *defmsg;
+      message_ty *refmsg = refmlp->item[j];
+
+      results[j].found =
+        message_list_search (defmlp, refmsg->msgctxt, refmsg->msgid);
+      results[j].fuzzy = false;
+      if (results[j].found == NULL)
+        missing[nmissing++] = j;
+    }
+
+  /* If a message was not defined at all, try to find a very similar
+     message, it could be a typo, or the suggestion may help.  The searches
+     take most of the time; they are distributed across several threads.  */
+  if (use_fuzzy_matching && nmissing > 0)
+    {
+      struct fuzzy_search_loop loop;
 
-      refmsg = refmlp->item[j];
+      /* Speedup through early abort in fstrcmp(), combined with
+         pre-sorting of the messages through a hashed index.  */
+      if (*defmlp_findex == NULL)
+        {
+          if (fuzzy_index_filename != NULL)
+            {
+              *defmlp_findex =
+                message_fuzzy_index_alloc_cached (defmlp, def_canon_charset,
+                                                  fuzzy_index_filename);
+              /* The file holds the index of a single domain.  */
+              fuzzy_index_filename = NULL;
+            }
+          else
+            *defmlp_findex =
+              message_fuzzy_index_alloc (defmlp, def_canon_charset);
+        }
 
-      /* See if it is in the other file.  */
-      defmsg = message_list_search (defmlp, refmsg->msgctxt, refmsg->msgid);
-      if (defmsg)
+      loop.findex = *defmlp_findex;
+      loop.refmlp = refmlp;
+      loop.missing = missing;
+      loop.results = results;
+      parallel_for (nmissing, fuzzy_search, &loop);
+    }
+
+  /* Report the results, in the order of the reference messages.  */
+  for (j = 0; j < refmlp->nitems; j++)
+    {
+      message_ty *refmsg = refmlp->item[j];
+      message_ty *defmsg = results[j].found;
+
+      if (defmsg != NULL && !results[j].fuzzy)
         {
           if (!include_untranslated && defmsg->msgstr[0] == '\0')
             {
@@ -335,35 +441,7 @@ this message needs to be reviewed by the translator"));
         }
       else
         {
-          /* If the message was not defined at all, try to find a very
-             similar message, it could be a typo, or the suggestion may
-             help.  */
           (*nerrors)++;
-          if (use_fuzzy_matching)
-            {
-              if (false)
-                {
-                  /* Old, slow code.  */
-                  defmsg =
-                    message_list_search_fuzzy (defmlp,
-                                               refmsg->msgctxt, refmsg->msgid);
-                }
-              else
-                {
-                  /* Speedup through early abort in fstrcmp(), combined with
-                     pre-sorting of the messages through a hashed index.  */
-                  /* Create the fuzzy index lazily.  */
-                  if (*defmlp_findex == NULL)
-                    *defmlp_findex =
-                      message_fuzzy_index_alloc (defmlp, def_canon_charset);
-                  defmsg =
-                    message_fuzzy_index_search (*defmlp_findex,
-                                                refmsg->msgctxt, refmsg->msgid,
-                                                FUZZY_THRESHOLD, false);
-                }
-            }
-          else
-            defmsg = NULL;
           if (defmsg)
             {
               po_gram_error_at_line (&refmsg->pos, _("\
@@ -378,6 +456,9 @@ this message is used but not defined..."));
 this message is used but not defined in %s"), fn1);
         }
     }
+
+  free (missing);
+  free (results);
 }
 
 
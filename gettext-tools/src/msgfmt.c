@@ -20,8 +20,10 @@
 #endif
 
 #include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
 #include <limits.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,6 +32,7 @@
 #include "closeout.h"
 #include "str-list.h"
 #include "dir-list.h"
+#include "file-list.h"
 #include "error.h"
 #include "error-progname.h"
 #include "progname.h"
@@ -38,6 +41,8 @@
 #include "xerror.h"
 #include "xvasprintf.h"
 #include "xalloc.h"
+#include "concat-filename.h"
+#include "md5.h"
 #include "msgfmt.h"
 #include "write-mo.h"
 #include "write-java.h"
@@ -53,6 +58,7 @@
 #include "read-properties.h"
 #include "read-stringtable.h"
 #include "po-charset.h"
+#include "po-xerror.h"
 #include "msgl-check.h"
 #include "gettext.h"
 
@@ -70,6 +76,10 @@ static bool include_untranslated = false;
 /* Specifies name of the output file.  */
 static const char *output_file_name;
 
+/* Specifies the directory of the output files, when each input file is
+   compiled to its own .mo file.  */
+static const char *output_dir;
+
 /* Java mode output file specification.  */
 static bool java_mode;
 static bool assume_java2;
@@ -145,6 +155,15 @@ static int msgs_fuzzy;
 /* If not zero print statistics about translation at the end.  */
 static int do_statistics;
 
+/* Whether a fatal error in an input file only ends the reading of that
+   file, instead of the program.  Used with --output-dir.  */
+static bool recover_from_fatal_errors;
+
+/* The place where read_catalog_file_msgfmt continues after a fatal error,
+   and the name of the file being read, when recover_from_fatal_errors.  */
+static jmp_buf *fatal_error_recovery;
+static const char *fatal_error_file_name;
+
 /* Long options.  */
 static const struct option long_options[] =
 {
@@ -155,15 +174,19 @@ static const struct option long_options[] =
   { "check-domain", no_argument, NULL, CHAR_MAX + 2 },
   { "check-format", no_argument, NULL, CHAR_MAX + 3 },
   { "check-header", no_argument, NULL, CHAR_MAX + 4 },
+  { "cluster-strings", no_argument, NULL, CHAR_MAX + 16 },
   { "csharp", no_argument, NULL, CHAR_MAX + 10 },
   { "csharp-resources", no_argument, NULL, CHAR_MAX + 11 },
   { "directory", required_argument, NULL, 'D' },
   { "endianness", required_argument, NULL, CHAR_MAX + 13 },
+  { "files-from", required_argument, NULL, CHAR_MAX + 15 },
   { "help", no_argument, NULL, 'h' },
+  { "hot-list", required_argument, NULL, CHAR_MAX + 17 },
   { "java", no_argument, NULL, 'j' },
   { "java2", no_argument, NULL, CHAR_MAX + 5 },
   { "locale", required_argument, NULL, 'l' },
   { "no-hash", no_argument, NULL, CHAR_MAX + 6 },
+  { "output-dir", required_argument, NULL, CHAR_MAX + 14 },
   { "output-file", required_argument, NULL, 'o' },
   { "properties-input", no_argument, NULL, 'P' },
   { "qt", no_argument, NULL, CHAR_MAX + 9 },
@@ -189,8 +212,14 @@ static void usage (int status)
 static const char *add_mo_suffix (const char *);
 static struct msg_domain *new_domain (const char *name, const char *file_name);
 static bool is_nonobsolete (const message_ty *mp);
-static void read_catalog_file_msgfmt (char *filename,
+static bool read_catalog_file_msgfmt (char *filename,
                                       catalog_input_format_ty input_syntax);
+static string_list_ty *read_hot_list (const char *filename);
+static int check_domain_list (void);
+static void print_statistics (const char *file_names);
+static void compile_to_directory (string_list_ty *file_names,
+                                  catalog_input_format_ty input_syntax,
+                                  bool skip_up_to_date);
 
 
 int
@@ -202,6 +231,7 @@ main (int argc, char *argv[])
   bool strict_uniforum = false;
   catalog_input_format_ty input_syntax = &input_format_po;
   int arg_i;
+  string_list_ty *file_names;
   const char *canon_encoding;
   struct msg_domain *domain;
 
@@ -227,6 +257,8 @@ main (int argc, char *argv[])
   /* Ensure that write errors on stdout are detected.  */
   atexit (close_stdout);
 
+  file_names = string_list_alloc ();
+
   while ((opt = getopt_long (argc, argv, "a:cCd:D:fhjl:o:Pr:vV", long_options,
                              NULL))
          != EOF)
@@ -353,6 +385,25 @@ main (int argc, char *argv[])
           byteswap = endianness ^ ENDIANNESS;
         }
         break;
+      case CHAR_MAX + 14: /* --output-dir */
+        output_dir = optarg;
+        break;
+      case CHAR_MAX + 15: /* --files-from */
+        {
+          string_list_ty *names = read_names_from_file (optarg);
+          size_t i;
+
+          for (i = 0; i < names->nitems; i++)
+            string_list_append (file_names, names->item[i]);
+          string_list_free (names);
+        }
+        break;
+      case CHAR_MAX + 16: /* --cluster-strings */
+        cluster_strings = true;
+        break;
+      case CHAR_MAX + 17: /* --hot-list */
+        hot_keys = read_hot_list (optarg);
+        break;
       default:
         usage (EXIT_FAILURE);
         break;
@@ -378,7 +429,7 @@ There is NO WARRANTY, to the extent permitted by law.\n\
     usage (EXIT_SUCCESS);
 
   /* Test whether we have a .po file name as argument.  */
-  if (optind >= argc)
+  if (optind >= argc && file_names->nitems == 0)
     {
       error (EXIT_SUCCESS, 0, _("no input file given"));
       usage (EXIT_FAILURE);
@@ -493,6 +544,39 @@ There is NO WARRANTY, to the extent permitted by law.\n\
         }
     }
 
+  if (output_dir != NULL)
+    {
+      if (output_file_name != NULL)
+        error (EXIT_FAILURE, 0, _("%s and %s are mutually exclusive"),
+               "--output-dir", "--output-file");
+      if (java_mode || csharp_mode || csharp_resources_mode || tcl_mode
+          || qt_mode)
+        error (EXIT_FAILURE, 0, _("%s and %s are mutually exclusive"),
+               "--output-dir",
+               java_mode ? "--java" :
+               csharp_mode ? "--csharp" :
+               csharp_resources_mode ? "--csharp-resources" :
+               tcl_mode ? "--tcl" : "--qt");
+
+      /* Compile each input file to its own .mo file.  */
+      for (arg_i = optind; arg_i < argc; arg_i++)
+        string_list_append (file_names, argv[arg_i]);
+      /* The checks and the statistics need the input files to be read,
+         even when the output files are up to date.  */
+      compile_to_directory (file_names, input_syntax,
+                            !(check_format_strings || check_header
+                              || check_domain || check_compatibility
+                              || check_accelerators || strict_uniforum
+                              || do_statistics));
+      exit (exit_status);
+    }
+  if (file_names->nitems > 0)
+    {
+      error (EXIT_SUCCESS, 0, _("%s is only valid with %s"),
+             "--files-from", "--output-dir");
+      usage (EXIT_FAILURE);
+    }
+
   /* The -o option determines the name of the domain and therefore
      the output file.  */
   if (output_file_name != NULL)
@@ -525,18 +609,7 @@ There is NO WARRANTY, to the extent permitted by law.\n\
 
   /* Perform all kinds of checks: plural expressions, format strings, ...  */
   {
-    int nerrors = 0;
-
-    for (domain = domain_list; domain != NULL; domain = domain->next)
-      nerrors +=
-        check_message_list (domain->mlp,
-                            /* Untranslated and fuzzy messages have already
-                               been dealt with during parsing, see below in
-                               msgfmt_frob_new_message.  */
-                            0, 0,
-                            1, check_format_strings, check_header,
-                            check_compatibility,
-                            check_accelerators, accelerator_char);
+    int nerrors = check_domain_list ();
 
     /* Exit with status 1 on any error.  */
     if (nerrors > 0)
@@ -599,43 +672,23 @@ There is NO WARRANTY, to the extent permitted by law.\n\
   /* Print statistics if requested.  */
   if (verbose || do_statistics)
     {
+      char *all_input_file_names = NULL;
+
       if (do_statistics + verbose >= 2 && optind < argc)
         {
           /* Print the input file name(s) in front of the statistics line.  */
-          char *all_input_file_names;
-
-          {
-            string_list_ty input_file_names;
-
-            string_list_init (&input_file_names);;
-            for (arg_i = optind; arg_i < argc; arg_i++)
-              string_list_append (&input_file_names, argv[arg_i]);
-            all_input_file_names =
-              string_list_join (&input_file_names, ", ", '\0', false);
-            string_list_destroy (&input_file_names);
-          }
-
-          /* TRANSLATORS: The prefix before a statistics message.  The argument
-             is a file name or a comma separated list of file names.  */
-          fprintf (stderr, _("%s: "), all_input_file_names);
-          free (all_input_file_names);
+          string_list_ty input_file_names;
+
+          string_list_init (&input_file_names);;
+          for (arg_i = optind; arg_i < argc; arg_i++)
+            string_list_append (&input_file_names, argv[arg_i]);
+          all_input_file_names =
+            string_list_join (&input_file_names, ", ", '\0', false);
+          string_list_destroy (&input_file_names);
         }
-      fprintf (stderr,
-               ngettext ("%d translated message", "%d translated messages",
-                         msgs_translated),
-               msgs_translated);
-      if (msgs_fuzzy > 0)
-        fprintf (stderr,
-                 ngettext (", %d fuzzy translation", ", %d fuzzy translations",
-                           msgs_fuzzy),
-                 msgs_fuzzy);
-      if (msgs_untranslated > 0)
-        fprintf (stderr,
-                 ngettext (", %d untranslated message",
-                           ", %d untranslated messages",
-                           msgs_untranslated),
-                 msgs_untranslated);
-      fputs (".\n", stderr);
+      print_statistics (all_input_file_names);
+      if (all_input_file_names != NULL)
+        free (all_input_file_names);
     }
 
   exit (exit_status);
@@ -699,6 +752,16 @@ Output file location:\n"));
 If output file is -, output is written to standard output.\n"));
       printf ("\n");
       printf (_("\
+Output file location for several catalogs:\n"));
+      printf (_("\
+      --output-dir=DIRECTORY  write each input file NAME.po to DIRECTORY/NAME.mo\n"));
+      printf (_("\
+      --files-from=FILE       get list of input files from FILE\n"));
+      printf (_("\
+An output file is rewritten only if its input file or the options have\n\
+changed since it was last written.\n"));
+      printf ("\n");
+      printf (_("\
 Output file location in Java mode:\n"));
       printf (_("\
   -r, --resource=RESOURCE     resource name\n"));
@@ -768,6 +831,11 @@ Output details:\n"));
   -a, --alignment=NUMBER      align strings to NUMBER bytes (default: %d)\n"), DEFAULT_OUTPUT_ALIGNMENT);
       printf (_("\
       --no-hash               binary file will not include the hash table\n"));
+      printf (_("\
+      --cluster-strings       place each msgid next to its translation\n"));
+      printf (_("\
+      --hot-list=FILE         place the strings of the messages listed in FILE\n\
+                              first, in this order\n"));
       printf ("\n");
       printf (_("\
 Informative output:\n"));
@@ -839,6 +907,363 @@ is_nonobsolete (const message_ty *mp)
 }
 
 
+/* Read a list of message keys, for the --hot-list option.
+   Each line contains a msgid, in C syntax without the surrounding quotes.
+   A msgctxt is separated from the msgid by \004.  A leading decimal number
+   followed by a TAB, such as a usage count, is ignored.  Empty lines and
+   lines starting with # are ignored.  */
+static string_list_ty *
+read_hot_list (const char *filename)
+{
+  FILE *fp;
+  string_list_ty *result;
+  char *line = NULL;
+  size_t line_size = 0;
+
+  if (strcmp (filename, "-") == 0)
+    fp = stdin;
+  else
+    {
+      fp = fopen (filename, "r");
+      if (fp == NULL)
+        error (EXIT_FAILURE, errno,
+               _("error while opening \"%s\" for reading"), filename);
+    }
+
+  result = string_list_alloc ();
+  for (;;)
+    {
+      ssize_t len = getline (&line, &line_size, fp);
+      const char *p;
+      char *q;
+
+      if (len < 0)
+        break;
+      if (len > 0 && line[len - 1] == '\n')
+        line[--len] = '\0';
+      if (len > 0 && line[len - 1] == '\r')
+        line[--len] = '\0';
+      if (len == 0 || line[0] == '#')
+        continue;
+
+      /* Skip a leading count.  */
+      for (p = line; *p >= '0' && *p <= '9'; p++)
+        ;
+      if (p > line && *p == '\t')
+        p++;
+      else
+        p = line;
+
+      /* Interpret the escape sequences, in place.  */
+      for (q = line; *p != '\0'; )
+        if (*p == '\\' && p[1] != '\0')
+          {
+            p++;
+            switch (*p)
+              {
+              case 'n': *q++ = '\n'; p++; break;
+              case 't': *q++ = '\t'; p++; break;
+              case 'r': *q++ = '\r'; p++; break;
+              case '0': case '1': case '2': case '3':
+              case '4': case '5': case '6': case '7':
+                {
+                  int value = 0;
+                  int i;
+
+                  for (i = 0; i < 3 && *p >= '0' && *p <= '7'; i++, p++)
+                    value = value * 8 + (*p - '0');
+                  *q++ = (char) value;
+                }
+                break;
+              default: *q++ = *p++; break;
+              }
+          }
+        else
+          *q++ = *p++;
+      *q = '\0';
+
+      string_list_append (result, line);
+    }
+
+  if (ferror (fp))
+    error (EXIT_FAILURE, errno, _("error while reading \"%s\""), filename);
+  if (fp != stdin)
+    fclose (fp);
+  free (line);
+
+  return result;
+}
+
+
+/* Perform all kinds of checks on all domains: plural expressions, format
+   strings, ...  Return the number of errors.  */
+static int
+check_domain_list ()
+{
+  struct msg_domain *domain;
+  int nerrors = 0;
+
+  for (domain = domain_list; domain != NULL; domain = domain->next)
+    nerrors +=
+      check_message_list (domain->mlp,
+                          /* Untranslated and fuzzy messages have already
+                             been dealt with during parsing, see below in
+                             msgfmt_frob_new_message.  */
+                          0, 0,
+                          1, check_format_strings, check_header,
+                          check_compatibility,
+                          check_accelerators, accelerator_char);
+
+  return nerrors;
+}
+
+
+/* Print the statistics about translations, preceded by the given file
+   names if non-NULL.  */
+static void
+print_statistics (const char *file_names)
+{
+  if (file_names != NULL)
+    /* TRANSLATORS: The prefix before a statistics message.  The argument
+       is a file name or a comma separated list of file names.  */
+    fprintf (stderr, _("%s: "), file_names);
+  fprintf (stderr,
+           ngettext ("%d translated message", "%d translated messages",
+                     msgs_translated),
+           msgs_translated);
+  if (msgs_fuzzy > 0)
+    fprintf (stderr,
+             ngettext (", %d fuzzy translation", ", %d fuzzy translations",
+                       msgs_fuzzy),
+             msgs_fuzzy);
+  if (msgs_untranslated > 0)
+    fprintf (stderr,
+             ngettext (", %d untranslated message",
+                       ", %d untranslated messages",
+                       msgs_untranslated),
+             msgs_untranslated);
+  fputs (".\n", stderr);
+}
+
+
+/* The prefix of the trailer of the .mo files written by --output-dir.
+   It is followed by the MD5 checksum of the input file and of the options
+   that influence the output, in hexadecimal.  */
+#define SOURCE_CHECKSUM_PREFIX "msgfmt-source-md5: "
+#define SOURCE_CHECKSUM_LENGTH \
+  (sizeof (SOURCE_CHECKSUM_PREFIX) - 1 + 2 * MD5_DIGEST_SIZE)
+
+/* Compute the trailer for the .mo file compiled from the given input file.
+   Return NULL if the input file cannot be read.  */
+static char *
+source_checksum (const char *filename)
+{
+  char *real_filename;
+  FILE *fp = open_catalog_file (filename, &real_filename, false);
+  struct md5_ctx ctx;
+  char options[100];
+  unsigned char digest[MD5_DIGEST_SIZE];
+  char *result;
+  char *p;
+  size_t i;
+
+  if (fp == NULL)
+    return NULL;
+
+  md5_init_ctx (&ctx);
+  for (;;)
+    {
+      char buf[4096];
+      size_t n = fread (buf, 1, sizeof (buf), fp);
+
+      if (n > 0)
+        md5_process_bytes (buf, n, &ctx);
+      if (n < sizeof (buf))
+        break;
+    }
+  if (ferror (fp))
+    {
+      fclose (fp);
+      return NULL;
+    }
+  fclose (fp);
+
+  /* Also take into account the version of this program and the options
+     that influence the contents of the .mo file.  */
+  sprintf (options, "%s %d %d %lu %d %d %d", VERSION,
+           (int) include_fuzzies, (int) include_untranslated,
+           (unsigned long) alignment, (int) byteswap, (int) no_hash_table,
+           (int) cluster_strings);
+  md5_process_bytes (options, strlen (options) + 1, &ctx);
+  if (hot_keys != NULL)
+    for (i = 0; i < hot_keys->nitems; i++)
+      md5_process_bytes (hot_keys->item[i], strlen (hot_keys->item[i]) + 1,
+                         &ctx);
+  md5_finish_ctx (&ctx, digest);
+
+  result = XNMALLOC (SOURCE_CHECKSUM_LENGTH + 1, char);
+  p = stpcpy (result, SOURCE_CHECKSUM_PREFIX);
+  for (i = 0; i < MD5_DIGEST_SIZE; i++)
+    {
+      sprintf (p, "%02x", digest[i]);
+      p += 2;
+    }
+
+  return result;
+}
+
+/* Test whether the given .mo file exists and ends with the given trailer.  */
+static bool
+is_up_to_date (const char *file_name, const char *trailer)
+{
+  FILE *fp = fopen (file_name, "rb");
+  char buf[SOURCE_CHECKSUM_LENGTH + 1];
+  bool result;
+
+  if (fp == NULL)
+    return false;
+  result =
+    (fseek (fp, - (long) sizeof (buf), SEEK_END) == 0
+     && fread (buf, 1, sizeof (buf), fp) == sizeof (buf)
+     && memcmp (buf, trailer, sizeof (buf)) == 0);
+  fclose (fp);
+
+  return result;
+}
+
+/* A po_xerror handler that does not exit after a fatal error in an input
+   file, but continues after the reading of that file.  */
+static void
+recovering_xerror (int severity,
+                   const struct message_ty *message,
+                   const char *filename, size_t lineno, size_t column,
+                   int multiline_p, const char *message_text)
+{
+  if (severity == PO_SEVERITY_FATAL_ERROR && fatal_error_recovery != NULL)
+    {
+      if (filename == NULL)
+        {
+          filename = fatal_error_file_name;
+          lineno = (size_t)(-1);
+        }
+      textmode_xerror (PO_SEVERITY_ERROR, message, filename, lineno, column,
+                       multiline_p, message_text);
+      longjmp (*fatal_error_recovery, 1);
+    }
+  textmode_xerror (severity, message, filename, lineno, column,
+                   multiline_p, message_text);
+}
+
+/* Compile each of the given input files NAME.po to output_dir/NAME.mo.
+   The files are processed in the given order, so that the diagnostics
+   appear in a deterministic order.  If SKIP_UP_TO_DATE is true, the input
+   files whose output file is up to date are not read.  An input file with
+   fatal errors produces no output file, but does not stop the others.  */
+static void
+compile_to_directory (string_list_ty *file_names,
+                      catalog_input_format_ty input_syntax,
+                      bool skip_up_to_date)
+{
+  void (*old_po_xerror) (int, const struct message_ty *, const char *, size_t,
+                         size_t, int, const char *)
+    = po_xerror;
+  size_t i;
+
+  po_xerror = recovering_xerror;
+  recover_from_fatal_errors = true;
+
+  for (i = 0; i < file_names->nitems; i++)
+    {
+      const char *file_name = file_names->item[i];
+      const char *base = basename (file_name);
+      size_t base_len = strlen (base);
+      char *domain_name;
+      char *mo_file_name;
+      char *trailer;
+      int nerrors;
+
+      if (strcmp (file_name, "-") == 0)
+        error (EXIT_FAILURE, 0, _("%s and %s are mutually exclusive"),
+               "--output-dir", "-");
+
+      /* Strip the .po suffix.  */
+      if (base_len > 3 && memcmp (base + base_len - 3, ".po", 3) == 0)
+        base_len -= 3;
+      domain_name = XNMALLOC (base_len + 1, char);
+      memcpy (domain_name, base, base_len);
+      domain_name[base_len] = '\0';
+      mo_file_name = xconcatenated_filename (output_dir, domain_name, ".mo");
+
+      /* Skip the file if its output is up to date.  */
+      trailer = source_checksum (file_name);
+      if (skip_up_to_date
+          && trailer != NULL && is_up_to_date (mo_file_name, trailer))
+        {
+          if (verbose)
+            fprintf (stderr, _("%s: up to date\n"), mo_file_name);
+          free (trailer);
+          free (mo_file_name);
+          free (domain_name);
+          continue;
+        }
+
+      domain_list = NULL;
+      current_domain = new_domain (domain_name, mo_file_name);
+      msgs_translated = msgs_untranslated = msgs_fuzzy = 0;
+
+      if (!read_catalog_file_msgfmt ((char *) file_name, input_syntax))
+        {
+          /* The file had fatal errors.  Go on with the next one.  */
+          exit_status = EXIT_FAILURE;
+          message_list_free (current_domain->mlp, 0);
+          free (current_domain);
+          current_domain = NULL;
+          domain_list = NULL;
+          if (trailer != NULL)
+            free (trailer);
+          free (mo_file_name);
+          free (domain_name);
+          continue;
+        }
+
+      /* Remove obsolete messages.  They were only needed for duplicate
+         checking.  */
+      message_list_remove_if_not (current_domain->mlp, is_nonobsolete);
+
+      nerrors = check_domain_list ();
+      if (nerrors > 0)
+        {
+          error (0, 0,
+                 ngettext ("%s: found %d fatal error",
+                           "%s: found %d fatal errors",
+                           nerrors),
+                 file_name, nerrors);
+          exit_status = EXIT_FAILURE;
+        }
+
+      /* Mark the output as up to date only if it was produced without
+         errors.  */
+      mo_trailer = (nerrors == 0 ? trailer : NULL);
+      if (msgdomain_write_mo (current_domain->mlp, domain_name, mo_file_name))
+        exit_status = EXIT_FAILURE;
+      mo_trailer = NULL;
+
+      if (verbose || do_statistics)
+        print_statistics (do_statistics + verbose >= 2 ? file_name : NULL);
+
+      message_list_free (current_domain->mlp, 0);
+      free (current_domain);
+      current_domain = NULL;
+      domain_list = NULL;
+      if (trailer != NULL)
+        free (trailer);
+    }
+
+  recover_from_fatal_errors = false;
+  po_xerror = old_po_xerror;
+}
+
+
 /* The rest of the file defines a subclass msgfmt_catalog_reader_ty of
    default_catalog_reader_ty.  Its particularities are:
    - The header entry check is performed on-the-fly.
@@ -920,7 +1345,7 @@ msgfmt_set_domain (default_catalog_reader_ty *this, char *name)
   /* If no output file was given, we change it with each `domain'
      directive.  */
   if (!java_mode && !csharp_mode && !csharp_resources_mode && !tcl_mode
-      && !qt_mode && output_file_name == NULL)
+      && !qt_mode && output_file_name == NULL && output_dir == NULL)
     {
       size_t correct;
 
@@ -1094,13 +1519,35 @@ static default_catalog_reader_class_ty msgfmt_methods =
 };
 
 
-/* Read .po file FILENAME and store translation pairs.  */
-static void
+/* Read .po file FILENAME and store translation pairs.  Return true if
+   successful.  A fatal error makes the program exit, or, if
+   recover_from_fatal_errors, makes this function return false.  */
+static bool
 read_catalog_file_msgfmt (char *filename, catalog_input_format_ty input_syntax)
 {
+  jmp_buf recovery;
   char *real_filename;
-  FILE *fp = open_catalog_file (filename, &real_filename, true);
-  default_catalog_reader_ty *pop;
+  FILE * volatile fp = NULL;
+  default_catalog_reader_ty * volatile pop = NULL;
+
+  if (recover_from_fatal_errors)
+    {
+      if (setjmp (recovery) != 0)
+        {
+          fatal_error_recovery = NULL;
+          /* catalog_reader_parse did not get to reset the count.  */
+          error_message_count = 0;
+          if (pop != NULL)
+            catalog_reader_free ((abstract_catalog_reader_ty *) pop);
+          if (fp != NULL && fp != stdin)
+            fclose (fp);
+          return false;
+        }
+      fatal_error_recovery = &recovery;
+      fatal_error_file_name = filename;
+    }
+
+  fp = open_catalog_file (filename, &real_filename, true);
 
   pop = default_catalog_reader_alloc (&msgfmt_methods);
   pop->handle_comments = false;
@@ -1124,4 +1571,7 @@ read_catalog_file_msgfmt (char *filename, catalog_input_format_ty input_syntax)
 
   if (fp != stdin)
     fclose (fp);
+
+  fatal_error_recovery = NULL;
+  return true;
 }
@@ -30,6 +30,10 @@
 #include <string.h>
 #include <stdarg.h>
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
 #include "c-ctype.h"
 #include "xalloc.h"
 #include "xvasprintf.h"
@@ -40,12 +44,23 @@
 #include "plural-table.h"
 #include "c-strstr.h"
 #include "message.h"
+#include "glthread/lock.h"
 #include "gettext.h"
 
 #define _(str) gettext (str)
 
 #define SIZEOF(a) (sizeof(a) / sizeof(a[0]))
 
+/* Minimum number of messages for which check_message_list distributes the
+   work across several threads.  */
+#define PARALLEL_CHECK_MIN 256
+
+
+/* The SIGFPE handler is process-wide.  When messages are checked or merged
+   on several threads, only one thread at a time may install it.  This lock
+   works with OpenMP as well as with the threads of parallel_for.  */
+gl_lock_define_initialized(static, sigfpe_lock)
+
 
 /* Evaluates the plural formula for min <= n <= max
    and returns the estimated number of times the value j was assumed.  */
@@ -65,6 +80,8 @@ plural_expression_histogram (const struct plural_distribution *self,
       unsigned long n;
       unsigned int count;
 
+      gl_lock_lock (sigfpe_lock);
+
       /* Protect against arithmetic exceptions.  */
       install_sigfpe_handler ();
 
@@ -80,6 +97,8 @@ plural_expression_histogram (const struct plural_distribution *self,
       /* End of protection against arithmetic exceptions.  */
       uninstall_sigfpe_handler ();
 
+      gl_lock_unlock (sigfpe_lock);
+
       return count;
     }
   else
@@ -539,9 +558,87 @@ check_plural (message_list_ty *mlp,
 }
 
 
+#ifdef _OPENMP
+
+/* Diagnostics that were signalled while checking one message.  When
+   messages are checked in parallel, they are collected here and emitted
+   afterwards, in the order of the messages.  */
+struct xerror_record
+{
+  int severity;
+  const message_ty *message;
+  const char *filename;
+  size_t lineno;
+  size_t column;
+  int multiline_p;
+  char *message_text;
+};
+struct xerror_buffer
+{
+  struct xerror_record *item;
+  size_t nitems;
+  size_t nitems_max;
+};
+
+/* The buffer of the message being checked by the current thread.  */
+static struct xerror_buffer *curr_buffer;
+#pragma omp threadprivate (curr_buffer)
+
+/* A po_xerror replacement that appends the diagnostic to curr_buffer.  */
+static void
+buffered_xerror (int severity,
+                 const struct message_ty *message,
+                 const char *filename, size_t lineno, size_t column,
+                 int multiline_p, const char *message_text)
+{
+  struct xerror_buffer *buffer = curr_buffer;
+  struct xerror_record *record;
+
+  if (buffer->nitems == buffer->nitems_max)
+    {
+      buffer->nitems_max = 2 * buffer->nitems_max + 4;
+      buffer->item =
+        (struct xerror_record *)
+        xrealloc (buffer->item,
+                  buffer->nitems_max * sizeof (struct xerror_record));
+    }
+  record = &buffer->item[buffer->nitems++];
+  record->severity = severity;
+  record->message = message;
+  record->filename = filename;
+  record->lineno = lineno;
+  record->column = column;
+  record->multiline_p = multiline_p;
+  record->message_text = xstrdup (message_text);
+}
+
+/* Emits the diagnostics collected in BUFFER through po_xerror, and frees
+   them.  */
+static void
+flush_xerror_buffer (struct xerror_buffer *buffer)
+{
+  size_t i;
+
+  for (i = 0; i < buffer->nitems; i++)
+    {
+      struct xerror_record *record = &buffer->item[i];
+
+      po_xerror (record->severity, record->message,
+                 record->filename, record->lineno, record->column,
+                 record->multiline_p, record->message_text);
+      free (record->message_text);
+    }
+  free (buffer->item);
+}
+
+#endif
+
 /* Signal an error when checking format strings.  */
 static const message_ty *curr_mp;
 static lex_pos_ty curr_msgid_pos;
+#ifdef _OPENMP
+ #pragma omp threadprivate (curr_mp, curr_msgid_pos)
+#endif
 static void
 formatstring_error_logger (const char *format, ...)
      __attribute__ ((__format__ (__printf__, 1, 2)));
@@ -889,6 +986,60 @@ check_message_list (message_list_ty *mlp,
     seen_errors += check_plural (mlp, ignore_untranslated_messages,
                                  ignore_fuzzy_messages, &distribution);
 
+#ifdef _OPENMP
+  if (mlp->nitems >= PARALLEL_CHECK_MIN && omp_get_max_threads () > 1)
+    {
+      /* Check the messages in parallel.  The checks signal their
+         diagnostics through po_xerror, which is not thread-safe.  Therefore
+         collect the diagnostics per message, and emit them afterwards in
+         the order of the messages, so that the output is the same as in
+         the sequential case.  */
+      struct xerror_buffer *buffers =
+        XCALLOC (mlp->nitems, struct xerror_buffer);
+      void (*saved_xerror) (int severity,
+                            const struct message_ty *message,
+                            const char *filename, size_t lineno,
+                            size_t column,
+                            int multiline_p, const char *message_text) =
+        po_xerror;
+      long int nn = mlp->nitems;
+      long int jj;
+
+      po_xerror = buffered_xerror;
+
+      /* The schedule is dynamic, because the time needed per message
+         varies a lot, depending on its format flags and plural forms.  */
+      #pragma omp parallel for schedule(dynamic,16) reduction(+:seen_errors)
+      for (jj = 0; jj < nn; jj++)
+        {
+          message_ty *mp = mlp->item[jj];
+
+          if (!mp->obsolete
+              && !(ignore_untranslated_messages && mp->msgstr[0] == '\0')
+              && !(ignore_fuzzy_messages && (mp->is_fuzzy && !is_header (mp))))
+            {
+              curr_buffer = &buffers[jj];
+              seen_errors += check_message (mp, &mp->pos,
+                                            check_newlines,
+                                            check_format_strings,
+                                            &distribution,
+                                            check_header, check_compatibility,
+                                            check_accelerators,
+                                            accelerator_char);
+              curr_buffer = NULL;
+            }
+        }
+
+      po_xerror = saved_xerror;
+
+      for (j = 0; j < mlp->nitems; j++)
+        flush_xerror_buffer (&buffers[j]);
+      free (buffers);
+
+      return seen_errors;
+    }
+#endif
+
   for (j = 0; j < mlp->nitems; j++)
     {
       message_ty *mp = mlp->item[j];
@@ -207,6 +207,66 @@ message_equal (const message_ty *mp1, const message_ty *mp2,
   return true;
 }
 
+bool
+message_template_equal (const message_ty *mp1, const message_ty *mp2,
+                        bool ignore_potcdate)
+{
+  size_t i, i1, i2;
+
+  if (!(mp1->msgctxt != NULL
+        ? mp2->msgctxt != NULL && strcmp (mp1->msgctxt, mp2->msgctxt) == 0
+        : mp2->msgctxt == NULL))
+    return false;
+
+  if (strcmp (mp1->msgid, mp2->msgid) != 0)
+    return false;
+
+  if (!(mp1->msgid_plural != NULL
+        ? mp2->msgid_plural != NULL
+          && strcmp (mp1->msgid_plural, mp2->msgid_plural) == 0
+        : mp2->msgid_plural == NULL))
+    return false;
+
+  if (is_header (mp1) && ignore_potcdate
+      ? !msgstr_equal_ignoring_potcdate (mp1->msgstr, mp1->msgstr_len,
+                                         mp2->msgstr, mp2->msgstr_len)
+      : !msgstr_equal (mp1->msgstr, mp1->msgstr_len,
+                       mp2->msgstr, mp2->msgstr_len))
+    return false;
+
+  /* Not compared: mp->pos, the position of the message in the POT file
+     itself, and mp->comment, which msgmerge takes from the PO file.  */
+
+  if (!string_list_equal (mp1->comment_dot, mp2->comment_dot))
+    return false;
+
+  i1 = mp1->filepos_count;
+  i2 = mp2->filepos_count;
+  if (i1 != i2)
+    return false;
+  for (i = 0; i < i1; i++)
+    if (!pos_equal (&mp1->filepos[i], &mp2->filepos[i]))
+      return false;
+
+  if (mp1->is_fuzzy != mp2->is_fuzzy)
+    return false;
+
+  for (i = 0; i < NFORMATS; i++)
+    if (mp1->is_format[i] != mp2->is_format[i])
+      return false;
+
+  if (!(mp1->range.min == mp2->range.min && mp1->range.max == mp2->range.max))
+    return false;
+
+  if (mp1->do_wrap != mp2->do_wrap)
+    return false;
+
+  if (mp1->obsolete != mp2->obsolete)
+    return false;
+
+  return true;
+}
+
 bool
 message_str_equal (const message_ty *mp1, const message_ty *mp2,
                bool ignore_potcdate)
@@ -39,6 +39,13 @@ extern bool
        message_equal (const message_ty *mp1, const message_ty *mp2,
                       bool ignore_potcdate);
 
+/* Test whether two messages of POT files lead to the same result when
+   msgmerge merges a translation with them.  Unlike message_equal, this
+   ignores the position of the messages in the POT files.  */
+extern bool
+       message_template_equal (const message_ty *mp1, const message_ty *mp2,
+                               bool ignore_potcdate);
+
 /* Test if the two messages have the same translations */
 extern bool
        message_str_equal (const message_ty *mp1, const message_ty *mp2,
@@ -22,11 +22,29 @@
 /* Specification.  */
 #include "msgl-fsearch.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
+#include "error.h"
 #include "xalloc.h"
+#include "xvasprintf.h"
+#include "binary-io.h"
+#include "fwriteerror.h"
+#include "md5.h"
 #include "po-charset.h"
+#include "parallel.h"
+#include "gettext.h"
+
+#define _(str) gettext (str)
 
 
 /* Fuzzy searching of L strings in a large set of N messages (assuming
@@ -71,110 +89,469 @@
    two similarity measures.  But all this doesn't matter much in practice.
 
    We chose n = 4 because for alphabetic languages, with n = 3 the occurrence
-   lists are likely too long.  (Well, with ideographic languages like Chinese,
-   n = 3 might actually be quite good.  Anyway, n = 4 is not bad in this case
-   either.)
+   lists are likely too long.  In ideographic scripts, however, a character
+   carries about as much information as a word, and messages that share a
+   few words rarely share a run of 4 characters.  Therefore an n-gram that
+   starts with a Chinese, Japanese or Korean character has only n = 3
+   characters.  The length of each n-gram depends only on its own
+   characters, so that a string that occurs in two messages yields the same
+   n-grams in both, even if the messages mix scripts.
 
    The units are characters in the current encoding.  Not just bytes,
-   because 4 consecutive bytes in UTF-8 or GB18030 don't mean much.  */
+   because 4 consecutive bytes in UTF-8 or GB18030 don't mean much.
+
+   The hash table and the lists are stored in two arrays:
+     - The hash table is an array of slots with open addressing.  The key
+       of a slot is the n-gram, with every character packed into a number.
+       The value is the number of messages in the list, and the position
+       of the list in the second array.
+     - The second array contains all lists, one after the other.  Each list
+       is sorted in ascending order and is stored as the differences between
+       consecutive indices, in a variable-length encoding that takes one
+       byte for the common small differences.
+   The arrays are built in two passes over the messages: the first pass
+   determines the n-grams and the size of each list, the second pass fills
+   in the lists.  Compared to a separately allocated list per n-gram, this
+   needs between a third and two thirds of the memory, and a search reads
+   consecutive memory.  */
 
 /* Each message is represented by its index in the message list.  */
 typedef unsigned int index_ty;
 
-/* An index list has its allocated size and length tacked at the front.
-   The indices are sorted in ascending order.  */
-typedef index_ty *index_list_ty;
-#define IL_ALLOCATED 0
-#define IL_LENGTH 1
+/* Length of the n-grams.  */
+#define GRAM_LENGTH 4
+/* Length of the n-grams that start with an ideographic character.  */
+#define IDEOGRAPHIC_GRAM_LENGTH 3
+
+/* An n-gram.  Each character is packed into a number: its bytes, read as
+   a big-endian number.  Since every character occupies at most 4 bytes
+   (see po-charset.c) and none contains a NUL byte, the number determines
+   the character.  A shorter n-gram is padded with zeroes.  */
+struct gram
+{
+  unsigned int c[GRAM_LENGTH];
+};
 
-/* Create a new index list containing only a given index.  */
-static inline index_list_ty
-new_index (index_ty idx)
+/* Pack the character at P, consisting of N bytes, into a number.  */
+static inline unsigned int
+character_code (const char *p, size_t n)
 {
-  index_ty *list = XNMALLOC (2 + 1, index_ty);
-  list[IL_ALLOCATED] = 1;
-  list[IL_LENGTH] = 1;
-  list[2] = idx;
+  unsigned int code = 0;
+  size_t i;
 
-  return list;
+  for (i = 0; i < n; i++)
+    code = (code << 8) | (unsigned char) p[i];
+  return code;
 }
 
-/* Add a given index, greater or equal than all previous indices, to an
-   index list.
-   Return the new index list, if it had to be reallocated, or NULL if it
-   didn't change.  */
-static inline index_list_ty
-addlast_index (index_list_ty list, index_ty idx)
+/* A block of two-byte characters of an East Asian encoding: those whose
+   first byte is between LEAD_MIN and LEAD_MAX and whose second byte is
+   between TRAIL_MIN and TRAIL_MAX.  */
+struct char_block
 {
-  index_list_ty result;
-  size_t length = list[IL_LENGTH];
+  unsigned char lead_min;
+  unsigned char lead_max;
+  unsigned char trail_min;
+  unsigned char trail_max;
+};
 
-  /* Look whether it should be inserted.  */
-  if (length > 0 && list[2 + (length - 1)] == idx)
-    return NULL;
+/* The blocks that hold symbols and the letters of the Greek, Cyrillic and
+   Latin scripts, in each East Asian encoding.  The other multibyte
+   characters are essentially the characters of the East Asian scripts.
+   Punctuation rows, which mix both kinds, are counted with the East Asian
+   characters.  Each list ends with an empty block.  */
+static const struct char_block euc_cn_blocks[] =
+{
+  { 0xA2, 0xA2, 0x00, 0xFF },   /* Numerals.  */
+  { 0xA6, 0xA9, 0x00, 0xFF },   /* Greek, Cyrillic, Pinyin, box drawing.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block euc_jp_blocks[] =
+{
+  { 0xA2, 0xA2, 0x00, 0xFF },   /* Symbols.  */
+  { 0xA6, 0xA8, 0x00, 0xFF },   /* Greek, Cyrillic, box drawing.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block euc_kr_blocks[] =
+{
+  { 0xA2, 0xA2, 0x00, 0xFF },   /* Symbols.  */
+  { 0xA5, 0xA6, 0x00, 0xFF },   /* Roman numerals, Greek, box drawing.  */
+  { 0xA8, 0xA9, 0x00, 0xFF },   /* Latin, circled letters.  */
+  { 0xAC, 0xAC, 0x00, 0xFF },   /* Cyrillic.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block euc_tw_blocks[] =
+{
+  { 0xA2, 0xA3, 0x00, 0xFF },   /* Symbols, box drawing.  */
+  { 0xA4, 0xA4, 0xF5, 0xFF },   /* Greek.  */
+  { 0xA5, 0xA5, 0x00, 0xC6 },   /* Greek.  */
+  { 0xA6, 0xA6, 0x00, 0xFF },   /* Circled numbers.  */
+  { 0xC2, 0xC2, 0x00, 0xFF },   /* Symbols.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block big5_blocks[] =
+{
+  { 0xA3, 0xA3, 0x44, 0x73 },   /* Greek.  */
+  { 0xC7, 0xC7, 0xB1, 0xFF },   /* Cyrillic, circled numbers.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block big5hkscs_blocks[] =
+{
+  { 0x88, 0x88, 0x56, 0xAA },   /* Latin.  */
+  { 0xA3, 0xA3, 0x44, 0x73 },   /* Greek.  */
+  { 0xC6, 0xC6, 0xA1, 0xBE },   /* Circled numbers.  */
+  { 0xC7, 0xC7, 0xF3, 0xFF },   /* Cyrillic.  */
+  { 0xC8, 0xC8, 0x00, 0x78 },   /* Cyrillic.  */
+  { 0xC8, 0xC8, 0xF5, 0xFF },   /* Latin.  */
+  { 0xF9, 0xF9, 0xDD, 0xFD },   /* Box drawing.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block shift_jis_blocks[] =
+{
+  { 0x81, 0x81, 0x9F, 0xFF },   /* Symbols.  */
+  { 0x83, 0x83, 0x9F, 0xFF },   /* Greek.  */
+  { 0x84, 0x84, 0x00, 0xFF },   /* Cyrillic, box drawing.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block johab_blocks[] =
+{
+  { 0xD9, 0xD9, 0x00, 0xFF },   /* Symbols.  */
+  { 0xDB, 0xDB, 0x00, 0xFF },   /* Roman numerals, Greek, box drawing.  */
+  { 0xDC, 0xDC, 0xA1, 0xAF },   /* Latin.  */
+  { 0xDC, 0xDC, 0xCD, 0xFF },   /* Circled letters.  */
+  { 0xDD, 0xDD, 0x00, 0x40 },   /* Latin.  */
+  { 0xDD, 0xDD, 0x5D, 0xA0 },   /* Parenthesized letters.  */
+  { 0xDE, 0xDE, 0xA1, 0xF1 },   /* Cyrillic.  */
+  { 0, 0, 0, 0 }
+};
+static const struct char_block no_blocks[] =
+{
+  { 0, 0, 0, 0 }
+};
 
-  /* Now make room for one more list element.  */
-  result = NULL;
-  if (length == list[IL_ALLOCATED])
-    {
-      size_t new_allocated = 2 * length - (length >> 6);
-      list = (index_ty *) xrealloc (list, (2 + new_allocated) * sizeof (index_ty));
-      list[IL_ALLOCATED] = new_allocated;
-      result = list;
-    }
-  list[2 + length] = idx;
-  list[IL_LENGTH] = length + 1;
-  return result;
-}
-
-/* Add a given index to an index list.
-   Return the new index list, if it had to be reallocated, or NULL if it
-   didn't change.  */
-static inline index_list_ty
-add_index (index_list_ty list, index_ty idx)
-{
-  index_list_ty result;
-  size_t length = list[IL_LENGTH];
-
-  /* Look where it should be inserted.  */
-  size_t lo = 0;
-  size_t hi = length;
-  while (lo < hi)
-    {
-      /* Here we know that idx must be inserted at a position >= lo, <= hi.  */
-      size_t mid = (lo + hi) / 2; /* lo <= mid < hi */
-      index_ty val = list[2 + mid];
-      if (val < idx)
-        lo = mid + 1;
-      else if (val > idx)
-        hi = mid;
-      else
-        return NULL;
+/* Return the list of blocks for the canonicalized encoding CANON_CHARSET.
+   The encodings are those for which po_charset_character_iterator has a
+   multibyte iterator.  */
+static const struct char_block *
+non_ideographic_blocks (const char *canon_charset)
+{
+  if (strcmp (canon_charset, "GB2312") == 0
+      || strcmp (canon_charset, "GBK") == 0
+      || strcmp (canon_charset, "GB18030") == 0)
+    return euc_cn_blocks;
+  if (strcmp (canon_charset, "EUC-JP") == 0)
+    return euc_jp_blocks;
+  if (strcmp (canon_charset, "EUC-KR") == 0)
+    return euc_kr_blocks;
+  if (strcmp (canon_charset, "EUC-TW") == 0)
+    return euc_tw_blocks;
+  if (strcmp (canon_charset, "BIG5") == 0)
+    return big5_blocks;
+  if (strcmp (canon_charset, "BIG5-HKSCS") == 0)
+    return big5hkscs_blocks;
+  if (strcmp (canon_charset, "SHIFT_JIS") == 0)
+    return shift_jis_blocks;
+  if (strcmp (canon_charset, "JOHAB") == 0)
+    return johab_blocks;
+  return no_blocks;
+}
+
+/* Test whether the two-byte character C1 C2 lies in one of BLOCKS.  */
+static inline bool
+in_char_blocks (const struct char_block *blocks,
+                unsigned char c1, unsigned char c2)
+{
+  for (; blocks->lead_min != 0; blocks++)
+    if (c1 >= blocks->lead_min && c1 <= blocks->lead_max
+        && c2 >= blocks->trail_min && c2 <= blocks->trail_max)
+      return true;
+  return false;
+}
+
+/* Return true if the character at P, consisting of N bytes, belongs to
+   one of the scripts that are written without spaces between words: Han
+   ideographs, Hiragana, Katakana, Hangul syllables, and the punctuation
+   and fullwidth forms used with them.  UTF8 tells whether the encoding is
+   UTF-8; otherwise BLOCKS are the blocks of the encoding, as returned by
+   non_ideographic_blocks.  */
+static inline bool
+is_ideographic (const char *p, size_t n, bool utf8,
+                const struct char_block *blocks)
+{
+  const unsigned char *s = (const unsigned char *) p;
+  unsigned int uc;
+
+  if (n == 1)
+    return false;
+  if (!utf8)
+    switch (n)
+      {
+      case 2:
+        return !in_char_blocks (blocks, s[0], s[1]);
+      case 3:
+        /* EUC-JP, JIS X 0212.  Rows 2 to 11 hold symbols and letters.  */
+        return s[1] >= 0xAC;
+      case 4:
+        if (s[1] >= 0xA1)
+          /* EUC-TW.  Plane 1 is the same as in the two-byte form.  */
+          return s[1] != 0xA1 || !in_char_blocks (blocks, s[2], s[3]);
+        else
+          {
+            /* GB18030.  The four-byte characters are in the order of their
+               Unicode code points, so the ranges below are those of the
+               UTF-8 case.  */
+            unsigned int index =
+              (((s[0] - 0x81) * 10 + (s[1] - 0x30)) * 126 + (s[2] - 0x81))
+              * 10 + (s[3] - 0x30);
+
+            if (s[0] >= 0x90)
+              /* U+20000..U+3FFFF.  */
+              return (index >= 189000 + 0x10000 && index < 189000 + 0x30000);
+            return ((index >= 11328 && index <= 19132)   /* U+2E80..U+9FFF */
+                    || (index >= 22205 && index <= 33388)   /* U+AC00.. */
+                    || (index >= 37801 && index <= 38291)   /* U+F900.. */
+                    || (index >= 39264 && index <= 39403)); /* U+FF00.. */
+          }
+      default:
+        return false;
+      }
+  switch (n)
+    {
+    case 3:
+      uc = ((s[0] & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
+      return ((uc >= 0x2e80 && uc < 0xa000)
+              || (uc >= 0xac00 && uc < 0xd7b0)
+              || (uc >= 0xf900 && uc < 0xfb00)
+              || (uc >= 0xff00 && uc < 0xfff0));
+    case 4:
+      uc = ((s[0] & 0x07) << 18) | ((s[1] & 0x3f) << 12)
+           | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
+      return (uc >= 0x20000 && uc < 0x40000);
+    default:
+      return false;
+    }
+}
+
+/* Iterates through the n-grams of a string.  */
+struct gram_iterator
+{
+  character_iterator_t iterator;
+  bool utf8;
+  const struct char_block *blocks;
+  const char *p;
+  size_t filled;
+  /* The last GRAM_LENGTH characters.  */
+  unsigned int window[GRAM_LENGTH];
+  /* Bit i is set if window[GRAM_LENGTH - 1 - i] is ideographic.  */
+  unsigned int ideographic;
+  /* True if the 3-gram at the end of the window has not yet been
+     returned.  */
+  bool pending;
+  struct gram gram;
+};
+
+static inline void
+gram_iterator_init (struct gram_iterator *iter,
+                    character_iterator_t iterator, bool utf8,
+                    const struct char_block *blocks, const char *str)
+{
+  iter->iterator = iterator;
+  iter->utf8 = utf8;
+  iter->blocks = blocks;
+  iter->p = str;
+  iter->filled = 0;
+  iter->ideographic = 0;
+  iter->pending = false;
+}
+
+/* Store the next n-gram in ITER->gram.  Return false at the end of the
+   string.
+   Each character adds up to two n-grams: the 4-gram that it ends, if it
+   does not start with an ideographic character, and the 3-gram that it
+   ends, if it does.  */
+static inline bool
+gram_iterator_next (struct gram_iterator *iter)
+{
+  if (!iter->pending)
+    for (;;)
+      {
+        size_t n;
+        bool gram4;
+        bool gram3;
+        size_t i;
+
+        if (*iter->p == '\0')
+          return false;
+
+        n = iter->iterator (iter->p);
+        for (i = 1; i < GRAM_LENGTH; i++)
+          iter->window[i - 1] = iter->window[i];
+        iter->window[GRAM_LENGTH - 1] = character_code (iter->p, n);
+        iter->ideographic =
+          ((iter->ideographic << 1) | is_ideographic (iter->p, n, iter->utf8,
+                                                iter->blocks))
+          & ((1U << GRAM_LENGTH) - 1);
+        iter->p += n;
+        iter->filled++;
+
+        gram4 = (iter->filled >= GRAM_LENGTH
+                 && !(iter->ideographic & (1U << (GRAM_LENGTH - 1))));
+        gram3 = (iter->filled >= IDEOGRAPHIC_GRAM_LENGTH
+                 && (iter->ideographic
+                     & (1U << (IDEOGRAPHIC_GRAM_LENGTH - 1))));
+        if (gram4)
+          {
+            for (i = 0; i < GRAM_LENGTH; i++)
+              iter->gram.c[i] = iter->window[i];
+            iter->pending = gram3;
+            return true;
+          }
+        if (gram3)
+          break;
+      }
+
+  /* Return the 3-gram at the end of the window.  */
+  iter->pending = false;
+  iter->gram.c[0] = iter->window[1];
+  iter->gram.c[1] = iter->window[2];
+  iter->gram.c[2] = iter->window[3];
+  iter->gram.c[3] = 0;
+  return true;
+}
+
+/* Return the hash code of an n-gram.  If this function is changed, the
+   FINDEX_FILE_REVISION must be changed as well.  */
+static inline size_t
+gram_hash (const struct gram *gram)
+{
+  unsigned int h = 0;
+  size_t i;
+
+  for (i = 0; i < GRAM_LENGTH; i++)
+    h = (h ^ gram->c[i]) * 0x01000193U;
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  return h;
+}
+
+/* A slot of the hash table.  An empty slot has gram.c[0] == 0, which
+   cannot be the code of a character.  */
+struct gram_slot
+{
+  struct gram gram;
+  /* Number of messages containing the n-gram.  */
+  index_ty count;
+  /* While the index is built: the last message entered in the list.
+     Otherwise 0.  */
+  index_ty last;
+  /* Position of the list of these messages in the postings array.
+     While the index is built: first the size of the list, then the
+     position where the next message is stored.  */
+  size_t offset;
+};
+
+/* Value of the 'last' field of a slot whose list is still empty.  */
+#define NO_INDEX ((index_ty) -1)
+
+/* Find the slot of an n-gram in a hash table with MASK + 1 slots, or
+   the empty slot where it would be inserted.  Return NULL if the n-gram is
+   not present and there is no empty slot; this can only happen with a
+   damaged index file.  */
+static inline const struct gram_slot *
+gram_table_lookup (const struct gram_slot *table, size_t mask,
+                   const struct gram *gram)
+{
+  size_t i = gram_hash (gram) & mask;
+  size_t n;
+
+  for (n = 0; n <= mask; n++, i = (i + 1) & mask)
+    {
+      const struct gram_slot *slot = &table[i];
+
+      if (slot->gram.c[0] == 0
+          || memcmp (&slot->gram, gram, sizeof (struct gram)) == 0)
+        return slot;
+    }
+  return NULL;
+}
+
+/* Append the variable-length encoding of VALUE at P.  Return the position
+   after it.  */
+static inline unsigned char *
+put_number (unsigned char *p, index_ty value)
+{
+  while (value >= 0x80)
+    {
+      *p++ = (value & 0x7f) | 0x80;
+      value >>= 7;
+    }
+  *p++ = value;
+  return p;
+}
+
+/* Return the number of bytes of the variable-length encoding of VALUE.  */
+static inline size_t
+number_size (index_ty value)
+{
+  size_t size = 1;
+
+  while (value >= 0x80)
+    {
+      size++;
+      value >>= 7;
     }
+  return size;
+}
 
-  /* Now make room for one more list element.  */
-  result = NULL;
-  if (length == list[IL_ALLOCATED])
+/* Decode a number at *PP, before END.  Return false if it is incomplete.  */
+static inline bool
+get_number (const unsigned char **pp, const unsigned char *end,
+            index_ty *valuep)
+{
+  const unsigned char *p = *pp;
+  index_ty value = 0;
+  unsigned int shift;
+
+  for (shift = 0; p < end && shift < 32; shift += 7)
     {
-      size_t new_allocated = 2 * length - (length >> 6);
-      list = (index_ty *) xrealloc (list, (2 + new_allocated) * sizeof (index_ty));
-      list[IL_ALLOCATED] = new_allocated;
-      result = list;
+      unsigned char c = *p++;
+
+      value |= (index_ty) (c & 0x7f) << shift;
+      if (c < 0x80)
+        {
+          *pp = p;
+          *valuep = value;
+          return true;
+        }
     }
-  list[IL_LENGTH] = length + 1;
-  for (; length > hi; length--)
-    list[2 + length] = list[1 + length];
-  list[2 + length] = idx;
-  return result;
+  return false;
 }
 
 /* We use 4-grams, therefore strings with less than 4 characters cannot be
    handled through the 4-grams table and need to be handled specially.
+   (A string of 3 ideographic characters has a 3-gram, but a single n-gram
+   is not enough to find the similar messages.)
    Since every character occupies at most 4 bytes (see po-charset.c),
    this means the size of such short strings is bounded by:  */
-#define SHORT_STRING_MAX_CHARACTERS (4 - 1)
+#define SHORT_STRING_MAX_CHARACTERS (GRAM_LENGTH - 1)
 #define SHORT_STRING_MAX_BYTES (SHORT_STRING_MAX_CHARACTERS * 4)
 
+/* Test whether STR is such a short string.  */
+static inline bool
+is_short_string (character_iterator_t iterator, const char *str)
+{
+  size_t i;
+
+  for (i = 0; i < GRAM_LENGTH; i++)
+    {
+      if (*str == '\0')
+        return true;
+      str += iterator (str);
+    }
+  return false;
+}
+
 /* Such short strings are handled by direct comparison with all messages
    of appropriate size.  Note that for two strings of length 0 <= l1 <= l2,
    fstrcmp() is <= 2 * l1 / (l1 + l2).  Since we are only interested in
@@ -189,110 +566,435 @@ add_index (index_list_ty list, index_ty idx)
 struct message_fuzzy_index_ty
 {
   message_ty **messages;
+  /* Number of messages.  */
+  size_t nmessages;
   character_iterator_t iterator;
-  hash_table gram4;
+  /* True if the encoding is UTF-8.  */
+  bool utf8;
+  /* Otherwise, the blocks of the encoding, for is_ideographic.  */
+  const struct char_block *blocks;
+  /* The hash table, with table_mask + 1 slots.  */
+  const struct gram_slot *table;
+  size_t table_mask;
+  /* The lists of messages.  */
+  const unsigned char *postings;
+  size_t postings_size;
   size_t firstfew;
   message_list_ty *short_messages[SHORT_MSG_MAX + 1];
+  /* The contents of the file from which the arrays were taken, or NULL
+     if they were built in memory.  */
+  void *file_data;
+  size_t file_size;
+  bool file_mmapped;
 };
 
-/* Allocate a fuzzy index corresponding to a given list of messages.
-   The list of messages and the msgctxt and msgid fields of the messages
-   inside it must not be modified while the returned fuzzy index is in use.  */
-message_fuzzy_index_ty *
-message_fuzzy_index_alloc (const message_list_ty *mlp,
-                           const char *canon_charset)
+/* Test whether a message is entered in the fuzzy index.  */
+static inline bool
+is_indexed (const message_ty *mp)
+{
+  return mp->msgstr != NULL && mp->msgstr[0] != '\0';
+}
+
+/* Allocate an empty fuzzy index.  */
+static message_fuzzy_index_ty *
+fuzzy_index_new (const message_list_ty *mlp, const char *canon_charset)
 {
   message_fuzzy_index_ty *findex = XMALLOC (message_fuzzy_index_ty);
-  size_t count = mlp->nitems;
-  size_t j;
-  size_t l;
 
   findex->messages = mlp->item;
+  findex->nmessages = mlp->nitems;
   findex->iterator = po_charset_character_iterator (canon_charset);
+  findex->utf8 = (canon_charset == po_charset_utf8);
+  findex->blocks = non_ideographic_blocks (canon_charset);
+  findex->table = NULL;
+  findex->table_mask = 0;
+  findex->postings = NULL;
+  findex->postings_size = 0;
+  findex->file_data = NULL;
+  findex->file_size = 0;
+  findex->file_mmapped = false;
 
-  /* Setup hash table.  */
-  if (hash_init (&findex->gram4, 10 * count) < 0)
-    xalloc_die ();
-  for (j = 0; j < count; j++)
+  return findex;
+}
+
+/* Insert ENTRY, whose n-gram is not yet present, into a hash table with
+   MASK + 1 slots, at least one of which is empty.  Return the slot where it
+   is stored.
+   The slots are kept ordered: along a probe sequence, the slots that are
+   farther from their home slot come first, and among equally far slots the
+   smaller n-gram comes first.  This way, the layout of the table depends only
+   on the set of n-grams, not on the order in which they were added, and the
+   index is the same regardless of how its construction was parallelized.  */
+static struct gram_slot *
+gram_table_insert (struct gram_slot *table, size_t mask,
+                   struct gram_slot entry)
+{
+  struct gram_slot *result = NULL;
+  size_t i = gram_hash (&entry.gram) & mask;
+  size_t distance;
+
+  for (distance = 0; ; distance++, i = (i + 1) & mask)
+    {
+      struct gram_slot *slot = &table[i];
+      size_t slot_distance;
+
+      if (slot->gram.c[0] == 0)
+        {
+          *slot = entry;
+          return (result != NULL ? result : slot);
+        }
+      slot_distance = (i - gram_hash (&slot->gram)) & mask;
+      if (slot_distance < distance
+          || (slot_distance == distance
+              && memcmp (&slot->gram, &entry.gram, sizeof (struct gram)) > 0))
+        {
+          struct gram_slot tmp = *slot;
+
+          *slot = entry;
+          entry = tmp;
+          distance = slot_distance;
+          if (result == NULL)
+            result = slot;
+        }
+    }
+}
+
+/* Find or create the slot of GRAM in the hash table being built.  Grow the
+   table when it gets more than half full.  The returned pointer is valid
+   only until the next call.  */
+static struct gram_slot *
+gram_table_add (struct gram_slot **tablep, size_t *maskp, size_t *filledp,
+                const struct gram *gram)
+{
+  struct gram_slot *slot =
+    (struct gram_slot *) gram_table_lookup (*tablep, *maskp, gram);
+  struct gram_slot entry;
+
+  if (slot->gram.c[0] != 0)
+    return slot;
+
+  if (2 * (*filledp + 1) > *maskp + 1)
+    {
+      /* Double the size of the table.  */
+      size_t old_size = *maskp + 1;
+      size_t new_mask = 2 * old_size - 1;
+      struct gram_slot *new_table =
+        (struct gram_slot *) xcalloc (new_mask + 1, sizeof (struct gram_slot));
+      size_t i;
+
+      for (i = 0; i < old_size; i++)
+        if ((*tablep)[i].gram.c[0] != 0)
+          gram_table_insert (new_table, new_mask, (*tablep)[i]);
+      free (*tablep);
+      *tablep = new_table;
+      *maskp = new_mask;
+    }
+  entry.gram = *gram;
+  entry.count = 0;
+  entry.last = NO_INDEX;
+  entry.offset = 0;
+  (*filledp)++;
+  return gram_table_insert (*tablep, *maskp, entry);
+}
+
+/* The hash table and the lists of the messages with indices START <= j < END,
+   built separately from the other messages.  */
+struct gram_block
+{
+  size_t start;
+  size_t end;
+  struct gram_slot *table;
+  size_t mask;
+  unsigned char *postings;
+};
+
+/* Build the hash table and the lists of the messages of BLOCK.  Afterwards,
+   the lists are laid out in the order of the slots, the offset of each slot
+   is the position where its list ends, and the last field of each slot is
+   the last message in its list.  */
+static void
+gram_block_build (struct gram_block *block, const message_list_ty *mlp,
+                  const message_fuzzy_index_ty *findex)
+{
+  struct gram_slot *table;
+  size_t mask;
+  size_t filled;
+  unsigned char *postings;
+  size_t postings_size;
+  size_t i;
+  size_t j;
+
+  mask = 1023;
+  filled = 0;
+  table = (struct gram_slot *) xcalloc (mask + 1, sizeof (struct gram_slot));
+
+  /* First pass: Determine the n-grams and the size of their lists.  */
+  for (j = block->start; j < block->end; j++)
     {
       message_ty *mp = mlp->item[j];
 
-      if (mp->msgstr != NULL && mp->msgstr[0] != '\0')
+      if (is_indexed (mp))
         {
-          const char *str = mp->msgid;
+          struct gram_iterator iter;
 
-          /* Let p0 < p1 < p2 < p3 < p4 walk through the string.  */
-          const char *p0 = str;
-          if (*p0 != '\0')
+          gram_iterator_init (&iter, findex->iterator, findex->utf8,
+                              findex->blocks, mp->msgid);
+          while (gram_iterator_next (&iter))
             {
-              const char *p1 = p0 + findex->iterator (p0);
-              if (*p1 != '\0')
+              struct gram_slot *slot =
+                gram_table_add (&table, &mask, &filled, &iter.gram);
+
+              /* Enter each message only once in a list.  */
+              if (slot->last != j)
                 {
-                  const char *p2 = p1 + findex->iterator (p1);
-                  if (*p2 != '\0')
-                    {
-                      const char *p3 = p2 + findex->iterator (p2);
-                      if (*p3 != '\0')
-                        {
-                          const char *p4 = p3 + findex->iterator (p3);
-                          for (;;)
-                            {
-                              /* The segment from p0 to p4 is a 4-gram of
-                                 characters.  Add a hash table entry that maps
-                                 it to the index j, or extend the existing
-                                 hash table entry accordingly.  */
-                              void *found;
-
-                              if (hash_find_entry (&findex->gram4, p0, p4 - p0,
-                                                   &found) == 0)
-                                {
-                                  index_list_ty list = (index_list_ty) found;
-                                  list = addlast_index (list, j);
-                                  if (list != NULL)
-                                    hash_set_value (&findex->gram4, p0, p4 - p0,
-                                                    list);
-                                }
-                              else
-                                hash_insert_entry (&findex->gram4, p0, p4 - p0,
-                                                   new_index (j));
-
-                              /* Advance.  */
-                              if (*p4 == '\0')
-                                break;
-                              p0 = p1;
-                              p1 = p2;
-                              p2 = p3;
-                              p3 = p4;
-                              p4 = p4 + findex->iterator (p4);
-                            }
-                        }
-                    }
+                  slot->offset +=
+                    number_size (slot->last == NO_INDEX ? j : j - slot->last);
+                  slot->count++;
+                  slot->last = j;
                 }
             }
         }
     }
 
-  /* Shrink memory used by the hash table.  */
-  {
-    void *iter;
-    const void *key;
-    size_t keylen;
-    void **valuep;
-
-    iter = NULL;
-    while (hash_iterate_modify (&findex->gram4, &iter, &key, &keylen, &valuep)
-           == 0)
+  /* Lay out the lists.  */
+  postings_size = 0;
+  for (i = 0; i <= mask; i++)
+    if (table[i].gram.c[0] != 0)
       {
-        index_list_ty list = (index_list_ty) *valuep;
-        index_ty length = list[IL_LENGTH];
+        size_t size = table[i].offset;
+
+        table[i].offset = postings_size;
+        table[i].last = NO_INDEX;
+        postings_size += size;
+      }
+  postings = XNMALLOC (postings_size, unsigned char);
+
+  /* Second pass: Fill in the lists.  */
+  for (j = block->start; j < block->end; j++)
+    {
+      message_ty *mp = mlp->item[j];
+
+      if (is_indexed (mp))
+        {
+          struct gram_iterator iter;
+
+          gram_iterator_init (&iter, findex->iterator, findex->utf8,
+                              findex->blocks, mp->msgid);
+          while (gram_iterator_next (&iter))
+            {
+              struct gram_slot *slot =
+                (struct gram_slot *)
+                gram_table_lookup (table, mask, &iter.gram);
+
+              if (slot->last != j)
+                {
+                  slot->offset =
+                    put_number (postings + slot->offset,
+                                slot->last == NO_INDEX ? j : j - slot->last)
+                    - postings;
+                  slot->last = j;
+                }
+            }
+        }
+    }
+
+  block->table = table;
+  block->mask = mask;
+  block->postings = postings;
+}
+
+/* Combine the hash tables and lists of NBLOCKS blocks, in the order of the
+   messages, into a single hash table and postings array.  The list of an
+   n-gram is the concatenation of its lists in the blocks, except that the
+   first index of each part is stored relative to the last index of the
+   previous part.  */
+static void
+gram_blocks_combine (const struct gram_block *blocks, size_t nblocks,
+                     struct gram_slot **tablep, size_t *maskp,
+                     unsigned char **postingsp)
+{
+  struct gram_slot *table;
+  size_t mask;
+  size_t filled;
+  unsigned char *postings;
+  size_t postings_size;
+  size_t b;
+  size_t i;
+
+  mask = 1023;
+  filled = 0;
+  table = (struct gram_slot *) xcalloc (mask + 1, sizeof (struct gram_slot));
+
+  /* Determine the size of the combined lists.  */
+  for (b = 0; b < nblocks; b++)
+    {
+      const struct gram_block *block = &blocks[b];
+      size_t start = 0;
 
-        if (length < list[IL_ALLOCATED])
+      for (i = 0; i <= block->mask; i++)
+        if (block->table[i].gram.c[0] != 0)
           {
-            list[IL_ALLOCATED] = length;
-            *valuep = xrealloc (list, (2 + length) * sizeof (index_ty));
+            const struct gram_slot *part = &block->table[i];
+            const unsigned char *p = block->postings + start;
+            struct gram_slot *slot =
+              gram_table_add (&table, &mask, &filled, &part->gram);
+            index_ty first;
+
+            get_number (&p, block->postings + part->offset, &first);
+            slot->offset += part->offset - start;
+            if (slot->last != NO_INDEX)
+              slot->offset +=
+                number_size (first - slot->last) - number_size (first);
+            slot->count += part->count;
+            slot->last = part->last;
+            start = part->offset;
           }
+    }
+
+  /* Lay out the lists.  */
+  postings_size = 0;
+  for (i = 0; i <= mask; i++)
+    if (table[i].gram.c[0] != 0)
+      {
+        size_t size = table[i].offset;
+
+        table[i].offset = postings_size;
+        table[i].last = NO_INDEX;
+        postings_size += size;
       }
-  }
+  postings = XNMALLOC (postings_size, unsigned char);
+
+  /* Copy the lists.  */
+  for (b = 0; b < nblocks; b++)
+    {
+      const struct gram_block *block = &blocks[b];
+      size_t start = 0;
+
+      for (i = 0; i <= block->mask; i++)
+        if (block->table[i].gram.c[0] != 0)
+          {
+            const struct gram_slot *part = &block->table[i];
+            const unsigned char *p = block->postings + start;
+            const unsigned char *part_end = block->postings + part->offset;
+            struct gram_slot *slot =
+              (struct gram_slot *)
+              gram_table_lookup (table, mask, &part->gram);
+            unsigned char *q = postings + slot->offset;
+            index_ty first;
+
+            get_number (&p, part_end, &first);
+            q = put_number (q, slot->last == NO_INDEX
+                               ? first
+                               : first - slot->last);
+            memcpy (q, p, part_end - p);
+            slot->offset = (q - postings) + (part_end - p);
+            slot->last = part->last;
+            start = part->offset;
+          }
+    }
+
+  *tablep = table;
+  *maskp = mask;
+  *postingsp = postings;
+}
+
+/* The messages are distributed among blocks of at least this size, when
+   several threads are available.  */
+#define MIN_BLOCK_MESSAGES 4096
+
+struct gram_blocks_loop
+{
+  struct gram_block *blocks;
+  const message_list_ty *mlp;
+  const message_fuzzy_index_ty *findex;
+};
+
+static void
+gram_blocks_build_one (void *data, size_t b)
+{
+  struct gram_blocks_loop *loop = (struct gram_blocks_loop *) data;
+
+  gram_block_build (&loop->blocks[b], loop->mlp, loop->findex);
+}
+
+/* Build the hash table and the lists of FINDEX.  */
+static void
+fuzzy_index_build_grams (message_fuzzy_index_ty *findex,
+                         const message_list_ty *mlp)
+{
+  size_t count = mlp->nitems;
+  size_t nblocks;
+  struct gram_block *blocks;
+  struct gram_slot *table;
+  size_t mask;
+  unsigned char *postings;
+  size_t postings_size;
+  size_t b;
+  size_t i;
+
+  /* Build the parts of the index for blocks of messages, in parallel.  */
+  nblocks = count / MIN_BLOCK_MESSAGES;
+  if (nblocks > parallel_jobs ())
+    nblocks = parallel_jobs ();
+  if (nblocks == 0)
+    nblocks = 1;
+  blocks = XNMALLOC (nblocks, struct gram_block);
+  for (b = 0; b < nblocks; b++)
+    {
+      blocks[b].start = count / nblocks * b;
+      blocks[b].end = (b + 1 < nblocks ? count / nblocks * (b + 1) : count);
+    }
+  if (nblocks > 1)
+    {
+      struct gram_blocks_loop loop;
+
+      loop.blocks = blocks;
+      loop.mlp = mlp;
+      loop.findex = findex;
+      parallel_for (nblocks, gram_blocks_build_one, &loop);
+
+      gram_blocks_combine (blocks, nblocks, &table, &mask, &postings);
+      for (b = 0; b < nblocks; b++)
+        {
+          free (blocks[b].postings);
+          free (blocks[b].table);
+        }
+    }
+  else
+    {
+      gram_block_build (&blocks[0], mlp, findex);
+      table = blocks[0].table;
+      mask = blocks[0].mask;
+      postings = blocks[0].postings;
+    }
+  free (blocks);
+
+  /* Now the position of each list is where the next list begins.  */
+  postings_size = 0;
+  for (i = 0; i <= mask; i++)
+    if (table[i].gram.c[0] != 0)
+      {
+        size_t end = table[i].offset;
+
+        table[i].offset = postings_size;
+        table[i].last = 0;
+        postings_size = end;
+      }
+
+  findex->table = table;
+  findex->table_mask = mask;
+  findex->postings = postings;
+  findex->postings_size = postings_size;
+}
+
+/* Finish the initialization of FINDEX, once its hash table is filled.  */
+static void
+fuzzy_index_finish (message_fuzzy_index_ty *findex,
+                    const message_list_ty *mlp)
+{
+  size_t count = mlp->nitems;
+  size_t j;
+  size_t l;
 
   findex->firstfew = (int) sqrt ((double) count);
   if (findex->firstfew < 10)
@@ -305,7 +1007,7 @@ message_fuzzy_index_alloc (const message_list_ty *mlp,
     {
       message_ty *mp = mlp->item[j];
 
-      if (mp->msgstr != NULL && mp->msgstr[0] != '\0')
+      if (is_indexed (mp))
         {
           const char *str = mp->msgid;
           size_t len = strlen (str);
@@ -328,6 +1030,260 @@ message_fuzzy_index_alloc (const message_list_ty *mlp,
             xrealloc (mlp->item, mlp->nitems_max * sizeof (message_ty *));
         }
     }
+}
+
+/* Allocate a fuzzy index corresponding to a given list of messages.
+   The list of messages and the msgctxt and msgid fields of the messages
+   inside it must not be modified while the returned fuzzy index is in use.  */
+message_fuzzy_index_ty *
+message_fuzzy_index_alloc (const message_list_ty *mlp,
+                           const char *canon_charset)
+{
+  message_fuzzy_index_ty *findex = fuzzy_index_new (mlp, canon_charset);
+
+  fuzzy_index_build_grams (findex, mlp);
+  fuzzy_index_finish (findex, mlp);
+
+  return findex;
+}
+
+/* A fuzzy index can be stored in a file, so that a later run on the same
+   messages can use it instead of building it again.  This pays off for
+   large compendiums, which change rarely.  The file consists of
+     - a header, struct findex_file_header,
+     - the hash table, an array of struct gram_slot,
+     - the lists.
+   It is the memory image of the two arrays of the index, in the byte order
+   and with the alignment of the machine that wrote the file.  They are used
+   in place, from a memory mapping of the file.
+   The header contains an MD5 checksum of the canonical charset and of the
+   msgids of the messages.  A file whose checksum does not match the
+   messages, or that was written on a different kind of machine, is stale
+   and is replaced.  */
+
+#define FINDEX_FILE_MAGIC 0x58444946 /* "FIDX" */
+#define FINDEX_FILE_REVISION 3
+
+struct findex_file_header
+{
+  index_ty magic;
+  index_ty revision;
+  /* sizeof (struct gram_slot), as a check for the machine type.  */
+  index_ty slot_size;
+  /* Checksum of the charset and of the messages.  */
+  unsigned char checksum[MD5_DIGEST_SIZE];
+  /* Number of messages.  */
+  index_ty nmessages;
+  /* Number of slots of the hash table.  A power of 2.  */
+  size_t table_size;
+  /* Size of the lists.  */
+  size_t postings_size;
+};
+
+/* Compute the checksum that identifies the fuzzy index of a given list of
+   messages.  */
+static void
+fuzzy_index_checksum (const message_list_ty *mlp, const char *canon_charset,
+                      unsigned char checksum[MD5_DIGEST_SIZE])
+{
+  struct md5_ctx ctx;
+  size_t j;
+
+  md5_init_ctx (&ctx);
+  md5_process_bytes (canon_charset, strlen (canon_charset) + 1, &ctx);
+  for (j = 0; j < mlp->nitems; j++)
+    {
+      message_ty *mp = mlp->item[j];
+
+      if (is_indexed (mp))
+        {
+          md5_process_bytes ("\1", 1, &ctx);
+          md5_process_bytes (mp->msgid, strlen (mp->msgid) + 1, &ctx);
+        }
+      else
+        md5_process_bytes ("\0", 1, &ctx);
+    }
+  md5_finish_ctx (&ctx, checksum);
+}
+
+/* Release the contents of a fuzzy index file.  */
+static void
+fuzzy_index_file_release (void *data, size_t size, bool mmapped)
+{
+#if HAVE_MMAP
+  if (mmapped)
+    {
+      munmap (data, size);
+      return;
+    }
+#endif
+  free (data);
+}
+
+/* Try to take the arrays of FINDEX from the file FILENAME.  COUNT is the
+   number of messages and CHECKSUM their checksum.
+   Return true if successful, or false if the file does not exist or is
+   stale.  */
+static bool
+fuzzy_index_read_file (message_fuzzy_index_ty *findex, size_t count,
+                       const unsigned char checksum[MD5_DIGEST_SIZE],
+                       const char *filename)
+{
+  int fd;
+  struct stat statbuf;
+  size_t size;
+  char *data;
+  bool mmapped;
+  const struct findex_file_header *header;
+
+  fd = open (filename, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return false;
+  if (fstat (fd, &statbuf) < 0
+      || statbuf.st_size < sizeof (struct findex_file_header)
+      || statbuf.st_size != (size_t) statbuf.st_size)
+    {
+      close (fd);
+      return false;
+    }
+  size = statbuf.st_size;
+
+  data = NULL;
+  mmapped = false;
+#if HAVE_MMAP
+  data = (char *) mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data != (char *) MAP_FAILED)
+    mmapped = true;
+  else
+    data = NULL;
+#endif
+  if (data == NULL)
+    {
+      /* No mmap; read the whole file.  */
+      size_t done;
+
+      data = (char *) xmalloc (size);
+      for (done = 0; done < size; )
+        {
+          ssize_t n = read (fd, data + done, size - done);
+
+          if (n <= 0)
+            {
+              if (n < 0 && errno == EINTR)
+                continue;
+              free (data);
+              close (fd);
+              return false;
+            }
+          done += n;
+        }
+    }
+  close (fd);
+
+  /* Verify the header.  The contents of the arrays are verified during
+     the searches, so that a damaged file cannot lead to accesses outside
+     the file or outside the list of messages.  */
+  header = (const struct findex_file_header *) data;
+  if (!(header->magic == FINDEX_FILE_MAGIC
+        && header->revision == FINDEX_FILE_REVISION
+        && header->slot_size == sizeof (struct gram_slot)
+        && memcmp (header->checksum, checksum, MD5_DIGEST_SIZE) == 0
+        && header->nmessages == count
+        && header->table_size > 0
+        && (header->table_size & (header->table_size - 1)) == 0
+        && header->table_size
+           <= (size - sizeof (struct findex_file_header))
+              / sizeof (struct gram_slot)
+        && header->postings_size
+           == size - sizeof (struct findex_file_header)
+              - header->table_size * sizeof (struct gram_slot)))
+    {
+      fuzzy_index_file_release (data, size, mmapped);
+      return false;
+    }
+
+  findex->table =
+    (const struct gram_slot *) (data + sizeof (struct findex_file_header));
+  findex->table_mask = header->table_size - 1;
+  findex->postings =
+    (const unsigned char *) (findex->table + header->table_size);
+  findex->postings_size = header->postings_size;
+  findex->file_data = data;
+  findex->file_size = size;
+  findex->file_mmapped = mmapped;
+  return true;
+}
+
+/* Store the arrays of FINDEX in the file FILENAME.  COUNT is the number of
+   messages and CHECKSUM their checksum.  Failure is not fatal; the index
+   will then be built again next time.  */
+static void
+fuzzy_index_write_file (message_fuzzy_index_ty *findex, size_t count,
+                        const unsigned char checksum[MD5_DIGEST_SIZE],
+                        const char *filename)
+{
+  struct findex_file_header header;
+  char *tmpname;
+  FILE *fp;
+
+  memset (&header, 0, sizeof (header));
+  header.magic = FINDEX_FILE_MAGIC;
+  header.revision = FINDEX_FILE_REVISION;
+  header.slot_size = sizeof (struct gram_slot);
+  memcpy (header.checksum, checksum, MD5_DIGEST_SIZE);
+  header.nmessages = count;
+  header.table_size = findex->table_mask + 1;
+  header.postings_size = findex->postings_size;
+
+  /* Write to a temporary file first, and rename it at the end, so that
+     other processes never see an incomplete file.  */
+  tmpname = xasprintf ("%s.%lu", filename, (unsigned long) getpid ());
+  fp = fopen (tmpname, "wb");
+  if (fp == NULL)
+    {
+      error (0, errno, _("cannot create output file \"%s\""), tmpname);
+      free (tmpname);
+      return;
+    }
+
+  fwrite (&header, sizeof (header), 1, fp);
+  fwrite (findex->table, sizeof (struct gram_slot), header.table_size, fp);
+  fwrite (findex->postings, 1, findex->postings_size, fp);
+
+  if (fwriteerror (fp))
+    {
+      error (0, errno, _("error while writing \"%s\" file"), tmpname);
+      unlink (tmpname);
+    }
+  else if (rename (tmpname, filename) < 0
+           /* Some systems don't allow renaming over an existing file.  */
+           && (unlink (filename), rename (tmpname, filename) < 0))
+    {
+      error (0, errno, _("cannot create output file \"%s\""), filename);
+      unlink (tmpname);
+    }
+  free (tmpname);
+}
+
+/* Allocate a fuzzy index corresponding to a given list of messages, like
+   message_fuzzy_index_alloc, reusing the index stored in the file FILENAME
+   if it was made for the same messages.  Otherwise, build the index and
+   store it in FILENAME for the next time.  */
+message_fuzzy_index_ty *
+message_fuzzy_index_alloc_cached (const message_list_ty *mlp,
+                                  const char *canon_charset,
+                                  const char *filename)
+{
+  message_fuzzy_index_ty *findex = fuzzy_index_new (mlp, canon_charset);
+  unsigned char checksum[MD5_DIGEST_SIZE];
+
+  fuzzy_index_checksum (mlp, canon_charset, checksum);
+  if (!fuzzy_index_read_file (findex, mlp->nitems, checksum, filename))
+    {
+      fuzzy_index_build_grams (findex, mlp);
+      fuzzy_index_write_file (findex, mlp->nitems, checksum, filename);
+    }
+  fuzzy_index_finish (findex, mlp);
 
   return findex;
 }
@@ -362,18 +1318,34 @@ mult_index_list_init (struct mult_index_list *accu)
   accu->item2 = NULL;
 }
 
-/* Add an index list to a list of indices with multiplicity.  */
+/* Add the list of the n-gram in SLOT to a list of indices with
+   multiplicity.  */
 static inline void
-mult_index_list_accumulate (struct mult_index_list *accu, index_list_ty list)
+mult_index_list_accumulate (struct mult_index_list *accu,
+                            const message_fuzzy_index_ty *findex,
+                            const struct gram_slot *slot)
 {
   size_t len1 = accu->nitems;
-  size_t len2 = list[IL_LENGTH];
-  size_t need = len1 + len2;
+  size_t len2 = slot->count;
+  size_t need;
   struct mult_index *ptr1;
   struct mult_index *ptr1_end;
-  index_ty *ptr2;
-  index_ty *ptr2_end;
+  const unsigned char *ptr2;
+  const unsigned char *ptr2_end;
   struct mult_index *destptr;
+  index_ty index2;
+  index_ty delta;
+  bool have2;
+
+  /* Limit the damage that a damaged file can do.  Every entry of a list
+     occupies at least one byte.  */
+  if (slot->offset > findex->postings_size)
+    return;
+  if (len2 > findex->postings_size - slot->offset)
+    len2 = findex->postings_size - slot->offset;
+  if (len2 > findex->nmessages)
+    len2 = findex->nmessages;
+  need = len1 + len2;
 
   /* Make the work area large enough.  */
   if (accu->nitems2_max < need)
@@ -388,31 +1360,39 @@ mult_index_list_accumulate (struct mult_index_list *accu, index_list_ty list)
       accu->nitems2_max = new_max;
     }
 
-  /* Make a linear pass through accu and list simultaneously.  */
+  /* Make a linear pass through accu and the list simultaneously, decoding
+     the list on the fly.  A list from a damaged file ends at the first
+     invalid entry.  */
   ptr1 = accu->item;
   ptr1_end = ptr1 + len1;
-  ptr2 = list + 2;
-  ptr2_end = ptr2 + len2;
+  ptr2 = findex->postings + slot->offset;
+  ptr2_end = findex->postings + findex->postings_size;
   destptr = accu->item2;
-  while (ptr1 < ptr1_end && ptr2 < ptr2_end)
+  index2 = 0;
+#define NEXT2() \
+  (have2 = (len2 > 0 && get_number (&ptr2, ptr2_end, &delta)         \
+            && delta < findex->nmessages - index2                    \
+            && (index2 += delta, len2--, true)))
+  NEXT2 ();
+  while (ptr1 < ptr1_end && have2)
     {
-      if (ptr1->index < *ptr2)
+      if (ptr1->index < index2)
         {
           *destptr = *ptr1;
           ptr1++;
         }
-      else if (ptr1->index > *ptr2)
+      else if (ptr1->index > index2)
         {
-          destptr->index = *ptr2;
+          destptr->index = index2;
           destptr->count = 1;
-          ptr2++;
+          NEXT2 ();
         }
-      else /* ptr1->index == list[2 + i2] */
+      else /* ptr1->index == index2 */
         {
           destptr->index = ptr1->index;
           destptr->count = ptr1->count + 1;
           ptr1++;
-          ptr2++;
+          NEXT2 ();
         }
       destptr++;
     }
@@ -422,13 +1402,14 @@ mult_index_list_accumulate (struct mult_index_list *accu, index_list_ty list)
       ptr1++;
       destptr++;
     }
-  while (ptr2 < ptr2_end)
+  while (have2)
     {
-      destptr->index = *ptr2;
+      destptr->index = index2;
       destptr->count = 1;
-      ptr2++;
       destptr++;
+      NEXT2 ();
     }
+#undef NEXT2
 
   /* Swap accu->item and accu->item2.  */
   {
@@ -483,6 +1464,223 @@ mult_index_list_free (struct mult_index_list *accu)
     free (accu->item2);
 }
 
+/* The best matches found so far, at most K of them.  They are kept as a
+   heap whose root is the worst match.  Once there are K matches, only a
+   message that is better than the root can enter, therefore the weight of
+   the root is the lower bound for fstrcmp_bounded.  */
+struct match_heap
+{
+  struct match_heap_entry
+  {
+    message_ty *mp;
+    double weight;
+    /* The number of messages that entered before this one.  */
+    size_t seq;
+  } *item;
+  size_t count;
+  size_t k;
+  size_t seq;
+};
+
+/* Return true if the match A is worse than the match B.  Among matches of
+   equal weight, the later one is worse.  */
+static inline bool
+match_worse (const struct match_heap_entry *a,
+             const struct match_heap_entry *b)
+{
+  return a->weight < b->weight || (a->weight == b->weight && a->seq > b->seq);
+}
+
+/* Return the lower bound for a message to enter HEAP.  */
+static inline double
+match_heap_bound (const struct match_heap *heap, double lower_bound)
+{
+  return (heap->count < heap->k ? lower_bound : heap->item[0].weight);
+}
+
+/* Add the message MP of weight WEIGHT to HEAP.  WEIGHT must be greater than
+   match_heap_bound.  */
+static void
+match_heap_add (struct match_heap *heap, message_ty *mp, double weight)
+{
+  struct match_heap_entry *item = heap->item;
+  struct match_heap_entry entry;
+  size_t i;
+
+  entry.mp = mp;
+  entry.weight = weight;
+  entry.seq = heap->seq++;
+
+  if (heap->count < heap->k)
+    {
+      /* Move the entry up from a new leaf.  */
+      i = heap->count++;
+      while (i > 0 && match_worse (&entry, &item[(i - 1) / 2]))
+        {
+          item[i] = item[(i - 1) / 2];
+          i = (i - 1) / 2;
+        }
+    }
+  else
+    {
+      /* Replace the root and move the entry down.  */
+      i = 0;
+      for (;;)
+        {
+          size_t child = 2 * i + 1;
+
+          if (child >= heap->count)
+            break;
+          if (child + 1 < heap->count
+              && match_worse (&item[child + 1], &item[child]))
+            child++;
+          if (!match_worse (&item[child], &entry))
+            break;
+          item[i] = item[child];
+          i = child;
+        }
+    }
+  item[i] = entry;
+}
+
+/* Compare two matches, for sorting them from best to worst.  */
+static int
+match_compare (const void *p1, const void *p2)
+{
+  const struct match_heap_entry *a = (const struct match_heap_entry *) p1;
+  const struct match_heap_entry *b = (const struct match_heap_entry *) p2;
+
+  return (match_worse (b, a) ? -1 : match_worse (a, b) ? 1 : 0);
+}
+
+/* Find the at most K best matches for the given msgctxt and msgid in the
+   given fuzzy index.  */
+size_t
+message_fuzzy_index_search_best (message_fuzzy_index_ty *findex,
+                                 const char *msgctxt, const char *msgid,
+                                 double lower_bound,
+                                 bool heuristic,
+                                 size_t k, struct fuzzy_match *results)
+{
+  const char *str = msgid;
+  struct gram_iterator iter;
+  struct match_heap heap;
+  struct match_heap_entry one_item;
+  size_t i;
+
+  if (k == 0)
+    return 0;
+
+  heap.item = (k == 1 ? &one_item : XNMALLOC (k, struct match_heap_entry));
+  heap.count = 0;
+  heap.k = k;
+  heap.seq = 0;
+
+  gram_iterator_init (&iter, findex->iterator, findex->utf8,
+                      findex->blocks, str);
+  if (!is_short_string (findex->iterator, str) && gram_iterator_next (&iter))
+    {
+      struct mult_index_list accu;
+
+      mult_index_list_init (&accu);
+      do
+        {
+          /* Get the hash table entry of the n-gram, containing a list of
+             indices, and add it to the accu.  */
+          const struct gram_slot *slot =
+            gram_table_lookup (findex->table, findex->table_mask, &iter.gram);
+
+          if (slot != NULL && slot->gram.c[0] != 0)
+            mult_index_list_accumulate (&accu, findex, slot);
+        }
+      while (gram_iterator_next (&iter));
+
+      /* Sort in decreasing count order.  */
+      mult_index_list_sort (&accu);
+
+      /* Iterate over this sorted list, and maximize the
+         fuzzy_search_goal_function() result.
+         If HEURISTIC is true, take only the first few messages.
+         If HEURISTIC is false, consider all messages - to match
+         the behaviour of message_list_search_fuzzy -, but process
+         them in the order of the sorted list.  This increases
+         the chances that the later calls to fstrcmp_bounded() (via
+         fuzzy_search_goal_function()) terminate quickly, thanks
+         to the lower bound which will be quite high already after
+         the first few messages.  */
+      {
+        size_t count;
+        struct mult_index *ptr;
+
+        count = accu.nitems;
+        if (heuristic)
+          {
+            if (count > findex->firstfew)
+              count = findex->firstfew;
+          }
+
+        for (ptr = accu.item; count > 0; ptr++, count--)
+          {
+            message_ty *mp = findex->messages[ptr->index];
+            double bound = match_heap_bound (&heap, lower_bound);
+            double weight =
+              fuzzy_search_goal_function (mp, msgctxt, msgid, bound);
+
+            if (weight > bound)
+              match_heap_add (&heap, mp, weight);
+          }
+
+        mult_index_list_free (&accu);
+      }
+    }
+  else
+    {
+      /* The string had less than 4 characters.  */
+      size_t l = strlen (str);
+      size_t lmin, lmax;
+
+      if (!(l <= SHORT_STRING_MAX_BYTES))
+        abort ();
+
+      /* Walk through those short messages which have an appropriate length.
+         See the comment before SHORT_MSG_MAX.  */
+      lmin = (int) ceil (l / (2 / FUZZY_THRESHOLD - 1));
+      lmax = (int) (l * (2 / FUZZY_THRESHOLD - 1));
+      if (!(lmax <= SHORT_MSG_MAX))
+        abort ();
+
+      for (l = lmin; l <= lmax; l++)
+        {
+          message_list_ty *mlp = findex->short_messages[l];
+          size_t j;
+
+          for (j = 0; j < mlp->nitems; j++)
+            {
+              message_ty *mp = mlp->item[j];
+              double bound = match_heap_bound (&heap, lower_bound);
+              double weight =
+                fuzzy_search_goal_function (mp, msgctxt, msgid, bound);
+
+              if (weight > bound)
+                match_heap_add (&heap, mp, weight);
+            }
+        }
+    }
+
+  /* Return the matches from best to worst.  */
+  qsort (heap.item, heap.count, sizeof (struct match_heap_entry),
+         match_compare);
+  for (i = 0; i < heap.count; i++)
+    {
+      results[i].mp = heap.item[i].mp;
+      results[i].weight = heap.item[i].weight;
+    }
+  if (heap.item != &one_item)
+    free (heap.item);
+
+  return heap.count;
+}
+
 /* Find a good match for the given msgctxt and msgid in the given fuzzy index.
    The match does not need to be optimal.
    Ignore matches for which the fuzzy_search_goal_function is < LOWER_BOUND.
@@ -500,140 +1698,13 @@ message_fuzzy_index_search (message_fuzzy_index_ty *findex,
                             double lower_bound,
                             bool heuristic)
 {
-  const char *str = msgid;
+  struct fuzzy_match match;
 
-  /* Let p0 < p1 < p2 < p3 < p4 walk through the string.  */
-  const char *p0 = str;
-  if (*p0 != '\0')
-    {
-      const char *p1 = p0 + findex->iterator (p0);
-      if (*p1 != '\0')
-        {
-          const char *p2 = p1 + findex->iterator (p1);
-          if (*p2 != '\0')
-            {
-              const char *p3 = p2 + findex->iterator (p2);
-              if (*p3 != '\0')
-                {
-                  const char *p4 = p3 + findex->iterator (p3);
-                  struct mult_index_list accu;
-
-                  mult_index_list_init (&accu);
-                  for (;;)
-                    {
-                      /* The segment from p0 to p4 is a 4-gram of
-                         characters.  Get the hash table entry containing
-                         a list of indices, and add it to the accu.  */
-                      void *found;
-
-                      if (hash_find_entry (&findex->gram4, p0, p4 - p0,
-                                           &found) == 0)
-                        {
-                          index_list_ty list = (index_list_ty) found;
-                          mult_index_list_accumulate (&accu, list);
-                        }
-
-                      /* Advance.  */
-                      if (*p4 == '\0')
-                        break;
-                      p0 = p1;
-                      p1 = p2;
-                      p2 = p3;
-                      p3 = p4;
-                      p4 = p4 + findex->iterator (p4);
-                    }
-
-                  /* Sort in decreasing count order.  */
-                  mult_index_list_sort (&accu);
-
-                  /* Iterate over this sorted list, and maximize the
-                     fuzzy_search_goal_function() result.
-                     If HEURISTIC is true, take only the first few messages.
-                     If HEURISTIC is false, consider all messages - to match
-                     the behaviour of message_list_search_fuzzy -, but process
-                     them in the order of the sorted list.  This increases
-                     the chances that the later calls to fstrcmp_bounded() (via
-                     fuzzy_search_goal_function()) terminate quickly, thanks
-                     to the best_weight which will be quite high already after
-                     the first few messages.  */
-                  {
-                    size_t count;
-                    struct mult_index *ptr;
-                    message_ty *best_mp;
-                    double best_weight;
-
-                    count = accu.nitems;
-                    if (heuristic)
-                      {
-                        if (count > findex->firstfew)
-                          count = findex->firstfew;
-                      }
-
-                    best_weight = lower_bound;
-                    best_mp = NULL;
-                    for (ptr = accu.item; count > 0; ptr++, count--)
-                      {
-                        message_ty *mp = findex->messages[ptr->index];
-                        double weight =
-                          fuzzy_search_goal_function (mp, msgctxt, msgid,
-                                                      best_weight);
-
-                        if (weight > best_weight)
-                          {
-                            best_weight = weight;
-                            best_mp = mp;
-                          }
-                      }
-
-                    mult_index_list_free (&accu);
-
-                    return best_mp;
-                  }
-                }
-            }
-        }
-    }
-
-  /* The string had less than 4 characters.  */
-  {
-    size_t l = strlen (str);
-    size_t lmin, lmax;
-    message_ty *best_mp;
-    double best_weight;
-
-    if (!(l <= SHORT_STRING_MAX_BYTES))
-      abort ();
-
-    /* Walk through those short messages which have an appropriate length.
-       See the comment before SHORT_MSG_MAX.  */
-    lmin = (int) ceil (l / (2 / FUZZY_THRESHOLD - 1));
-    lmax = (int) (l * (2 / FUZZY_THRESHOLD - 1));
-    if (!(lmax <= SHORT_MSG_MAX))
-      abort ();
-
-    best_weight = lower_bound;
-    best_mp = NULL;
-    for (l = lmin; l <= lmax; l++)
-      {
-        message_list_ty *mlp = findex->short_messages[l];
-        size_t j;
-
-        for (j = 0; j < mlp->nitems; j++)
-          {
-            message_ty *mp = mlp->item[j];
-            double weight =
-              fuzzy_search_goal_function (mp, msgctxt, msgid, best_weight);
-
-            if (weight > best_weight)
-              {
-                best_weight = weight;
-                best_mp = mp;
-              }
-          }
-      }
-
-    return best_mp;
-  }
+  if (message_fuzzy_index_search_best (findex, msgctxt, msgid, lower_bound,
+                                       heuristic, 1, &match) > 0)
+    return match.mp;
+  else
+    return NULL;
 }
 
 /* Free a fuzzy index.  */
@@ -641,21 +1712,20 @@ void
 message_fuzzy_index_free (message_fuzzy_index_ty *findex)
 {
   size_t l;
-  void *iter;
-  const void *key;
-  size_t keylen;
-  void *data;
 
   /* Free the short lists.  */
   for (l = 0; l <= SHORT_MSG_MAX; l++)
     message_list_free (findex->short_messages[l], 1);
 
-  /* Free the index lists occurring as values in the hash tables.  */
-  iter = NULL;
-  while (hash_iterate (&findex->gram4, &iter, &key, &keylen, &data) == 0)
-    free ((index_list_ty *) data);
-  /* Free the hash table itself.  */
-  hash_destroy (&findex->gram4);
+  /* Free the hash table and the lists.  */
+  if (findex->file_data != NULL)
+    fuzzy_index_file_release (findex->file_data, findex->file_size,
+                              findex->file_mmapped);
+  else
+    {
+      free ((struct gram_slot *) findex->table);
+      free ((unsigned char *) findex->postings);
+    }
 
   free (findex);
 }
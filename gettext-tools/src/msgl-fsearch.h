@@ -40,6 +40,16 @@ extern message_fuzzy_index_ty *
        message_fuzzy_index_alloc (const message_list_ty *mlp,
                                   const char *canon_charset);
 
+/* Allocate a fuzzy index corresponding to a given list of messages, like
+   message_fuzzy_index_alloc.  If the file FILENAME contains a fuzzy index
+   for the same messages and the same CANON_CHARSET, it is used instead of
+   building the index.  Otherwise the index is built and stored in FILENAME,
+   for use by later invocations.  */
+extern message_fuzzy_index_ty *
+       message_fuzzy_index_alloc_cached (const message_list_ty *mlp,
+                                         const char *canon_charset,
+                                         const char *filename);
+
 /* Find a good match for the given msgctxt and msgid in the given fuzzy index.
    The match does not need to be optimal.
    Ignore matches for which the fuzzy_search_goal_function is < LOWER_BOUND.
@@ -57,6 +67,26 @@ extern message_ty *
                                    double lower_bound,
                                    bool heuristic);
 
+/* A message found by message_fuzzy_index_search_best, together with the
+   value of fuzzy_search_goal_function for it.  */
+struct fuzzy_match
+{
+  message_ty *mp;
+  double weight;
+};
+
+/* Find the at most K best matches for the given msgctxt and msgid in the
+   given fuzzy index, like message_fuzzy_index_search does for the single best
+   match.  Store them in RESULTS[0..K-1], by decreasing weight; among matches
+   of equal weight, the one that was considered first comes first.  Return
+   the number of matches stored.  */
+extern size_t
+       message_fuzzy_index_search_best (message_fuzzy_index_ty *findex,
+                                        const char *msgctxt, const char *msgid,
+                                        double lower_bound,
+                                        bool heuristic,
+                                        size_t k, struct fuzzy_match *results);
+
 /* Free a fuzzy index.  */
 extern void
        message_fuzzy_index_free (message_fuzzy_index_ty *findex);
@@ -56,6 +56,7 @@
 #include "msgl-equal.h"
 #include "msgl-fsearch.h"
 #include "glthread/lock.h"
+#include "parallel.h"
 #include "lang-table.h"
 #include "plural-exp.h"
 #include "plural-count.h"
@@ -93,12 +94,45 @@ static bool keep_previous = false;
 /* Language (ISO-639 code) and optional territory (ISO-3166 code).  */
 static const char *catalogname = NULL;
 
-/* List of user-specified compendiums.  */
+/* List of user-specified compendiums, in the encoding used for the current
+   def.po file.  */
 static message_list_list_ty *compendiums;
 
 /* List of corresponding filenames.  */
 static string_list_ty *compendium_filenames;
 
+/* File in which the fuzzy index of the compendiums is kept, or NULL.  */
+static const char *compendium_index_filename;
+
+/* The compendiums as read and their conversions to other encodings.  When
+   several def.po files are merged, each conversion starts from the
+   compendiums as read, and its result is kept for the following def.po
+   files that need the same encoding.  */
+struct compendium_set
+{
+  /* The canonicalized encoding of the messages, or NULL for the compendiums
+     as read.  */
+  const char *canon_charset;
+  message_list_list_ty *lists;
+  /* The fuzzy index of the lists, or NULL, and the canonicalized encoding
+     for which it was built.  */
+  message_fuzzy_index_ty *findex;
+  const char *findex_charset;
+  struct compendium_set *next;
+};
+static struct compendium_set *compendium_sets;
+
+/* The element of compendium_sets whose lists are the compendiums.  */
+static struct compendium_set *current_compendium_set;
+
+/* Whether the compendiums as read are needed for more than one def.po file,
+   and must therefore not be converted in place.  */
+static bool keep_compendiums_as_read;
+
+/* The references file that the definitions files were last merged with,
+   or NULL.  */
+static msgdomain_list_ty *old_ref;
+
 /* Update mode.  */
 static bool update_mode = false;
 static const char *version_control_string;
@@ -111,17 +145,20 @@ static const struct option long_options[] =
   { "backup", required_argument, NULL, CHAR_MAX + 1 },
   { "color", optional_argument, NULL, CHAR_MAX + 9 },
   { "compendium", required_argument, NULL, 'C', },
+  { "compendium-index", required_argument, NULL, CHAR_MAX + 11 },
   { "directory", required_argument, NULL, 'D' },
   { "escape", no_argument, NULL, 'E' },
   { "force-po", no_argument, &force_po, 1 },
   { "help", no_argument, NULL, 'h' },
   { "indent", no_argument, NULL, 'i' },
+  { "jobs", required_argument, NULL, 'j' },
   { "lang", required_argument, NULL, CHAR_MAX + 8 },
   { "multi-domain", no_argument, NULL, 'm' },
   { "no-escape", no_argument, NULL, 'e' },
   { "no-fuzzy-matching", no_argument, NULL, 'N' },
   { "no-location", no_argument, &line_comment, 0 },
   { "no-wrap", no_argument, NULL, CHAR_MAX + 4 },
+  { "old-ref", required_argument, NULL, CHAR_MAX + 12 },
   { "output-file", required_argument, NULL, 'o' },
   { "previous", no_argument, NULL, CHAR_MAX + 7 },
   { "properties-input", no_argument, NULL, 'P' },
@@ -160,7 +197,10 @@ static void usage (int status)
 ;
 static void compendium (const char *filename);
 static void msgdomain_list_stablesort_by_obsolete (msgdomain_list_ty *mdlp);
+static msgdomain_list_ty *read_references (const char *fn2,
+                                           catalog_input_format_ty input_syntax);
 static msgdomain_list_ty *merge (const char *fn1, const char *fn2,
+                                 msgdomain_list_ty *ref,
                                  catalog_input_format_ty input_syntax,
                                  msgdomain_list_ty **defp);
 
@@ -172,8 +212,10 @@ main (int argc, char **argv)
   bool do_help;
   bool do_version;
   char *output_file;
-  msgdomain_list_ty *def;
-  msgdomain_list_ty *result;
+  const char *ref_filename;
+  const char *old_ref_filename = NULL;
+  msgdomain_list_ty *ref;
+  int i;
   catalog_input_format_ty input_syntax = &input_format_po;
   catalog_output_format_ty output_syntax = &output_format_po;
   bool sort_by_filepos = false;
@@ -204,7 +246,7 @@ main (int argc, char **argv)
   do_version = false;
   output_file = NULL;
 
-  while ((opt = getopt_long (argc, argv, "C:D:eEFhimNo:pPqsUvVw:",
+  while ((opt = getopt_long (argc, argv, "C:D:eEFhij:mNo:pPqsUvVw:",
                              long_options, NULL))
          != EOF)
     switch (opt)
@@ -240,6 +282,18 @@ main (int argc, char **argv)
         message_print_style_indent ();
         break;
 
+      case 'j':
+        {
+          char *endp;
+          unsigned long int value = strtoul (optarg, &endp, 10);
+
+          if (endp == optarg || *endp != '\0'
+              || value == 0 || value > UINT_MAX)
+            error (EXIT_FAILURE, 0, _("invalid number of jobs: %s"), optarg);
+          parallel_set_jobs (value);
+        }
+        break;
+
       case 'm':
         multi_domain_mode = true;
         break;
@@ -331,6 +385,14 @@ main (int argc, char **argv)
         handle_style_option (optarg);
         break;
 
+      case CHAR_MAX + 11: /* --compendium-index */
+        compendium_index_filename = optarg;
+        break;
+
+      case CHAR_MAX + 12: /* --old-ref */
+        old_ref_filename = optarg;
+        break;
+
       default:
         usage (EXIT_FAILURE);
         break;
@@ -361,10 +423,21 @@ There is NO WARRANTY, to the extent permitted by law.\n\
       error (EXIT_SUCCESS, 0, _("no input files given"));
       usage (EXIT_FAILURE);
     }
-  if (optind + 2 != argc)
+  if (update_mode)
     {
-      error (EXIT_SUCCESS, 0, _("exactly 2 input files required"));
-      usage (EXIT_FAILURE);
+      if (optind + 2 > argc)
+        {
+          error (EXIT_SUCCESS, 0, _("at least 2 input files required"));
+          usage (EXIT_FAILURE);
+        }
+    }
+  else
+    {
+      if (optind + 2 != argc)
+        {
+          error (EXIT_SUCCESS, 0, _("exactly 2 input files required"));
+          usage (EXIT_FAILURE);
+        }
     }
 
   /* Verify selected options.  */
@@ -407,62 +480,81 @@ There is NO WARRANTY, to the extent permitted by law.\n\
   if (update_mode && input_syntax == &input_format_stringtable)
     output_syntax = &output_format_stringtable;
 
-  /* Merge the two files.  */
-  result = merge (argv[optind], argv[optind + 1], input_syntax, &def);
+  /* Read the references file.  In update mode, it is shared among all the
+     definitions files.  */
+  ref_filename = argv[argc - 1];
+  ref = read_references (ref_filename, input_syntax);
 
-  /* Sort the results.  */
-  if (sort_by_filepos)
-    msgdomain_list_sort_by_filepos (result);
-  else if (sort_by_msgid)
-    msgdomain_list_sort_by_msgid (result);
+  if (old_ref_filename != NULL)
+    old_ref = read_references (old_ref_filename, input_syntax);
 
-  if (update_mode)
+  keep_compendiums_as_read = (argc - 1 - optind > 1);
+
+  for (i = optind; i < argc - 1; i++)
     {
-      /* Before comparing result with def, sort the result into the same order
-         as would be done implicitly by output_syntax->print.  */
-      if (output_syntax->sorts_obsoletes_to_end)
-        msgdomain_list_stablesort_by_obsolete (result);
-
-      /* Do nothing if the original file and the result are equal.  Also do
-         nothing if the original file and the result differ only by the
-         POT-Creation-Date in the header entry; this is needed for projects
-         which don't put the .pot file under CVS.  */
-      if (!msgdomain_list_equal (def, result, true))
-        {
-          /* Back up def.po.  */
-          enum backup_type backup_type;
-          char *backup_file;
+      const char *def_filename = argv[i];
+      msgdomain_list_ty *def;
+      msgdomain_list_ty *result;
 
-          output_file = argv[optind];
+      /* Merge the two files.  */
+      result = merge (def_filename, ref_filename, ref, input_syntax, &def);
 
-          if (backup_suffix_string == NULL)
-            {
-              backup_suffix_string = getenv ("SIMPLE_BACKUP_SUFFIX");
-              if (backup_suffix_string != NULL
-                  && backup_suffix_string[0] == '\0')
-                backup_suffix_string = NULL;
-            }
-          if (backup_suffix_string != NULL)
-            simple_backup_suffix = backup_suffix_string;
+      /* Sort the results.  */
+      if (sort_by_filepos)
+        msgdomain_list_sort_by_filepos (result);
+      else if (sort_by_msgid)
+        msgdomain_list_sort_by_msgid (result);
 
-          backup_type = xget_version (_("backup type"), version_control_string);
-          if (backup_type != none)
+      if (update_mode)
+        {
+          /* Before comparing result with def, sort the result into the same
+             order as would be done implicitly by output_syntax->print.  */
+          if (output_syntax->sorts_obsoletes_to_end)
+            msgdomain_list_stablesort_by_obsolete (result);
+
+          /* Do nothing if the original file and the result are equal.  Also
+             do nothing if the original file and the result differ only by
+             the POT-Creation-Date in the header entry; this is needed for
+             projects which don't put the .pot file under CVS.  */
+          if (!msgdomain_list_equal (def, result, true))
             {
-              backup_file = find_backup_file_name (output_file, backup_type);
-              copy_file_preserving (output_file, backup_file);
-            }
+              /* Back up def.po.  */
+              enum backup_type backup_type;
+              char *backup_file;
+
+              output_file = argv[i];
+
+              if (backup_suffix_string == NULL)
+                {
+                  backup_suffix_string = getenv ("SIMPLE_BACKUP_SUFFIX");
+                  if (backup_suffix_string != NULL
+                      && backup_suffix_string[0] == '\0')
+                    backup_suffix_string = NULL;
+                }
+              if (backup_suffix_string != NULL)
+                simple_backup_suffix = backup_suffix_string;
+
+              backup_type =
+                xget_version (_("backup type"), version_control_string);
+              if (backup_type != none)
+                {
+                  backup_file =
+                    find_backup_file_name (output_file, backup_type);
+                  copy_file_preserving (output_file, backup_file);
+                }
 
+              /* Write the merged message list out.  */
+              msgdomain_list_print (result, output_file, output_syntax, true,
+                                    false);
+            }
+        }
+      else
+        {
           /* Write the merged message list out.  */
-          msgdomain_list_print (result, output_file, output_syntax, true,
+          msgdomain_list_print (result, output_file, output_syntax, force_po,
                                 false);
         }
     }
-  else
-    {
-      /* Write the merged message list out.  */
-      msgdomain_list_print (result, output_file, output_syntax, force_po,
-                            false);
-    }
 
   exit (EXIT_SUCCESS);
 }
@@ -479,7 +571,8 @@ usage (int status)
     {
       printf (_("\
 Usage: %s [OPTION] def.po ref.pot\n\
-"), program_name);
+or:    %s [OPTION] --update def.po... ref.pot\n\
+"), program_name, program_name);
       printf ("\n");
       /* xgettext: no-wrap */
       printf (_("\
@@ -508,12 +601,20 @@ Input file location:\n"));
       printf (_("\
   -C, --compendium=FILE       additional library of message translations,\n\
                               may be specified more than once\n"));
+      printf (_("\
+      --compendium-index=FILE keep the fuzzy index of the compendiums in FILE,\n\
+                              for reuse by later invocations\n"));
+      printf (_("\
+      --old-ref=FILE          the references file that def.po was last merged\n\
+                              with; messages that did not change since then\n\
+                              are taken over from def.po as they are\n"));
       printf ("\n");
       printf (_("\
 Operation mode:\n"));
       printf (_("\
   -U, --update                update def.po,\n\
-                              do nothing if def.po already up to date\n"));
+                              do nothing if def.po already up to date;\n\
+                              several def.po files may be given\n"));
       printf ("\n");
       printf (_("\
 Output file location:\n"));
@@ -551,6 +652,8 @@ Operation modifiers:\n"));
   -N, --no-fuzzy-matching     do not use fuzzy matching\n"));
       printf (_("\
       --previous              keep previous msgids of translated messages\n"));
+      printf (_("\
+  -j, --jobs=NUMBER           use NUMBER threads for the fuzzy matching\n"));
       printf ("\n");
       printf (_("\
 Input file syntax:\n"));
@@ -632,6 +735,14 @@ compendium (const char *filename)
     {
       compendiums = message_list_list_alloc ();
       compendium_filenames = string_list_alloc ();
+
+      compendium_sets = XMALLOC (struct compendium_set);
+      compendium_sets->canon_charset = NULL;
+      compendium_sets->lists = compendiums;
+      compendium_sets->findex = NULL;
+      compendium_sets->findex_charset = NULL;
+      compendium_sets->next = NULL;
+      current_compendium_set = compendium_sets;
     }
   for (k = 0; k < mdlp->nitems; k++)
     {
@@ -641,6 +752,68 @@ compendium (const char *filename)
 }
 
 
+/* Returns the element of compendium_sets for the (already canonicalized)
+   encoding CANON_CHARSET, or for the compendiums as read if CANON_CHARSET
+   is NULL, or NULL if there is none yet.  */
+static struct compendium_set *
+compendium_set_lookup (const char *canon_charset)
+{
+  struct compendium_set *set;
+
+  for (set = compendium_sets; set != NULL; set = set->next)
+    if (set->canon_charset == canon_charset)
+      return set;
+  return NULL;
+}
+
+
+/* Makes the compendiums as read the current ones.  */
+static void
+compendiums_use_as_read ()
+{
+  current_compendium_set = compendium_set_lookup (NULL);
+  compendiums = current_compendium_set->lists;
+}
+
+
+/* Makes the compendiums converted to the (already canonicalized) encoding
+   CANON_TO_CODE the current ones.  */
+static void
+compendiums_convert (const char *canon_to_code)
+{
+  struct compendium_set *set = compendium_set_lookup (canon_to_code);
+
+  if (set == NULL)
+    {
+      message_list_list_ty *as_read = compendium_set_lookup (NULL)->lists;
+      size_t k;
+
+      set = XMALLOC (struct compendium_set);
+      set->canon_charset = canon_to_code;
+      set->lists = message_list_list_alloc ();
+      for (k = 0; k < as_read->nitems; k++)
+        {
+          message_list_ty *mlp = as_read->item[k];
+
+          /* Convert a copy, so that the conversions are not chained.  With
+             a single def.po file, there is only one conversion.  */
+          if (keep_compendiums_as_read)
+            mlp = message_list_copy (mlp, 0);
+          iconv_message_list (mlp, NULL, canon_to_code,
+                              compendium_filenames->item[k]);
+          message_list_list_append (set->lists, mlp);
+        }
+      set->findex = NULL;
+      set->findex_charset = NULL;
+      set->next = compendium_sets;
+      compendium_sets = set;
+    }
+
+  current_compendium_set = set;
+  compendiums = set->lists;
+}
+
+
 /* Sorts obsolete messages to the end, for every domain.  */
 static void
 msgdomain_list_stablesort_by_obsolete (msgdomain_list_ty *mdlp)
@@ -706,7 +879,8 @@ struct definitions_ty
   gl_lock_define(, curr_findex_init_lock)
 
   /* A fuzzy index of the compendiums, for speed when doing fuzzy searches.
-     Used only if use_fuzzy_matching is true and compendiums != NULL.  */
+     Used only if use_fuzzy_matching is true and compendiums != NULL.
+     It belongs to current_compendium_set, not to this object.  */
   message_fuzzy_index_ty *comp_findex;
   /* A once-only execution guard for the initialization of the fuzzy index.
      Needed for OpenMP.  */
@@ -771,6 +945,15 @@ definitions_init_comp_findex (definitions_ty *definitions)
 {
   /* Protect against concurrent execution.  */
   gl_lock_lock (definitions->comp_findex_init_lock);
+  if (definitions->comp_findex == NULL)
+    {
+      /* Reuse the index built for an earlier def.po file that used the
+         same compendiums.  */
+      if (current_compendium_set->findex != NULL
+          && current_compendium_set->findex_charset
+             == definitions->canon_charset)
+        definitions->comp_findex = current_compendium_set->findex;
+    }
   if (definitions->comp_findex == NULL)
     {
       /* Combine all the compendium message lists into a single one.  Don't
@@ -788,9 +971,22 @@ definitions_init_comp_findex (definitions_ty *definitions)
             message_list_append (all_compendium, mlp->item[j]);
         }
 
-      /* Create the fuzzy index from it.  */
-      definitions->comp_findex =
-        message_fuzzy_index_alloc (all_compendium, definitions->canon_charset);
+      /* Create the fuzzy index from it, or take it from the file where it
+         was stored by an earlier invocation.  */
+      if (compendium_index_filename != NULL)
+        definitions->comp_findex =
+          message_fuzzy_index_alloc_cached (all_compendium,
+                                            definitions->canon_charset,
+                                            compendium_index_filename);
+      else
+        definitions->comp_findex =
+          message_fuzzy_index_alloc (all_compendium,
+                                     definitions->canon_charset);
+
+      if (current_compendium_set->findex != NULL)
+        message_fuzzy_index_free (current_compendium_set->findex);
+      current_compendium_set->findex = definitions->comp_findex;
+      current_compendium_set->findex_charset = definitions->canon_charset;
     }
   gl_lock_unlock (definitions->comp_findex_init_lock);
 }
@@ -869,8 +1065,6 @@ definitions_destroy (definitions_ty *definitions)
   message_list_list_free (definitions->lists, 2);
   if (definitions->curr_findex != NULL)
     message_fuzzy_index_free (definitions->curr_findex);
-  if (definitions->comp_findex != NULL)
-    message_fuzzy_index_free (definitions->comp_findex);
 }
 
 
@@ -1363,10 +1557,169 @@ message_merge (message_ty *def, message_ty *ref, bool force_fuzzy,
 
 #define DOT_FREQUENCY 10
 
+/* Protects the progress indicator against concurrent updates.  */
+gl_lock_define_initialized(static, progress_lock)
+
+/* The outcome of the search for a reference message among the
+   definitions.  */
+struct search_result
+{
+  message_ty *found;
+  bool fuzzy;
+  /* True if the reference message has not changed since the definitions
+     were merged with it, so that the definition is taken over as is.  */
+  bool unchanged;
+};
+
+/* The state shared by the parallel loops of match_domain.  */
+struct match_domain_loop
+{
+  definitions_ty *definitions;
+  message_list_ty *refmlp;
+  message_list_ty *old_refmlp;
+  unsigned int *processed;
+  struct search_result *search_results;
+  message_ty **merged_messages;
+  unsigned long int nplurals;
+  char *untranslated_plural_msgstr;
+  const struct plural_distribution *distribution;
+};
+
+/* Search the definition of the reference message number J.  */
+static void
+match_domain_search (void *data, size_t j)
+{
+  struct match_domain_loop *loop = (struct match_domain_loop *) data;
+  definitions_ty *definitions = loop->definitions;
+  message_ty *refmsg = loop->refmlp->item[j];
+  struct search_result *result = &loop->search_results[j];
+  message_ty *defmsg;
+
+  /* Because merging can take a while we print something to signal
+     we are not dead.  */
+  gl_lock_lock (progress_lock);
+  if (!quiet && verbosity_level <= 1 && *loop->processed % DOT_FREQUENCY == 0)
+    fputc ('.', stderr);
+  (*loop->processed)++;
+  gl_lock_unlock (progress_lock);
+
+  result->unchanged = false;
+
+  /* If the message is the same as in the old references, the definitions
+     file contains the result of merging it already.  */
+  if (loop->old_refmlp != NULL && !is_header (refmsg))
+    {
+      message_ty *oldmsg =
+        message_list_search (loop->old_refmlp, refmsg->msgctxt, refmsg->msgid);
+
+      if (oldmsg != NULL && message_template_equal (oldmsg, refmsg, false))
+        {
+          defmsg =
+            message_list_search (definitions_current_list (definitions),
+                                 refmsg->msgctxt, refmsg->msgid);
+          /* definitions_search would prefer a translation from the
+             compendiums over an untranslated definition.  */
+          if (defmsg != NULL && !defmsg->obsolete
+              && (compendiums == NULL
+                  || !(defmsg->msgstr_len == 1 && defmsg->msgstr[0] == '\0')))
+            {
+              result->found = defmsg;
+              result->fuzzy = false;
+              result->unchanged = true;
+              return;
+            }
+        }
+    }
+
+  /* See if it is in the other file.  */
+  defmsg = definitions_search (definitions, refmsg->msgctxt, refmsg->msgid);
+  if (defmsg != NULL)
+    {
+      result->found = defmsg;
+      result->fuzzy = false;
+    }
+  else if (!is_header (refmsg)
+           /* If the message was not defined at all, try to find a very
+              similar message, it could be a typo, or the suggestion may
+              help.  */
+           && use_fuzzy_matching
+           && ((defmsg =
+                  definitions_search_fuzzy (definitions,
+                                            refmsg->msgctxt,
+                                            refmsg->msgid)) != NULL))
+    {
+      result->found = defmsg;
+      result->fuzzy = true;
+    }
+  else
+    result->found = NULL;
+}
+
+/* Build the resulting message for the reference message number J.  */
+static void
+match_domain_merge (void *data, size_t j)
+{
+  struct match_domain_loop *loop = (struct match_domain_loop *) data;
+  message_ty *refmsg = loop->refmlp->item[j];
+  const struct search_result *result = &loop->search_results[j];
+  message_ty *mp;
+
+  if (result->unchanged)
+    {
+      /* Take over the definition.  */
+      mp = message_copy (result->found);
+      if (!keep_previous)
+        {
+          mp->prev_msgctxt = NULL;
+          mp->prev_msgid = NULL;
+          mp->prev_msgid_plural = NULL;
+        }
+    }
+  else if (result->found != NULL)
+    /* Merge the reference with the definition: take the #. and
+       #: comments from the reference, take the # comments from
+       the definition, take the msgstr from the definition.  */
+    mp = message_merge (result->found, refmsg, result->fuzzy,
+                        loop->distribution);
+  else if (!is_header (refmsg))
+    {
+      /* The message was not defined at all.  */
+      mp = message_copy (refmsg);
+
+      if (mp->msgid_plural != NULL)
+        {
+          bool is_untranslated;
+          const char *p;
+          const char *pend;
+
+          /* Test if mp is untranslated.  (It most likely is.)  */
+          is_untranslated = true;
+          for (p = mp->msgstr, pend = p + mp->msgstr_len; p < pend; p++)
+            if (*p != '\0')
+              {
+                is_untranslated = false;
+                break;
+              }
+          if (is_untranslated)
+            {
+              /* Change mp->msgstr_len consecutive empty strings into
+                 nplurals consecutive empty strings.  */
+              if (loop->nplurals > mp->msgstr_len)
+                mp->msgstr = loop->untranslated_plural_msgstr;
+              mp->msgstr_len = loop->nplurals;
+            }
+        }
+    }
+  else
+    mp = NULL;
+
+  loop->merged_messages[j] = mp;
+}
+
 static void
 match_domain (const char *fn1, const char *fn2,
               definitions_ty *definitions, message_list_ty *refmlp,
-              message_list_ty *resultmlp,
+              message_list_ty *old_refmlp, message_list_ty *resultmlp,
               struct statistics *stats, unsigned int *processed)
 {
   message_ty *header_entry;
@@ -1374,7 +1727,9 @@ match_domain (const char *fn1, const char *fn2,
   const struct expression *plural_expr;
   char *untranslated_plural_msgstr;
   struct plural_distribution distribution;
-  struct search_result { message_ty *found; bool fuzzy; } *search_results;
+  struct search_result *search_results;
+  message_ty **merged_messages;
+  struct match_domain_loop loop;
   size_t j;
 
   header_entry =
@@ -1404,97 +1759,66 @@ match_domain (const char *fn1, const char *fn2,
     po_xerror = old_po_xerror;
   }
 
-  /* Most of the time is spent in definitions_search_fuzzy.
-     Perform it in a separate loop that can be parallelized by an OpenMP
-     capable compiler.  */
   search_results = XNMALLOC (refmlp->nitems, struct search_result);
-  {
-    long int nn = refmlp->nitems;
-    long int jj;
-
-    /* Tell the OpenMP capable compiler to distribute this loop across
-       several threads.  The schedule is dynamic, because for some messages
-       the loop body can be executed very quickly, whereas for others it takes
-       a long time.
-       Note: The Sun Workshop 6.2 C compiler does not allow a space between
-       '#' and 'pragma'.  */
-    #ifdef _OPENMP
-     #pragma omp parallel for schedule(dynamic)
-    #endif
-    for (jj = 0; jj < nn; jj++)
-      {
-        message_ty *refmsg = refmlp->item[jj];
-        message_ty *defmsg;
-
-        /* Because merging can take a while we print something to signal
-           we are not dead.  */
-        if (!quiet && verbosity_level <= 1 && *processed % DOT_FREQUENCY == 0)
-          fputc ('.', stderr);
-        #ifdef _OPENMP
-         #pragma omp atomic
-        #endif
-        (*processed)++;
-
-        /* See if it is in the other file.  */
-        defmsg =
-          definitions_search (definitions, refmsg->msgctxt, refmsg->msgid);
-        if (defmsg != NULL)
-          {
-            search_results[jj].found = defmsg;
-            search_results[jj].fuzzy = false;
-          }
-        else if (!is_header (refmsg)
-                 /* If the message was not defined at all, try to find a very
-                    similar message, it could be a typo, or the suggestion may
-                    help.  */
-                 && use_fuzzy_matching
-                 && ((defmsg =
-                        definitions_search_fuzzy (definitions,
-                                                  refmsg->msgctxt,
-                                                  refmsg->msgid)) != NULL))
-          {
-            search_results[jj].found = defmsg;
-            search_results[jj].fuzzy = true;
-          }
-        else
-          search_results[jj].found = NULL;
-      }
-  }
+  merged_messages = XNMALLOC (refmlp->nitems, message_ty *);
+  loop.definitions = definitions;
+  loop.refmlp = refmlp;
+  loop.old_refmlp = old_refmlp;
+  loop.processed = processed;
+  loop.search_results = search_results;
+  loop.merged_messages = merged_messages;
+  loop.nplurals = nplurals;
+  loop.untranslated_plural_msgstr = untranslated_plural_msgstr;
+  loop.distribution = &distribution;
+
+  /* If some message has no exact match, build the fuzzy indices now.
+     Built lazily inside the following loop, they would be built by a single
+     thread, because parallel_for does not nest.  */
+  if (use_fuzzy_matching)
+    {
+      for (j = 0; j < refmlp->nitems; j++)
+        {
+          message_ty *refmsg = refmlp->item[j];
+
+          if (!is_header (refmsg)
+              && definitions_search (definitions,
+                                     refmsg->msgctxt, refmsg->msgid) == NULL)
+            {
+              definitions_init_curr_findex (definitions);
+              if (compendiums != NULL)
+                definitions_init_comp_findex (definitions);
+              break;
+            }
+        }
+    }
+
+  /* Most of the time is spent in definitions_search_fuzzy.  Perform it in
+     a separate loop, distributed across several threads.  For some messages
+     the loop body can be executed very quickly, whereas for others it takes
+     a long time; parallel_for balances the load.  */
+  parallel_for (refmlp->nitems, match_domain_search, &loop);
+
+  /* Build the resulting messages.  message_merge does a fair amount of
+     string processing; therefore this loop is parallelized as well.  The
+     resulting messages are added to resultmlp afterwards, in order.  */
+  parallel_for (refmlp->nitems, match_domain_merge, &loop);
 
   for (j = 0; j < refmlp->nitems; j++)
     {
       message_ty *refmsg = refmlp->item[j];
+      message_ty *defmsg = search_results[j].found;
+      message_ty *mp = merged_messages[j];
 
-      /* See if it is in the other file.
-         This used definitions_search.  */
-      if (search_results[j].found != NULL && !search_results[j].fuzzy)
-        {
-          message_ty *defmsg = search_results[j].found;
-          /* Merge the reference with the definition: take the #. and
-             #: comments from the reference, take the # comments from
-             the definition, take the msgstr from the definition.  Add
-             this merged entry to the output message list.  */
-          message_ty *mp =
-            message_merge (defmsg, refmsg, false, &distribution);
-
-          message_list_append (resultmlp, mp);
+      if (mp == NULL)
+        continue;
 
-          /* Remember that this message has been used, when we scan
-             later to see if anything was omitted.  */
-          defmsg->used = 1;
-          stats->merged++;
-        }
-      else if (!is_header (refmsg))
+      if (defmsg != NULL)
         {
-          /* If the message was not defined at all, try to find a very
-             similar message, it could be a typo, or the suggestion may
-             help.  This search assumed use_fuzzy_matching and used
-             definitions_search_fuzzy.  */
-          if (search_results[j].found != NULL && search_results[j].fuzzy)
+          if (search_results[j].fuzzy)
             {
-              message_ty *defmsg = search_results[j].found;
-              message_ty *mp;
-
+              /* The message was not defined, but a very similar message
+                 was found; it could be a typo, or the suggestion may
+                 help.  */
               if (verbosity_level > 1)
                 {
                   po_gram_error_at_line (&refmsg->pos, _("\
@@ -1503,62 +1827,36 @@ this message is used but not defined..."));
                   po_gram_error_at_line (&defmsg->pos, _("\
 ...but this definition is similar"));
                 }
+            }
 
-              /* Merge the reference with the definition: take the #. and
-                 #: comments from the reference, take the # comments from
-                 the definition, take the msgstr from the definition.  Add
-                 this merged entry to the output message list.  */
-              mp = message_merge (defmsg, refmsg, true, &distribution);
+          message_list_append (resultmlp, mp);
 
-              message_list_append (resultmlp, mp);
+          /* Remember that this message has been used, when we scan
+             later to see if anything was omitted.  */
+          defmsg->used = 1;
 
-              /* Remember that this message has been used, when we scan
-                 later to see if anything was omitted.  */
-              defmsg->used = 1;
+          if (search_results[j].fuzzy)
+            {
               stats->fuzzied++;
               if (!quiet && verbosity_level <= 1)
                 /* Always print a dot if we handled a fuzzy match.  */
                 fputc ('.', stderr);
             }
           else
-            {
-              message_ty *mp;
-              bool is_untranslated;
-              const char *p;
-              const char *pend;
-
-              if (verbosity_level > 1)
-                po_gram_error_at_line (&refmsg->pos, _("\
+            stats->merged++;
+        }
+      else
+        {
+          if (verbosity_level > 1)
+            po_gram_error_at_line (&refmsg->pos, _("\
 this message is used but not defined in %s"), fn1);
 
-              mp = message_copy (refmsg);
-
-              if (mp->msgid_plural != NULL)
-                {
-                  /* Test if mp is untranslated.  (It most likely is.)  */
-                  is_untranslated = true;
-                  for (p = mp->msgstr, pend = p + mp->msgstr_len; p < pend; p++)
-                    if (*p != '\0')
-                      {
-                        is_untranslated = false;
-                        break;
-                      }
-                  if (is_untranslated)
-                    {
-                      /* Change mp->msgstr_len consecutive empty strings into
-                         nplurals consecutive empty strings.  */
-                      if (nplurals > mp->msgstr_len)
-                        mp->msgstr = untranslated_plural_msgstr;
-                      mp->msgstr_len = nplurals;
-                    }
-                }
-
-              message_list_append (resultmlp, mp);
-              stats->missing++;
-            }
+          message_list_append (resultmlp, mp);
+          stats->missing++;
         }
     }
 
+  free (merged_messages);
   free (search_results);
 
   /* Now postprocess the problematic merges.  This is needed because we
@@ -1654,12 +1952,82 @@ this message should not define plural forms"));
     }
 }
 
+/* Reads the references file, created by groping the sources with the
+   xgettext program.  */
 static msgdomain_list_ty *
-merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
-       msgdomain_list_ty **defp)
+read_references (const char *fn2, catalog_input_format_ty input_syntax)
 {
-  msgdomain_list_ty *def;
   msgdomain_list_ty *ref;
+  size_t k;
+
+  ref = read_catalog_file (fn2, input_syntax);
+  /* Add a dummy header entry, if the references file contains none.  */
+  for (k = 0; k < ref->nitems; k++)
+    if (message_list_search (ref->item[k]->messages, NULL, "") == NULL)
+      {
+        static lex_pos_ty pos = { __FILE__, __LINE__ };
+        message_ty *refheader = message_alloc (NULL, "", NULL, "", 1, &pos);
+
+        message_list_prepend (ref->item[k]->messages, refheader);
+      }
+
+  return ref;
+}
+
+/* The state shared by the parallel copying of obsolete messages.  */
+struct copy_obsolete_loop
+{
+  message_list_ty *defmlp;
+  message_ty **obsolete_messages;
+};
+
+/* If the definition number J was not used, copy it as an obsolete
+   message.  */
+static void
+copy_obsolete (void *data, size_t j)
+{
+  struct copy_obsolete_loop *loop = (struct copy_obsolete_loop *) data;
+  message_ty *defmsg = loop->defmlp->item[j];
+  message_ty *mp;
+
+  if (!defmsg->used)
+    {
+      /* Remember the old translation although it is not used anymore.
+         But we mark it as obsolete.  */
+      mp = message_copy (defmsg);
+      /* Clear the extracted comments.  */
+      if (mp->comment_dot != NULL)
+        {
+          string_list_free (mp->comment_dot);
+          mp->comment_dot = NULL;
+        }
+      /* Clear the file position comments.  */
+      if (mp->filepos != NULL)
+        {
+          size_t i;
+
+          for (i = 0; i < mp->filepos_count; i++)
+            free ((char *) mp->filepos[i].file_name);
+          mp->filepos_count = 0;
+          free (mp->filepos);
+          mp->filepos = NULL;
+        }
+      /* Mark as obsolete.   */
+      mp->obsolete = true;
+    }
+  else
+    mp = NULL;
+
+  loop->obsolete_messages[j] = mp;
+}
+
+/* Merges the definitions file FN1 with the references REF, read from FN2.
+   REF is not modified.  */
+static msgdomain_list_ty *
+merge (const char *fn1, const char *fn2, msgdomain_list_ty *ref,
+       catalog_input_format_ty input_syntax, msgdomain_list_ty **defp)
+{
+  msgdomain_list_ty *def;
   size_t j, k;
   unsigned int processed;
   struct statistics stats;
@@ -1673,22 +2041,11 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
   /* This is the definitions file, created by a human.  */
   def = read_catalog_file (fn1, input_syntax);
 
-  /* This is the references file, created by groping the sources with
-     the xgettext program.  */
-  ref = read_catalog_file (fn2, input_syntax);
-  /* Add a dummy header entry, if the references file contains none.  */
-  for (k = 0; k < ref->nitems; k++)
-    if (message_list_search (ref->item[k]->messages, NULL, "") == NULL)
-      {
-        static lex_pos_ty pos = { __FILE__, __LINE__ };
-        message_ty *refheader = message_alloc (NULL, "", NULL, "", 1, &pos);
-
-        message_list_prepend (ref->item[k]->messages, refheader);
-      }
-
   /* The references file can be either in ASCII or in UTF-8.  If it is
      in UTF-8, we have to convert the definitions and the compendiums to
      UTF-8 as well.  */
+  if (compendiums != NULL)
+    compendiums_use_as_read ();
   {
     bool was_utf8 = false;
     for (k = 0; k < ref->nitems; k++)
@@ -1721,9 +2078,7 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
       {
         def = iconv_msgdomain_list (def, "UTF-8", true, fn1);
         if (compendiums != NULL)
-          for (k = 0; k < compendiums->nitems; k++)
-            iconv_message_list (compendiums->item[k], NULL, po_charset_utf8,
-                                compendium_filenames->item[k]);
+          compendiums_convert (po_charset_utf8);
       }
     else if (compendiums != NULL && compendiums->nitems > 0)
       {
@@ -1787,10 +2142,7 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
                     {
                       /* Convert the compendiums to def's encoding.  */
                       if (compendiums != NULL)
-                        for (k = 0; k < compendiums->nitems; k++)
-                          iconv_message_list (compendiums->item[k],
-                                              NULL, canon_charset,
-                                              compendium_filenames->item[k]);
+                        compendiums_convert (canon_charset);
                       conversion_done = true;
                     }
                 }
@@ -1865,10 +2217,7 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
                    encoding.  So, convert everything to UTF-8.  */
                 def = iconv_msgdomain_list (def, "UTF-8", true, fn1);
                 if (compendiums != NULL)
-                  for (k = 0; k < compendiums->nitems; k++)
-                    iconv_message_list (compendiums->item[k],
-                                        NULL, po_charset_utf8,
-                                        compendium_filenames->item[k]);
+                  compendiums_convert (po_charset_utf8);
               }
           }
       }
@@ -1936,6 +2285,10 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
       {
         const char *domain = ref->item[k]->domain;
         message_list_ty *refmlp = ref->item[k]->messages;
+        message_list_ty *old_refmlp =
+          (old_ref != NULL
+           ? msgdomain_list_sublist (old_ref, domain, false)
+           : NULL);
         message_list_ty *resultmlp =
           msgdomain_list_sublist (result, domain, true);
         message_list_ty *defmlp;
@@ -1945,7 +2298,7 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
           defmlp = empty_list;
         definitions_set_current_list (&definitions, defmlp);
 
-        match_domain (fn1, fn2, &definitions, refmlp, resultmlp,
+        match_domain (fn1, fn2, &definitions, refmlp, old_refmlp, resultmlp,
                       &stats, &processed);
       }
   else
@@ -1953,6 +2306,8 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
       /* Apply the references messages in the default domain to each of
          the definition domains.  */
       message_list_ty *refmlp = ref->item[0]->messages;
+      message_list_ty *old_refmlp =
+        (old_ref != NULL ? old_ref->item[0]->messages : NULL);
 
       for (k = 0; k < def->nitems; k++)
         {
@@ -1967,8 +2322,8 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
 
               definitions_set_current_list (&definitions, defmlp);
 
-              match_domain (fn1, fn2, &definitions, refmlp, resultmlp,
-                            &stats, &processed);
+              match_domain (fn1, fn2, &definitions, refmlp, old_refmlp,
+                            resultmlp, &stats, &processed);
             }
         }
     }
@@ -1982,43 +2337,25 @@ merge (const char *fn1, const char *fn2, catalog_input_format_ty input_syntax,
     {
       const char *domain = def->item[k]->domain;
       message_list_ty *defmlp = def->item[k]->messages;
+      message_ty **obsolete_messages;
+      struct copy_obsolete_loop loop;
 
-      for (j = 0; j < defmlp->nitems; j++)
-        {
-          message_ty *defmsg = defmlp->item[j];
-
-          if (!defmsg->used)
-            {
-              /* Remember the old translation although it is not used anymore.
-                 But we mark it as obsolete.  */
-              message_ty *mp;
+      /* Copy the messages in parallel, then add them to the result in
+         order.  */
+      obsolete_messages = XNMALLOC (defmlp->nitems, message_ty *);
+      loop.defmlp = defmlp;
+      loop.obsolete_messages = obsolete_messages;
+      parallel_for (defmlp->nitems, copy_obsolete, &loop);
 
-              mp = message_copy (defmsg);
-              /* Clear the extracted comments.  */
-              if (mp->comment_dot != NULL)
-                {
-                  string_list_free (mp->comment_dot);
-                  mp->comment_dot = NULL;
-                }
-              /* Clear the file position comments.  */
-              if (mp->filepos != NULL)
-                {
-                  size_t i;
-
-                  for (i = 0; i < mp->filepos_count; i++)
-                    free ((char *) mp->filepos[i].file_name);
-                  mp->filepos_count = 0;
-                  free (mp->filepos);
-                  mp->filepos = NULL;
-                }
-              /* Mark as obsolete.   */
-              mp->obsolete = true;
+      for (j = 0; j < defmlp->nitems; j++)
+        if (obsolete_messages[j] != NULL)
+          {
+            message_list_append (msgdomain_list_sublist (result, domain, true),
+                                 obsolete_messages[j]);
+            stats.obsolete++;
+          }
 
-              message_list_append (msgdomain_list_sublist (result, domain, true),
-                                   mp);
-              stats.obsolete++;
-            }
-        }
+      free (obsolete_messages);
     }
 
   /* Determine the known a-priori encoding, if any.  */
@@ -0,0 +1,517 @@
+/* Suggest translations from translation memories.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include "closeout.h"
+#include "dir-list.h"
+#include "error.h"
+#include "error-progname.h"
+#include "progname.h"
+#include "relocatable.h"
+#include "basename.h"
+#include "message.h"
+#include "read-catalog.h"
+#include "read-po.h"
+#include "read-properties.h"
+#include "read-stringtable.h"
+#include "xalloc.h"
+#include "xsize.h"
+#include "po-charset.h"
+#include "msgl-iconv.h"
+#include "msgl-fsearch.h"
+#include "parallel.h"
+#include "fwriteerror.h"
+#include "gettext.h"
+
+#define _(str) gettext (str)
+
+
+/* The translation memory: the translated messages of the compendiums.  */
+static message_list_ty *memory;
+
+/* Maximum number of suggestions per message.  */
+static size_t max_candidates = 5;
+
+/* Long options.  */
+static const struct option long_options[] =
+{
+  { "candidates", required_argument, NULL, 'n' },
+  { "compendium", required_argument, NULL, 'C' },
+  { "directory", required_argument, NULL, 'D' },
+  { "help", no_argument, NULL, 'h' },
+  { "jobs", required_argument, NULL, 'j' },
+  { "output-file", required_argument, NULL, 'o' },
+  { "properties-input", no_argument, NULL, 'P' },
+  { "stringtable-input", no_argument, NULL, CHAR_MAX + 1 },
+  { "version", no_argument, NULL, 'V' },
+  { NULL, 0, NULL, 0 }
+};
+
+
+/* Forward declaration of local functions.  */
+static void usage (int status)
+#if defined __GNUC__ && ((__GNUC__ == 2 && __GNUC_MINOR__ >= 5) || __GNUC__ > 2)
+        __attribute__ ((noreturn))
+#endif
+;
+static void compendium (const char *filename,
+                        catalog_input_format_ty input_syntax);
+static void suggest (const char *filename, const char *output_file,
+                     catalog_input_format_ty input_syntax);
+
+
+int
+main (int argc, char *argv[])
+{
+  int optchar;
+  bool do_help;
+  bool do_version;
+  const char *output_file;
+  catalog_input_format_ty input_syntax = &input_format_po;
+  const char **compendium_filenames;
+  size_t ncompendiums;
+  size_t i;
+
+  /* Set program name for messages.  */
+  set_program_name (argv[0]);
+  error_print_progname = maybe_print_progname;
+  gram_max_allowed_errors = UINT_MAX;
+
+#ifdef HAVE_SETLOCALE
+  /* Set locale via LC_ALL.  */
+  setlocale (LC_ALL, "");
+#endif
+
+  /* Set the text message domain.  */
+  bindtextdomain (PACKAGE, relocate (LOCALEDIR));
+  bindtextdomain ("bison-runtime", relocate (BISON_LOCALEDIR));
+  textdomain (PACKAGE);
+
+  /* Ensure that write errors on stdout are detected.  */
+  atexit (close_stdout);
+
+  do_help = false;
+  do_version = false;
+  output_file = NULL;
+  /* The compendiums are read after the options, because the input syntax
+     may be given after them.  */
+  compendium_filenames = XNMALLOC (argc, const char *);
+  ncompendiums = 0;
+  while ((optchar = getopt_long (argc, argv, "C:D:hj:n:o:PV", long_options,
+                                 NULL))
+         != EOF)
+    switch (optchar)
+      {
+      case '\0':                /* long option */
+        break;
+
+      case 'C':
+        compendium_filenames[ncompendiums++] = optarg;
+        break;
+
+      case 'D':
+        dir_list_append (optarg);
+        break;
+
+      case 'h':
+        do_help = true;
+        break;
+
+      case 'j':
+        {
+          char *endp;
+          unsigned long int value = strtoul (optarg, &endp, 10);
+
+          if (endp == optarg || *endp != '\0'
+              || value == 0 || value > UINT_MAX)
+            error (EXIT_FAILURE, 0, _("invalid number of jobs: %s"), optarg);
+          parallel_set_jobs (value);
+        }
+        break;
+
+      case 'n':
+        {
+          char *endp;
+          unsigned long int value = strtoul (optarg, &endp, 10);
+
+          if (endp == optarg || *endp != '\0'
+              || value == 0 || value > UINT_MAX)
+            error (EXIT_FAILURE, 0, _("invalid number of candidates: %s"),
+                   optarg);
+          max_candidates = value;
+        }
+        break;
+
+      case 'o':
+        output_file = optarg;
+        break;
+
+      case 'P':
+        input_syntax = &input_format_properties;
+        break;
+
+      case 'V':
+        do_version = true;
+        break;
+
+      case CHAR_MAX + 1:        /* --stringtable-input */
+        input_syntax = &input_format_stringtable;
+        break;
+
+      default:
+        usage (EXIT_FAILURE);
+        break;
+      }
+
+  /* Version information is requested.  */
+  if (do_version)
+    {
+      printf ("%s (GNU %s) %s\n", basename (program_name), PACKAGE, VERSION);
+      /* xgettext: no-wrap */
+      printf (_("Copyright (C) %s Free Software Foundation, Inc.\n\
+License GPLv3+: GNU GPL version 3 or later <http://gnu.org/licenses/gpl.html>\n\
+This is free software: you are free to change and redistribute it.\n\
+There is NO WARRANTY, to the extent permitted by law.\n\
+"),
+              "2010");
+      exit (EXIT_SUCCESS);
+    }
+
+  /* Help is requested.  */
+  if (do_help)
+    usage (EXIT_SUCCESS);
+
+  /* Test whether we have an .po file name as argument.  */
+  if (optind >= argc)
+    {
+      error (EXIT_SUCCESS, 0, _("no input file given"));
+      usage (EXIT_FAILURE);
+    }
+  if (optind + 1 != argc)
+    {
+      error (EXIT_SUCCESS, 0, _("exactly one input file required"));
+      usage (EXIT_FAILURE);
+    }
+
+  /* Suggestions can only come from a translation memory.  */
+  if (ncompendiums == 0)
+    {
+      error (EXIT_SUCCESS, 0, _("no translation memory given"));
+      usage (EXIT_FAILURE);
+    }
+
+  /* Read the translation memory.  */
+  memory = message_list_alloc (false);
+  for (i = 0; i < ncompendiums; i++)
+    compendium (compendium_filenames[i], input_syntax);
+  free (compendium_filenames);
+
+  suggest (argv[optind], output_file, input_syntax);
+  exit (EXIT_SUCCESS);
+}
+
+
+/* Display usage information and exit.  */
+static void
+usage (int status)
+{
+  if (status != EXIT_SUCCESS)
+    fprintf (stderr, _("Try `%s --help' for more information.\n"),
+             program_name);
+  else
+    {
+      printf (_("\
+Usage: %s [OPTION] --compendium=FILE... INPUTFILE\n\
+"), program_name);
+      printf ("\n");
+      /* xgettext: no-wrap */
+      printf (_("\
+Suggests translations for the untranslated and fuzzy messages of a\n\
+translation catalog.  For each such message, the most similar messages\n\
+of the translation memory are listed, together with their translation\n\
+and a similarity score between 0 and 1.\n\
+"));
+      printf ("\n");
+      printf (_("\
+Mandatory arguments to long options are mandatory for short options too.\n"));
+      printf ("\n");
+      printf (_("\
+Input file location:\n"));
+      printf (_("\
+  INPUTFILE                   input PO or POT file\n"));
+      printf (_("\
+  -C, --compendium=FILE       translation memory, a PO file with translations;\n\
+                              multiple -C options are allowed\n"));
+      printf (_("\
+  -D, --directory=DIRECTORY   add DIRECTORY to list for input files search\n"));
+      printf (_("\
+If input file is -, standard input is read.\n"));
+      printf ("\n");
+      printf (_("\
+Output file location:\n"));
+      printf (_("\
+  -o, --output-file=FILE      write output to specified file\n"));
+      printf (_("\
+The results are written to standard output if no output file is specified\n\
+or if it is -.\n"));
+      printf ("\n");
+      printf (_("\
+Operation modifiers:\n"));
+      printf (_("\
+  -n, --candidates=NUMBER     list at most NUMBER suggestions per message\n\
+                              (default: 5)\n"));
+      printf (_("\
+  -j, --jobs=NUMBER           use NUMBER threads for the fuzzy matching\n"));
+      printf ("\n");
+      printf (_("\
+Input file syntax:\n"));
+      printf (_("\
+  -P, --properties-input      input files are in Java .properties syntax\n"));
+      printf (_("\
+      --stringtable-input     input files are in NeXTstep/GNUstep .strings\n\
+                              syntax\n"));
+      printf ("\n");
+      printf (_("\
+Informative output:\n"));
+      printf (_("\
+  -h, --help                  display this help and exit\n"));
+      printf (_("\
+  -V, --version               output version information and exit\n"));
+      printf ("\n");
+      /* TRANSLATORS: The placeholder indicates the bug-reporting address
+         for this package.  Please add _another line_ saying
+         "Report translation bugs to <...>\n" with the address for translation
+         bugs (typically your translation team's web or email address).  */
+      fputs (_("Report bugs to <bug-gnu-gettext@gnu.org>.\n"), stdout);
+    }
+
+  exit (status);
+}
+
+
+/* Add the translated messages of the compendium FILENAME to the translation
+   memory.  */
+static void
+compendium (const char *filename, catalog_input_format_ty input_syntax)
+{
+  msgdomain_list_ty *mdlp;
+  size_t j, k;
+
+  /* The fuzzy index compares the messages in UTF-8.  */
+  mdlp = read_catalog_file (filename, input_syntax);
+  mdlp = iconv_msgdomain_list (mdlp, po_charset_utf8, true, filename);
+
+  for (k = 0; k < mdlp->nitems; k++)
+    {
+      message_list_ty *mlp = mdlp->item[k]->messages;
+
+      for (j = 0; j < mlp->nitems; j++)
+        {
+          message_ty *mp = mlp->item[j];
+
+          if (!is_header (mp) && !mp->obsolete && !mp->is_fuzzy
+              && mp->msgstr[0] != '\0')
+            message_list_append (memory, mp);
+        }
+    }
+}
+
+
+/* The state shared by the parallel searches of suggest.  */
+struct suggest_loop
+{
+  message_fuzzy_index_ty *findex;
+  message_ty **queries;
+  /* Room for max_candidates matches per query.  */
+  struct fuzzy_match *matches;
+  size_t *nmatches;
+};
+
+/* Search the best matches for the query number I.  */
+static void
+suggest_search (void *data, size_t i)
+{
+  struct suggest_loop *loop = (struct suggest_loop *) data;
+  message_ty *mp = loop->queries[i];
+
+  loop->nmatches[i] =
+    message_fuzzy_index_search_best (loop->findex, mp->msgctxt, mp->msgid,
+                                     FUZZY_THRESHOLD, false, max_candidates,
+                                     loop->matches + i * max_candidates);
+}
+
+
+/* Output the string S as a C string literal.  */
+static void
+print_string (const char *s, FILE *fp)
+{
+  putc ('"', fp);
+  for (; *s != '\0'; s++)
+    {
+      unsigned char c = *s;
+
+      switch (c)
+        {
+        case '"':
+          fputs ("\\\"", fp);
+          break;
+        case '\\':
+          fputs ("\\\\", fp);
+          break;
+        case '\n':
+          fputs ("\\n", fp);
+          break;
+        case '\t':
+          fputs ("\\t", fp);
+          break;
+        default:
+          if (c < 0x20 || c == 0x7f)
+            fprintf (fp, "\\%03o", c);
+          else
+            putc (c, fp);
+          break;
+        }
+    }
+  putc ('"', fp);
+}
+
+/* Output the msgctxt and msgid of MP.  */
+static void
+print_msgid (const message_ty *mp, FILE *fp)
+{
+  if (mp->msgctxt != NULL)
+    {
+      fputs ("msgctxt ", fp);
+      print_string (mp->msgctxt, fp);
+      putc (' ', fp);
+    }
+  fputs ("msgid ", fp);
+  print_string (mp->msgid, fp);
+}
+
+
+static void
+suggest (const char *filename, const char *output_file,
+         catalog_input_format_ty input_syntax)
+{
+  msgdomain_list_ty *mdlp;
+  message_ty **queries;
+  size_t nqueries;
+  size_t alloc;
+  struct suggest_loop loop;
+  FILE *fp;
+  size_t i, j, k;
+
+  mdlp = read_catalog_file (filename, input_syntax);
+  mdlp = iconv_msgdomain_list (mdlp, po_charset_utf8, true, filename);
+
+  /* Collect the messages that need a translation, in all domains.  */
+  queries = NULL;
+  nqueries = 0;
+  alloc = 0;
+  for (k = 0; k < mdlp->nitems; k++)
+    {
+      message_list_ty *mlp = mdlp->item[k]->messages;
+
+      for (j = 0; j < mlp->nitems; j++)
+        {
+          message_ty *mp = mlp->item[j];
+
+          if (!is_header (mp) && !mp->obsolete
+              && (mp->is_fuzzy || mp->msgstr[0] == '\0'))
+            {
+              if (nqueries == alloc)
+                {
+                  alloc = 2 * alloc + 10;
+                  queries = (message_ty **)
+                    xrealloc (queries, alloc * sizeof (message_ty *));
+                }
+              queries[nqueries++] = mp;
+            }
+        }
+    }
+
+  if (output_file != NULL && strcmp (output_file, "-") != 0)
+    {
+      fp = fopen (output_file, "w");
+      if (fp == NULL)
+        error (EXIT_FAILURE, errno, _("error while opening \"%s\" for writing"),
+               output_file);
+    }
+  else
+    {
+      output_file = NULL;
+      fp = stdout;
+    }
+
+  /* Search the translation memory.  The searches take most of the time;
+     they are distributed across several threads.  */
+  loop.findex = message_fuzzy_index_alloc (memory, po_charset_utf8);
+  loop.queries = queries;
+  loop.matches =
+    XNMALLOC (xtimes (nqueries, max_candidates), struct fuzzy_match);
+  loop.nmatches = XNMALLOC (nqueries, size_t);
+  parallel_for (nqueries, suggest_search, &loop);
+
+  /* Output the results, in the order of the input messages.  */
+  for (i = 0; i < nqueries; i++)
+    {
+      message_ty *mp = queries[i];
+      const struct fuzzy_match *matches = loop.matches + i * max_candidates;
+
+      fprintf (fp, "%s:%lu: ", mp->pos.file_name,
+               (unsigned long) mp->pos.line_number);
+      print_msgid (mp, fp);
+      putc ('\n', fp);
+      for (j = 0; j < loop.nmatches[i]; j++)
+        {
+          const message_ty *match = matches[j].mp;
+          /* Print the score independently of the locale.  */
+          unsigned int permille =
+            (unsigned int) (matches[j].weight * 1000 + 0.5);
+
+          fprintf (fp, "  %u.%03u %s:%lu: ", permille / 1000, permille % 1000,
+                   match->pos.file_name,
+                   (unsigned long) match->pos.line_number);
+          print_msgid (match, fp);
+          /* For a plural message, the singular form suffices as a hint.  */
+          fputs (" msgstr ", fp);
+          print_string (match->msgstr, fp);
+          putc ('\n', fp);
+        }
+    }
+
+  if (output_file != NULL && fwriteerror (fp))
+    error (EXIT_FAILURE, errno, _("error while writing \"%s\" file"),
+           output_file);
+
+  message_fuzzy_index_free (loop.findex);
+  free (loop.nmatches);
+  free (loop.matches);
+  free (queries);
+}
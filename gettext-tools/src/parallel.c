@@ -0,0 +1,219 @@
+/* Parallel execution of loops.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+/* Specification.  */
+#include "parallel.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "glthread/lock.h"
+#include "glthread/thread.h"
+#include "nproc.h"
+#include "xalloc.h"
+
+
+/* The number of threads, or 0 if not yet determined.  */
+static unsigned int jobs;
+
+void
+parallel_set_jobs (unsigned int n)
+{
+  jobs = n;
+}
+
+unsigned int
+parallel_jobs (void)
+{
+  if (jobs == 0)
+    {
+#ifdef _OPENMP
+      jobs = omp_get_max_threads ();
+#else
+      jobs = num_processors (NPROC_CURRENT);
+#endif
+      if (jobs == 0)
+        jobs = 1;
+    }
+  return jobs;
+}
+
+
+#ifndef _OPENMP
+
+/* Without OpenMP, the loop is executed by a group of worker threads, one of
+   which is the calling thread.  Each worker starts with an equal share of
+   the indices, as a range.  The cost of the loop body can vary a lot -
+   for example, a fuzzy search is quick for a short string and slow for a
+   long one -, therefore a worker that has finished its range takes the
+   upper half of the remaining range of another worker ("work stealing").
+   This keeps the workers busy until the end, while each of them mostly
+   handles consecutive indices.  */
+
+struct parallel_loop;
+
+struct worker
+{
+  /* Protects next and end.  */
+  gl_lock_define (, lock)
+  /* The indices that are left to this worker.  */
+  size_t next;
+  size_t end;
+  struct parallel_loop *loop;
+  unsigned int self;
+};
+
+struct parallel_loop
+{
+  void (*body) (void *data, size_t i);
+  void *data;
+  struct worker *workers;
+  unsigned int nworkers;
+};
+
+/* Take the next index for worker W.  Return false if no work is left.  */
+static bool
+worker_take (struct worker *w, size_t *indexp)
+{
+  struct parallel_loop *loop = w->loop;
+  unsigned int k;
+
+  gl_lock_lock (w->lock);
+  if (w->next < w->end)
+    {
+      *indexp = w->next++;
+      gl_lock_unlock (w->lock);
+      return true;
+    }
+  gl_lock_unlock (w->lock);
+
+  /* Steal the upper half of the range of another worker.  */
+  for (k = 1; k < loop->nworkers; k++)
+    {
+      struct worker *victim =
+        &loop->workers[(w->self + k) % loop->nworkers];
+      size_t start;
+      size_t end;
+
+      gl_lock_lock (victim->lock);
+      end = victim->end;
+      start = victim->next + (end - victim->next) / 2;
+      victim->end = start;
+      gl_lock_unlock (victim->lock);
+
+      if (start < end)
+        {
+          gl_lock_lock (w->lock);
+          w->next = start + 1;
+          w->end = end;
+          gl_lock_unlock (w->lock);
+          *indexp = start;
+          return true;
+        }
+    }
+
+  return false;
+}
+
+static void *
+worker_run (void *arg)
+{
+  struct worker *w = (struct worker *) arg;
+  struct parallel_loop *loop = w->loop;
+  size_t i;
+
+  while (worker_take (w, &i))
+    loop->body (loop->data, i);
+  return NULL;
+}
+
+#endif
+
+void
+parallel_for (size_t count, void (*body) (void *data, size_t i), void *data)
+{
+  unsigned int nworkers = parallel_jobs ();
+
+  if (nworkers > count)
+    nworkers = count;
+
+  if (nworkers <= 1)
+    {
+      size_t i;
+
+      for (i = 0; i < count; i++)
+        body (data, i);
+    }
+  else
+    {
+#ifdef _OPENMP
+      long int n = count;
+      long int i;
+
+      /* Note: The Sun Workshop 6.2 C compiler does not allow a space between
+         '#' and 'pragma'.  */
+      #pragma omp parallel for schedule(dynamic) num_threads(nworkers)
+      for (i = 0; i < n; i++)
+        body (data, i);
+#else
+      struct parallel_loop loop;
+      struct worker *workers = XNMALLOC (nworkers, struct worker);
+      gl_thread_t *threads = XNMALLOC (nworkers, gl_thread_t);
+      unsigned int started;
+      unsigned int k;
+
+      loop.body = body;
+      loop.data = data;
+      loop.workers = workers;
+      loop.nworkers = nworkers;
+      for (k = 0; k < nworkers; k++)
+        {
+          size_t share = count / nworkers;
+          size_t rest = count % nworkers;
+
+          gl_lock_init (workers[k].lock);
+          workers[k].next = share * k + (k < rest ? k : rest);
+          workers[k].end = workers[k].next + share + (k < rest);
+          workers[k].loop = &loop;
+          workers[k].self = k;
+        }
+
+      /* Worker 0 is the calling thread.  If a thread cannot be created,
+         its range is taken over by the other workers.  */
+      for (started = 1; started < nworkers; started++)
+        if (glthread_create (&threads[started], worker_run,
+                             &workers[started])
+            != 0)
+          break;
+      worker_run (&workers[0]);
+      for (k = 1; k < started; k++)
+        glthread_join (threads[k], NULL);
+
+      for (k = 0; k < nworkers; k++)
+        gl_lock_destroy (workers[k].lock);
+      free (threads);
+      free (workers);
+#endif
+    }
+}
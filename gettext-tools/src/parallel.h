@@ -0,0 +1,48 @@
+/* Parallel execution of loops.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef _PARALLEL_H
+#define _PARALLEL_H 1
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Set the number of threads that parallel_for uses.  0 means the default:
+   the number of available processors.  */
+extern void parallel_set_jobs (unsigned int jobs);
+
+/* Return the number of threads that parallel_for uses.  */
+extern unsigned int parallel_jobs (void);
+
+/* Call BODY (DATA, I) for every I, 0 <= I < COUNT.  The calls are
+   distributed across several threads, and happen in no particular order.
+   With OpenMP, this is an OpenMP loop; otherwise it is done through threads
+   of its own, or in the calling thread if threads are not available.  */
+extern void parallel_for (size_t count,
+                          void (*body) (void *data, size_t i), void *data);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* _PARALLEL_H */
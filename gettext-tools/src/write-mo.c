@@ -33,6 +33,14 @@
 # include <sys/param.h>
 #endif
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#ifndef MIN
+# define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
 /* These two include files describe the binary .mo format.  */
 #include "gmo.h"
 #include "hash-string.h"
@@ -73,6 +81,16 @@ bool byteswap;
 /* True if no hash table in .mo is wanted.  */
 bool no_hash_table;
 
+/* String to append after the last string of the .mo file, or NULL.  */
+const char *mo_trailer;
+
+/* True if each original string is to be placed next to its translation.  */
+bool cluster_strings;
+
+/* Keys of the messages whose strings are to be placed first, in this
+   order, or NULL.  */
+string_list_ty *hot_keys;
+
 
 /* Destructively changes the byte order of a 32-bit value in memory.  */
 #define BSWAP32(x) (x) = bswap_32 (x)
@@ -91,6 +109,7 @@ struct pre_string
 {
   size_t length;
   const char *pointer;
+  size_t offset;
 };
 
 /* An intermediate data structure representing a message.  */
@@ -99,6 +118,7 @@ struct pre_message
   struct pre_string str[2];
   const char *id_plural;
   size_t id_plural_len;
+  nls_uint32 hash;      /* hash code of str[M_ID] */
 };
 
 static int
@@ -108,6 +128,115 @@ compare_id (const void *pval1, const void *pval2)
                  ((struct pre_message *) pval2)->str[M_ID].pointer);
 }
 
+/* Minimum number of messages in a chunk that is sorted by itself.  */
+#define SORT_CHUNK_MIN 4096
+
+/* Merges the sorted runs src1[0..n1-1] and src2[0..n2-1] into dst.  */
+static void
+merge_runs (const struct pre_message *src1, size_t n1,
+            const struct pre_message *src2, size_t n2,
+            struct pre_message *dst)
+{
+  while (n1 > 0 && n2 > 0)
+    {
+      if (compare_id (src1, src2) <= 0)
+        {
+          *dst++ = *src1++;
+          n1--;
+        }
+      else
+        {
+          *dst++ = *src2++;
+          n2--;
+        }
+    }
+  if (n1 > 0)
+    memcpy (dst, src1, n1 * sizeof (struct pre_message));
+  if (n2 > 0)
+    memcpy (dst, src2, n2 * sizeof (struct pre_message));
+}
+
+/* Sorts msg_arr[0..nstrings-1] according to original string.  Since the
+   keys are unique, the result is the same as with a single qsort call.  But
+   with an OpenMP capable compiler, large tables are split into chunks that
+   are sorted in parallel and then merged, pairwise in parallel.  */
+static void
+sort_messages (struct pre_message *msg_arr, size_t nstrings)
+{
+  size_t nchunks;
+  size_t chunk_size;
+
+#ifdef _OPENMP
+  nchunks = omp_get_max_threads ();
+#else
+  nchunks = 1;
+#endif
+  if (nchunks <= 1 || nstrings < 2 * SORT_CHUNK_MIN)
+    {
+      qsort (msg_arr, nstrings, sizeof (struct pre_message), compare_id);
+      return;
+    }
+
+  chunk_size = (nstrings + nchunks - 1) / nchunks;
+  if (chunk_size < SORT_CHUNK_MIN)
+    chunk_size = SORT_CHUNK_MIN;
+  nchunks = (nstrings + chunk_size - 1) / chunk_size;
+
+  /* Sort each chunk.  */
+  {
+    long int nn = nchunks;
+    long int cc;
+
+    #ifdef _OPENMP
+     #pragma omp parallel for
+    #endif
+    for (cc = 0; cc < nn; cc++)
+      {
+        size_t start = cc * chunk_size;
+        size_t end = MIN (start + chunk_size, nstrings);
+
+        qsort (msg_arr + start, end - start, sizeof (struct pre_message),
+               compare_id);
+      }
+  }
+
+  /* Merge adjacent runs, doubling the run length in each round.  */
+  {
+    struct pre_message *tmp = XNMALLOC (nstrings, struct pre_message);
+    struct pre_message *src = msg_arr;
+    struct pre_message *dst = tmp;
+    size_t width;
+
+    for (width = chunk_size; width < nstrings; width *= 2)
+      {
+        long int nn = (nstrings + 2 * width - 1) / (2 * width);
+        long int pp;
+
+        #ifdef _OPENMP
+         #pragma omp parallel for
+        #endif
+        for (pp = 0; pp < nn; pp++)
+          {
+            size_t lo = pp * 2 * width;
+            size_t mid = MIN (lo + width, nstrings);
+            size_t hi = MIN (lo + 2 * width, nstrings);
+
+            merge_runs (src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+          }
+
+        {
+          struct pre_message *swap = src;
+          src = dst;
+          dst = swap;
+        }
+      }
+
+    if (src != msg_arr)
+      memcpy (msg_arr, src, nstrings * sizeof (struct pre_message));
+    free (tmp);
+  }
+}
+
 
 /* An intermediate data structure representing a 'struct sysdep_segment'.  */
 struct pre_sysdep_segment
@@ -140,11 +269,260 @@ struct pre_sysdep_message
   size_t id_plural_len;
 };
 
+/* With cluster_strings, a string pair that fits in a page of this size is
+   not split across two pages.  */
+#define LAYOUT_PAGE_SIZE 4096
+
+/* Determine the order in which the static string pairs msg_arr[0..nstrings-1]
+   are placed in the file.  Return NULL for the sorted order.  */
+static size_t *
+layout_order (const struct pre_message *msg_arr, size_t nstrings)
+{
+  size_t *order;
+  size_t norder;
+  bool *placed;
+  size_t j;
+
+  if (hot_keys == NULL || nstrings == 0)
+    return NULL;
+
+  order = XNMALLOC (nstrings, size_t);
+  placed = XNMALLOC (nstrings, bool);
+  memset (placed, '\0', nstrings * sizeof (bool));
+  norder = 0;
+
+  /* First the hot messages, in the order of the hot list.  msg_arr is
+     sorted already, therefore a binary search finds them.  */
+  for (j = 0; j < hot_keys->nitems; j++)
+    {
+      const char *key = hot_keys->item[j];
+      size_t lo = 0;
+      size_t hi = nstrings;
+
+      while (lo < hi)
+        {
+          size_t mid = lo + (hi - lo) / 2;
+          int cmp = strcmp (key, msg_arr[mid].str[M_ID].pointer);
+
+          if (cmp == 0)
+            {
+              if (!placed[mid])
+                {
+                  placed[mid] = true;
+                  order[norder++] = mid;
+                }
+              break;
+            }
+          if (cmp < 0)
+            hi = mid;
+          else
+            lo = mid + 1;
+        }
+    }
+
+  /* Then the other messages, in sorted order.  */
+  for (j = 0; j < nstrings; j++)
+    if (!placed[j])
+      order[norder++] = j;
+
+  free (placed);
+  return order;
+}
+
+/* Return the index into msg_arr and the kind (M_ID or M_STR) of the k-th
+   string of the string pool, 0 <= k < 2 * nstrings.  */
+static inline void
+layout_position (size_t k, size_t nstrings, const size_t *order,
+                 size_t *jp, int *mp)
+{
+  size_t i;
+
+  if (cluster_strings)
+    {
+      i = k / 2;
+      *mp = (k % 2 == 0 ? M_ID : M_STR);
+    }
+  else
+    {
+      i = k % nstrings;
+      *mp = (k < nstrings ? M_ID : M_STR);
+    }
+  *jp = (order != NULL ? order[i] : i);
+}
+
+/* Return the size of the string of the given kind of a static string pair,
+   including the terminating NUL.  */
+static inline size_t
+pre_string_size (const struct pre_message *msg, int m)
+{
+  return (m == M_ID
+          ? msg->str[M_ID].length + msg->id_plural_len
+          : msg->str[M_STR].length);
+}
+
+/* An intermediate data structure representing the result of the analysis
+   of a single message.  */
+struct pre_analysis
+{
+  /* The concatenation of msgctxt and msgid, and its length including the
+     terminating NUL.  */
+  const char *msgctid;
+  size_t msgctid_len;
+  /* The position of msgctid in the arena, if the message has a msgctxt.  */
+  size_t arena_offset;
+  /* The system dependent segments of the key and of the msgstr.  */
+  struct interval *intervals[2];
+  size_t nintervals[2];
+};
+
+/* Fills in the msgctid and msgctid_len of analysis[0..mlp->nitems-1].
+   Messages without msgctxt use their msgid directly as key.  The keys of
+   messages with msgctxt are built in a single memory block, which is
+   returned; it needs to be freed by the caller.  */
+static char *
+build_msgctids (message_list_ty *mlp, struct pre_analysis *analysis)
+{
+  size_t total;
+  char *arena;
+  size_t j;
+
+  /* Compute the lengths of the keys and their positions in the arena.  */
+  total = 0;
+  for (j = 0; j < mlp->nitems; j++)
+    {
+      message_ty *mp = mlp->item[j];
+      size_t len = strlen (mp->msgid) + 1;
+
+      if (mp->msgctxt != NULL)
+        {
+          len += strlen (mp->msgctxt) + 1;
+          analysis[j].arena_offset = total;
+          total = xsum (total, len);
+        }
+      analysis[j].msgctid_len = len;
+    }
+
+  if (total == 0)
+    {
+      for (j = 0; j < mlp->nitems; j++)
+        analysis[j].msgctid = mlp->item[j]->msgid;
+      return NULL;
+    }
+
+  arena = XNMALLOC (total, char);
+  {
+    long int nn = mlp->nitems;
+    long int jj;
+
+    #ifdef _OPENMP
+     #pragma omp parallel for
+    #endif
+    for (jj = 0; jj < nn; jj++)
+      {
+        message_ty *mp = mlp->item[jj];
+
+        if (mp->msgctxt != NULL)
+          {
+            /* Concatenate mp->msgctxt and mp->msgid into msgctid.  */
+            char *msgctid = arena + analysis[jj].arena_offset;
+            size_t msgctlen = strlen (mp->msgctxt) + 1;
+
+            memcpy (msgctid, mp->msgctxt, msgctlen - 1);
+            msgctid[msgctlen - 1] = MSGCTXT_SEPARATOR;
+            strcpy (msgctid + msgctlen, mp->msgid);
+            analysis[jj].msgctid = msgctid;
+          }
+        else
+          analysis[jj].msgctid = mp->msgid;
+      }
+  }
+
+  return arena;
+}
+
+/* Fills in the intervals and nintervals of *ap, the system dependent
+   segments of the message mp.  This function is thread-safe.  */
+static void
+analyze_sysdep_segments (message_ty *mp, struct pre_analysis *ap)
+{
+  struct interval **intervals = ap->intervals;
+  size_t *nintervals = ap->nintervals;
+
+  intervals[M_ID] = NULL;
+  nintervals[M_ID] = 0;
+  intervals[M_STR] = NULL;
+  nintervals[M_STR] = 0;
+
+  /* Test if mp contains system dependent strings and thus
+     requires the use of the .mo file minor revision 1.  */
+  if (possible_format_p (mp->is_format[format_c])
+      || possible_format_p (mp->is_format[format_objc]))
+    {
+      /* Check whether msgid or msgstr contain ISO C 99 <inttypes.h>
+         format string directives.  No need to check msgid_plural, because
+         it is not accessed by the [n]gettext() function family.  */
+      size_t msgctlen = ap->msgctid_len - (strlen (mp->msgid) + 1);
+      const char *p_end;
+      const char *p;
+
+      get_sysdep_c_format_directives (mp->msgid, false,
+                                      &intervals[M_ID], &nintervals[M_ID]);
+      if (msgctlen > 0)
+        {
+          struct interval *id_intervals = intervals[M_ID];
+          size_t id_nintervals = nintervals[M_ID];
+
+          if (id_nintervals > 0)
+            {
+              unsigned int i;
+
+              for (i = 0; i < id_nintervals; i++)
+                {
+                  id_intervals[i].startpos += msgctlen;
+                  id_intervals[i].endpos += msgctlen;
+                }
+            }
+        }
+
+      p_end = mp->msgstr + mp->msgstr_len;
+      for (p = mp->msgstr; p < p_end; p += strlen (p) + 1)
+        {
+          struct interval *part_intervals;
+          size_t part_nintervals;
+
+          get_sysdep_c_format_directives (p, true,
+                                          &part_intervals,
+                                          &part_nintervals);
+          if (part_nintervals > 0)
+            {
+              size_t d = p - mp->msgstr;
+              unsigned int i;
+
+              intervals[M_STR] =
+                (struct interval *)
+                xrealloc (intervals[M_STR],
+                          (nintervals[M_STR] + part_nintervals)
+                          * sizeof (struct interval));
+              for (i = 0; i < part_nintervals; i++)
+                {
+                  intervals[M_STR][nintervals[M_STR] + i].startpos =
+                    d + part_intervals[i].startpos;
+                  intervals[M_STR][nintervals[M_STR] + i].endpos =
+                    d + part_intervals[i].endpos;
+                }
+              nintervals[M_STR] += part_nintervals;
+              free (part_intervals);
+            }
+        }
+    }
+}
+
 /* Write the message list to the given open file.  */
 static void
 write_table (FILE *output_file, message_list_ty *mlp)
 {
-  char **msgctid_arr;
+  struct pre_analysis *analysis;
+  char *msgctid_arena;
   size_t nstrings;
   struct pre_message *msg_arr;
   size_t n_sysdep_strings;
@@ -161,15 +539,34 @@ write_table (FILE *output_file, message_list_ty *mlp)
   size_t offset;
   struct string_desc *orig_tab;
   struct string_desc *trans_tab;
+  size_t *order;
   size_t sysdep_tab_offset = 0;
   size_t end_offset;
   char *null;
+  size_t null_size;
   size_t j, m;
 
-  /* First pass: Move the static string pairs into an array, for sorting,
-     and at the same time, compute the segments of the system dependent
-     strings.  */
-  msgctid_arr = XNMALLOC (mlp->nitems, char *);
+  /* First pass: Compute the keys and the segments of the system dependent
+     strings of all messages.  This is independent for each message, and
+     therefore done in a loop that can be parallelized.  */
+  analysis = XNMALLOC (mlp->nitems, struct pre_analysis);
+  msgctid_arena = build_msgctids (mlp, analysis);
+  {
+    long int nn = mlp->nitems;
+    long int jj;
+
+    /* Tell the OpenMP capable compiler to distribute this loop across
+       several threads.  The schedule is dynamic, because only the messages
+       with a c-format or objc-format flag take a noticeable time.  */
+    #ifdef _OPENMP
+     #pragma omp parallel for schedule(dynamic, 64)
+    #endif
+    for (jj = 0; jj < nn; jj++)
+      analyze_sysdep_segments (mlp->item[jj], &analysis[jj]);
+  }
+
+  /* Move the static string pairs into an array, for sorting, and at the
+     same time, collect the system dependent strings and their segments.  */
   nstrings = 0;
   msg_arr = XNMALLOC (mlp->nitems, struct pre_message);
   n_sysdep_strings = 0;
@@ -180,87 +577,10 @@ write_table (FILE *output_file, message_list_ty *mlp)
   for (j = 0; j < mlp->nitems; j++)
     {
       message_ty *mp = mlp->item[j];
-      size_t msgctlen;
-      char *msgctid;
-      struct interval *intervals[2];
-      size_t nintervals[2];
-
-      /* Concatenate mp->msgctxt and mp->msgid into msgctid.  */
-      msgctlen = (mp->msgctxt != NULL ? strlen (mp->msgctxt) + 1 : 0);
-      msgctid = XNMALLOC (msgctlen + strlen (mp->msgid) + 1, char);
-      if (mp->msgctxt != NULL)
-        {
-          memcpy (msgctid, mp->msgctxt, msgctlen - 1);
-          msgctid[msgctlen - 1] = MSGCTXT_SEPARATOR;
-        }
-      strcpy (msgctid + msgctlen, mp->msgid);
-      msgctid_arr[j] = msgctid;
-
-      intervals[M_ID] = NULL;
-      nintervals[M_ID] = 0;
-      intervals[M_STR] = NULL;
-      nintervals[M_STR] = 0;
-
-      /* Test if mp contains system dependent strings and thus
-         requires the use of the .mo file minor revision 1.  */
-      if (possible_format_p (mp->is_format[format_c])
-          || possible_format_p (mp->is_format[format_objc]))
-        {
-          /* Check whether msgid or msgstr contain ISO C 99 <inttypes.h>
-             format string directives.  No need to check msgid_plural, because
-             it is not accessed by the [n]gettext() function family.  */
-          const char *p_end;
-          const char *p;
-
-          get_sysdep_c_format_directives (mp->msgid, false,
-                                          &intervals[M_ID], &nintervals[M_ID]);
-          if (msgctlen > 0)
-            {
-              struct interval *id_intervals = intervals[M_ID];
-              size_t id_nintervals = nintervals[M_ID];
-
-              if (id_nintervals > 0)
-                {
-                  unsigned int i;
-
-                  for (i = 0; i < id_nintervals; i++)
-                    {
-                      id_intervals[i].startpos += msgctlen;
-                      id_intervals[i].endpos += msgctlen;
-                    }
-                }
-            }
-
-          p_end = mp->msgstr + mp->msgstr_len;
-          for (p = mp->msgstr; p < p_end; p += strlen (p) + 1)
-            {
-              struct interval *part_intervals;
-              size_t part_nintervals;
-
-              get_sysdep_c_format_directives (p, true,
-                                              &part_intervals,
-                                              &part_nintervals);
-              if (part_nintervals > 0)
-                {
-                  size_t d = p - mp->msgstr;
-                  unsigned int i;
-
-                  intervals[M_STR] =
-                    (struct interval *)
-                    xrealloc (intervals[M_STR],
-                              (nintervals[M_STR] + part_nintervals)
-                              * sizeof (struct interval));
-                  for (i = 0; i < part_nintervals; i++)
-                    {
-                      intervals[M_STR][nintervals[M_STR] + i].startpos =
-                        d + part_intervals[i].startpos;
-                      intervals[M_STR][nintervals[M_STR] + i].endpos =
-                        d + part_intervals[i].endpos;
-                    }
-                  nintervals[M_STR] += part_nintervals;
-                }
-            }
-        }
+      const char *msgctid = analysis[j].msgctid;
+      size_t msgctid_len = analysis[j].msgctid_len;
+      struct interval **intervals = analysis[j].intervals;
+      size_t *nintervals = analysis[j].nintervals;
 
       if (nintervals[M_ID] > 0 || nintervals[M_STR] > 0)
         {
@@ -280,7 +600,7 @@ write_table (FILE *output_file, message_list_ty *mlp)
               if (m == M_ID)
                 {
                   str = msgctid; /* concatenation of mp->msgctxt + mp->msgid  */
-                  str_len = strlen (msgctid) + 1;
+                  str_len = msgctid_len;
                 }
               else
                 {
@@ -349,7 +669,7 @@ write_table (FILE *output_file, message_list_ty *mlp)
         {
           /* Static string pair.  */
           msg_arr[nstrings].str[M_ID].pointer = msgctid;
-          msg_arr[nstrings].str[M_ID].length = strlen (msgctid) + 1;
+          msg_arr[nstrings].str[M_ID].length = msgctid_len;
           msg_arr[nstrings].str[M_STR].pointer = mp->msgstr;
           msg_arr[nstrings].str[M_STR].length = mp->msgstr_len;
           msg_arr[nstrings].id_plural = mp->msgid_plural;
@@ -362,10 +682,26 @@ write_table (FILE *output_file, message_list_ty *mlp)
         if (intervals[m] != NULL)
           free (intervals[m]);
     }
+  free (analysis);
+
+  /* Compute the hash codes of the static keys.  They don't depend on the
+     order of the messages, therefore this is done before sorting, in a loop
+     that can be parallelized.  */
+  if (!no_hash_table || n_sysdep_strings > 0)
+    {
+      long int nn = nstrings;
+      long int jj;
+
+      #ifdef _OPENMP
+       #pragma omp parallel for
+      #endif
+      for (jj = 0; jj < nn; jj++)
+        msg_arr[jj].hash = hash_string (msg_arr[jj].str[M_ID].pointer);
+    }
 
   /* Sort the table according to original string.  */
   if (nstrings > 0)
-    qsort (msg_arr, nstrings, sizeof (struct pre_message), compare_id);
+    sort_messages (msg_arr, nstrings);
 
   /* We need major revision 1 if there are system dependent strings that use
      "I" because older versions of gettext() crash when this occurs in a .mo
@@ -500,16 +836,40 @@ write_table (FILE *output_file, message_list_ty *mlp)
     }
   fwrite (&header, header_size, 1, output_file);
 
+  /* Lay out the static strings.  By default, all original strings come
+     first, then all translated strings, each in sorted order.  */
+  order = layout_order (msg_arr, nstrings);
+  for (j = 0; j < 2 * nstrings; j++)
+    {
+      size_t k;
+      int m;
+      size_t size;
+
+      layout_position (j, nstrings, order, &k, &m);
+      size = pre_string_size (&msg_arr[k], m);
+      offset = roundup (offset, alignment);
+      if (cluster_strings && m == M_ID)
+        {
+          /* Move the pair to the next page if it would be split otherwise,
+             so that a lookup touches only one page of strings.  */
+          size_t pair_size =
+            roundup (size, alignment) + pre_string_size (&msg_arr[k], M_STR);
+
+          if (pair_size <= LAYOUT_PAGE_SIZE
+              && offset % LAYOUT_PAGE_SIZE + pair_size > LAYOUT_PAGE_SIZE)
+            offset = roundup (roundup (offset, LAYOUT_PAGE_SIZE), alignment);
+        }
+      msg_arr[k].str[m].offset = offset;
+      offset += size;
+    }
+
   /* Table for original string offsets.  */
   /* Here output_file is at position header.orig_tab_offset.  */
 
   for (j = 0; j < nstrings; j++)
     {
-      offset = roundup (offset, alignment);
-      orig_tab[j].length =
-        msg_arr[j].str[M_ID].length + msg_arr[j].id_plural_len;
-      orig_tab[j].offset = offset;
-      offset += orig_tab[j].length;
+      orig_tab[j].length = pre_string_size (&msg_arr[j], M_ID);
+      orig_tab[j].offset = msg_arr[j].str[M_ID].offset;
       /* Subtract 1 because of the terminating NUL.  */
       orig_tab[j].length--;
     }
@@ -526,10 +886,8 @@ write_table (FILE *output_file, message_list_ty *mlp)
 
   for (j = 0; j < nstrings; j++)
     {
-      offset = roundup (offset, alignment);
-      trans_tab[j].length = msg_arr[j].str[M_STR].length;
-      trans_tab[j].offset = offset;
-      offset += trans_tab[j].length;
+      trans_tab[j].length = pre_string_size (&msg_arr[j], M_STR);
+      trans_tab[j].offset = msg_arr[j].str[M_STR].offset;
       /* Subtract 1 because of the terminating NUL.  */
       trans_tab[j].length--;
     }
@@ -557,7 +915,7 @@ write_table (FILE *output_file, message_list_ty *mlp)
          above.  */
       for (j = 0; j < nstrings; j++)
         {
-          nls_uint32 hash_val = hash_string (msg_arr[j].str[M_ID].pointer);
+          nls_uint32 hash_val = msg_arr[j].hash;
           nls_uint32 idx = hash_val % hash_tab_size;
 
           if (hash_tab[idx] != 0)
@@ -698,33 +1056,31 @@ write_table (FILE *output_file, message_list_ty *mlp)
   offset = end_offset;
 
   /* A few zero bytes for padding.  */
-  null = (char *) alloca (alignment);
-  memset (null, '\0', alignment);
+  null_size = (cluster_strings ? alignment + LAYOUT_PAGE_SIZE : alignment);
+  null = (char *) alloca (null_size);
+  memset (null, '\0', null_size);
 
-  /* Now write the original strings.  */
-  for (j = 0; j < nstrings; j++)
+  /* Now write the original and translated strings, in the order of the
+     layout computed above.  */
+  for (j = 0; j < 2 * nstrings; j++)
     {
-      fwrite (null, roundup (offset, alignment) - offset, 1, output_file);
-      offset = roundup (offset, alignment);
+      size_t k;
+      int m;
+      struct pre_message *msg;
 
-      fwrite (msg_arr[j].str[M_ID].pointer, msg_arr[j].str[M_ID].length, 1,
-              output_file);
-      if (msg_arr[j].id_plural_len > 0)
-        fwrite (msg_arr[j].id_plural, msg_arr[j].id_plural_len, 1,
-                output_file);
-      offset += msg_arr[j].str[M_ID].length + msg_arr[j].id_plural_len;
-    }
+      layout_position (j, nstrings, order, &k, &m);
+      msg = &msg_arr[k];
 
-  /* Now write the translated strings.  */
-  for (j = 0; j < nstrings; j++)
-    {
-      fwrite (null, roundup (offset, alignment) - offset, 1, output_file);
-      offset = roundup (offset, alignment);
+      fwrite (null, msg->str[m].offset - offset, 1, output_file);
+      offset = msg->str[m].offset;
 
-      fwrite (msg_arr[j].str[M_STR].pointer, msg_arr[j].str[M_STR].length, 1,
-              output_file);
-      offset += msg_arr[j].str[M_STR].length;
+      fwrite (msg->str[m].pointer, msg->str[m].length, 1, output_file);
+      if (m == M_ID && msg->id_plural_len > 0)
+        fwrite (msg->id_plural, msg->id_plural_len, 1, output_file);
+      offset += pre_string_size (msg, m);
     }
+  if (order != NULL)
+    free (order);
 
   if (minor_revision >= 1)
     {
@@ -768,11 +1124,10 @@ write_table (FILE *output_file, message_list_ty *mlp)
     }
 
   freea (null);
-  for (j = 0; j < mlp->nitems; j++)
-    free (msgctid_arr[j]);
+  if (msgctid_arena != NULL)
+    free (msgctid_arena);
   free (sysdep_msg_arr);
   free (msg_arr);
-  free (msgctid_arr);
 }
 
 
@@ -805,6 +1160,8 @@ msgdomain_write_mo (message_list_ty *mlp,
       if (output_file != NULL)
         {
           write_table (output_file, mlp);
+          if (mo_trailer != NULL)
+            fwrite (mo_trailer, strlen (mo_trailer) + 1, 1, output_file);
 
           /* Make sure nothing went wrong.  */
           if (fwriteerror (output_file))
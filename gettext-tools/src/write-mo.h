@@ -22,6 +22,7 @@
 #include <stdbool.h>
 
 #include "message.h"
+#include "str-list.h"
 
 /* Alignment of strings in resulting .mo file.  */
 extern size_t alignment;
@@ -32,6 +33,20 @@ extern bool byteswap;
 /* True if no hash table in .mo is wanted.  */
 extern bool no_hash_table;
 
+/* If non-NULL, a string that is written, with its terminating NUL, after the
+   last string of the .mo file.  No table of the file refers to it, therefore
+   it is ignored by all readers.  */
+extern const char *mo_trailer;
+
+/* True if each original string is to be placed next to its translation,
+   rather than all original strings before all translations.  */
+extern bool cluster_strings;
+
+/* If non-NULL, the keys (msgctxt, MSGCTXT_SEPARATOR and msgid, or only the
+   msgid) of the messages whose strings are to be placed at the beginning of
+   the string pool, in this order.  */
+extern string_list_ty *hot_keys;
+
 /* Write a GNU mo file.  mlp is a list containing the messages to be output.
    domain_name is the domain name, file_name is the desired file name.
    Return 0 if ok, nonzero on error.  */
@@ -0,0 +1,171 @@
+/* Test the bit-parallel computation of the fuzzy similarity of two strings.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fstrcmp.h"
+#include "fstrcmp-bits.h"
+
+static int failed;
+
+/* Check that fstrcmp_bits_bounded returns the same result as
+   fstrcmp_bounded for STRING1, STRING2 and LOWER_BOUND.  Below
+   LOWER_BOUND, only the fact that the result is below matters.  */
+static void
+check (const char *string1, const char *string2, double lower_bound)
+{
+  double expected = fstrcmp_bounded (string1, string2, lower_bound);
+  double result = fstrcmp_bits_bounded (string1, string2, lower_bound);
+
+  if (!(result == expected
+        || (result < lower_bound && expected < lower_bound)))
+    {
+      fprintf (stderr, "\"%s\", \"%s\", %g: %g instead of %g\n",
+               string1, string2, lower_bound, result, expected);
+      failed = 1;
+    }
+}
+
+static void
+check_bounds (const char *string1, const char *string2)
+{
+  check (string1, string2, 0.0);
+  check (string1, string2, 0.6);
+  check (string1, string2, 0.9);
+  check (string2, string1, 0.0);
+  check (string2, string1, 0.6);
+}
+
+/* A pseudo-random number generator, so that the test is reproducible.  */
+static unsigned int seed = 1;
+
+static unsigned int
+next_random (void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+/* Fill BUF with a random string of LENGTH characters taken from ALPHABET,
+   a string of NCHARS characters of SIZE bytes each.  */
+static void
+random_string (char *buf, size_t length,
+               const char *alphabet, size_t nchars, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < length; i++)
+    memcpy (buf + i * size, alphabet + (next_random () % nchars) * size,
+            size);
+  buf[length * size] = '\0';
+}
+
+/* Copy STRING to BUF, with about one character in RATE changed.  */
+static void
+mutate_string (char *buf, const char *string, unsigned int rate)
+{
+  const char *p;
+  char *q = buf;
+
+  for (p = string; *p != '\0'; p++)
+    switch (next_random () % rate)
+      {
+      case 0:
+        /* Drop the character.  */
+        break;
+      case 1:
+        /* Insert another one.  */
+        *q++ = 'a' + next_random () % 26;
+        *q++ = *p;
+        break;
+      default:
+        *q++ = *p;
+        break;
+      }
+  *q = '\0';
+}
+
+int
+main ()
+{
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyz ";
+  /* UTF-8 encoded characters of 2 and 3 bytes.  */
+  static const char greek[] = "\316\261\316\262\316\263\316\264";
+  static const char cjk[] = "\346\226\207\344\273\266\344\277\235\345\255\230";
+  char buf1[3 * 1000 + 1];
+  char buf2[2 * (3 * 1000) + 1];
+  size_t i;
+
+  /* Empty strings.  */
+  check_bounds ("", "");
+  check_bounds ("", "a");
+  check_bounds ("", "open file");
+
+  /* Strings around the size of a word of bits.  */
+  for (i = 60; i <= 140; i++)
+    {
+      random_string (buf1, i, letters, 4, 1);
+      mutate_string (buf2, buf1, 8);
+      check_bounds (buf1, buf2);
+      random_string (buf2, i + next_random () % 10, letters, 4, 1);
+      check_bounds (buf1, buf2);
+    }
+
+  /* Multibyte characters.  */
+  for (i = 0; i < 200; i++)
+    {
+      size_t length = next_random () % 100;
+
+      random_string (buf1, length, greek, 4, 2);
+      random_string (buf2, length + next_random () % 5, greek, 4, 2);
+      check_bounds (buf1, buf2);
+      random_string (buf1, length, cjk, 4, 3);
+      random_string (buf2, length + next_random () % 5, cjk, 4, 3);
+      check_bounds (buf1, buf2);
+    }
+
+  /* Long strings, including some with so many differences that
+     fstrcmp_bits_bounded leaves them to fstrcmp_bounded.  */
+  for (i = 0; i < 20; i++)
+    {
+      random_string (buf1, 500 + next_random () % 500, letters, 27, 1);
+      mutate_string (buf2, buf1, 2 + i);
+      check_bounds (buf1, buf2);
+      random_string (buf2, 500 + next_random () % 500, letters, 27, 1);
+      check_bounds (buf1, buf2);
+    }
+
+  /* Random pairs.  */
+  for (i = 0; i < 10000; i++)
+    {
+      size_t nchars = 2 + next_random () % 25;
+
+      random_string (buf1, next_random () % 200, letters, nchars, 1);
+      if (next_random () % 2)
+        mutate_string (buf2, buf1, 2 + next_random () % 10);
+      else
+        random_string (buf2, next_random () % 200, letters, nchars, 1);
+      check (buf1, buf2, (double) (next_random () % 101) / 100);
+    }
+
+  return failed;
+}
@@ -0,0 +1,169 @@
+/* Compare the speed of fstrcmp_bits_bounded and fstrcmp_bounded.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Usage: fstrcmp-bench [-n QUERIES] [-b LOWER_BOUND] FILE.po...
+
+   Takes the msgids of the given PO files as corpus, and compares QUERIES
+   of them (default: 300) with every msgid of the corpus, with LOWER_BOUND
+   (default: 0.6) as in the fuzzy search of msgmerge, once with each
+   function.  Prints the time spent by each function and the number of
+   differing results, which must be 0.  This program is not run by
+   "make check"; build it with "make fstrcmp-bench".  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fstrcmp.h"
+#include "fstrcmp-bits.h"
+
+/* The corpus.  */
+static char **msgids;
+static size_t nmsgids;
+static size_t nmsgids_max;
+
+/* Add the msgids of the PO file FILENAME to the corpus.  Only the first
+   line of each msgid is taken, without unescaping it.  */
+static void
+read_msgids (const char *filename)
+{
+  FILE *fp = fopen (filename, "r");
+  char line[4096];
+
+  if (fp == NULL)
+    {
+      perror (filename);
+      exit (1);
+    }
+  while (fgets (line, sizeof (line), fp) != NULL)
+    if (strncmp (line, "msgid \"", 7) == 0)
+      {
+        char *start = line + 7;
+        char *end = strrchr (start, '"');
+
+        if (end == NULL || end == start)
+          continue;
+        *end = '\0';
+        if (nmsgids == nmsgids_max)
+          {
+            nmsgids_max = 2 * nmsgids_max + 1024;
+            msgids = (char **) realloc (msgids, nmsgids_max * sizeof (char *));
+            if (msgids == NULL)
+              {
+                fprintf (stderr, "memory exhausted\n");
+                exit (1);
+              }
+          }
+        msgids[nmsgids] = strdup (start);
+        if (msgids[nmsgids] == NULL)
+          {
+            fprintf (stderr, "memory exhausted\n");
+            exit (1);
+          }
+        nmsgids++;
+      }
+  fclose (fp);
+}
+
+/* Compare QUERY with every msgid, using FUNC.  Store the results in
+   RESULTS and return the time spent.  */
+static clock_t
+run (double (*func) (const char *, const char *, double),
+     const char *query, double lower_bound, double *results)
+{
+  clock_t start = clock ();
+  size_t j;
+
+  for (j = 0; j < nmsgids; j++)
+    results[j] = func (query, msgids[j], lower_bound);
+
+  return clock () - start;
+}
+
+int
+main (int argc, char *argv[])
+{
+  size_t nqueries = 300;
+  double lower_bound = 0.6;
+  double *results1;
+  double *results2;
+  clock_t time1;
+  clock_t time2;
+  size_t differences;
+  size_t q;
+  size_t j;
+  int argi;
+
+  for (argi = 1; argi + 1 < argc && argv[argi][0] == '-'; argi += 2)
+    if (strcmp (argv[argi], "-n") == 0)
+      nqueries = strtoul (argv[argi + 1], NULL, 10);
+    else if (strcmp (argv[argi], "-b") == 0)
+      lower_bound = strtod (argv[argi + 1], NULL);
+    else
+      break;
+  if (argi >= argc)
+    {
+      fprintf (stderr,
+               "Usage: %s [-n QUERIES] [-b LOWER_BOUND] FILE.po...\n",
+               argv[0]);
+      exit (1);
+    }
+
+  for (; argi < argc; argi++)
+    read_msgids (argv[argi]);
+  if (nmsgids == 0)
+    {
+      fprintf (stderr, "no msgids found\n");
+      exit (1);
+    }
+  if (nqueries == 0 || nqueries > nmsgids)
+    nqueries = nmsgids;
+
+  results1 = (double *) malloc (nmsgids * sizeof (double));
+  results2 = (double *) malloc (nmsgids * sizeof (double));
+  if (results1 == NULL || results2 == NULL)
+    {
+      fprintf (stderr, "memory exhausted\n");
+      exit (1);
+    }
+
+  /* Take the queries evenly spread over the corpus.  */
+  time1 = time2 = 0;
+  differences = 0;
+  for (q = 0; q < nqueries; q++)
+    {
+      const char *query = msgids[q * nmsgids / nqueries];
+
+      time1 += run (fstrcmp_bounded, query, lower_bound, results1);
+      time2 += run (fstrcmp_bits_bounded, query, lower_bound, results2);
+      for (j = 0; j < nmsgids; j++)
+        if (results1[j] != results2[j])
+          differences++;
+    }
+
+  printf ("%lu msgids, %lu queries, lower bound %g\n",
+          (unsigned long) nmsgids, (unsigned long) nqueries, lower_bound);
+  printf ("fstrcmp_bounded:      %.2f s\n", (double) time1 / CLOCKS_PER_SEC);
+  printf ("fstrcmp_bits_bounded: %.2f s\n", (double) time2 / CLOCKS_PER_SEC);
+  printf ("differences:          %lu\n", (unsigned long) differences);
+
+  return differences != 0;
+}
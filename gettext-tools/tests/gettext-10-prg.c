@@ -0,0 +1,113 @@
+/* Test the preload_textdomains function.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#if !((defined _WIN32 || defined __WIN32__) && !defined __CYGWIN__)
+# include <unistd.h>
+#endif
+#include "xsetenv.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+static void
+report (const struct textdomain_preload_report *info, void *data)
+{
+  int *failed = (int *) data;
+
+  printf ("%s %s: %s\n", info->domainname, info->locale,
+          info->filename != NULL ? "found" : "not found");
+  if (info->filename != NULL && info->nmessages == 0)
+    *failed = 1;
+}
+
+/* Preload with the locales of ARGV, in a program that behaves like a SGID
+   program.  Entries with a directory separator must be skipped.  */
+static int
+test_secure (char *argv[], int *failed)
+{
+  static const char *domains[] = { "tstpreload", NULL };
+  const char *locales[2];
+
+#if !((defined _WIN32 || defined __WIN32__) && !defined __CYGWIN__)
+  /* Only root can change its effective group ID at will.  */
+  if (getuid () != 0 || setegid (getgid () + 1) < 0)
+    return 77;
+#else
+  return 77;
+#endif
+
+  locales[0] = argv[2];
+  locales[1] = NULL;
+  printf ("%d\n",
+          preload_textdomains (domains, locales, LC_MESSAGES, 0,
+                               report, failed));
+
+  /* The locales of LANGUAGE.  */
+  printf ("%d\n",
+          preload_textdomains (domains, NULL, LC_MESSAGES, 0,
+                               report, failed));
+
+  return *failed;
+}
+
+int
+main (int argc, char *argv[])
+{
+  static const char *domains[] = { "tstpreload", NULL };
+  static const char *locales[] = { "de", "fr", "C", NULL };
+  int failed = 0;
+
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("tstpreload", ".");
+
+  if (argc > 2)
+    return test_secure (argv, &failed);
+
+  /* Explicit list of locales.  "C" is skipped.  */
+  printf ("%d\n",
+          preload_textdomains (domains, locales, LC_MESSAGES,
+                               PRELOAD_TEXTDOMAINS_POPULATE
+                               | PRELOAD_TEXTDOMAINS_CONVERT,
+                               report, &failed));
+
+  /* The locales of the current LC_MESSAGES locale.  */
+  printf ("%d\n",
+          preload_textdomains (domains, NULL, LC_MESSAGES,
+                               PRELOAD_TEXTDOMAINS_CONVERT,
+                               report, &failed));
+
+  printf ("%s\n", dgettext ("tstpreload", "Open"));
+  printf ("%s\n", dgettext ("tstpreload", "Close"));
+
+  return failed;
+}
@@ -0,0 +1,76 @@
+/* Test the reload_textdomains function.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include "xsetenv.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+int
+main (int argc, char *argv[])
+{
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("tstreload", ".");
+  bindtextdomain ("tstreload2", ".");
+  bindtextdomain ("tstreload3", "gt-11-dir");
+
+  printf ("%s\n", dgettext ("tstreload", "Open"));
+  printf (dngettext ("tstreload", "%d file", "%d files", 3), 3);
+  printf ("\n");
+  printf ("%s\n", dgettext ("tstreload2", "Close"));
+  printf ("%s\n", dgettext ("tstreload3", "Close"));
+
+  /* Nothing has changed yet.  */
+  printf ("%d\n", reload_textdomains ());
+
+  /* Install the new catalogs the way package managers do.  */
+  if (rename ("fr/LC_MESSAGES/tstreload.new",
+              "fr/LC_MESSAGES/tstreload.mo") != 0
+      || rename ("fr/LC_MESSAGES/tstreload2.new",
+                 "fr/LC_MESSAGES/tstreload2.mo") != 0
+      /* This also creates the locale directory of tstreload3.  */
+      || rename ("gt-11-new/fr", "gt-11-dir/fr") != 0)
+    return 1;
+
+  printf ("%d\n", reload_textdomains ());
+
+  printf ("%s\n", dgettext ("tstreload", "Open"));
+  printf (dngettext ("tstreload", "%d file", "%d files", 3), 3);
+  printf ("\n");
+  printf ("%s\n", dgettext ("tstreload2", "Close"));
+  printf ("%s\n", dgettext ("tstreload3", "Close"));
+
+  printf ("%d\n", reload_textdomains ());
+
+  return 0;
+}
@@ -0,0 +1,64 @@
+/* Test the lookup statistics.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include "xsetenv.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+int
+main (int argc, char *argv[])
+{
+  int i;
+
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("tststats", ".");
+
+  /* One lookup in the catalog, then two from the cache.  */
+  for (i = 0; i < 3; i++)
+    printf ("%s\n", dgettext ("tststats", "Open"));
+
+  /* Write the statistics so far to another file.  */
+  if (dump_textdomain_statistics (argv[2]) != 0)
+    return 1;
+
+  printf ("%s\n", dgettext ("tststats", "menu\004Open"));
+  for (i = 0; i < 2; i++)
+    printf ("%s\n", dgettext ("tststats", "Unknown"));
+  printf (dngettext ("tststats", "%d file", "%d files", 3), 3);
+  printf ("\n");
+
+  /* The statistics are written to the file given by GETTEXT_STATISTICS at
+     exit.  */
+  return 0;
+}
@@ -0,0 +1,128 @@
+/* Test the dcgettext_hashed and dcngettext_hashed functions.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include "xsetenv.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+/* The hash code of STR, as computed by libintl_msgid_hash in
+   <libintl-hash.h>.  */
+static unsigned long int
+msgid_hash (const char *str)
+{
+  unsigned long int hval = 0;
+
+  while (*str != '\0')
+    {
+      unsigned long int g;
+
+      hval = (hval << 4) + (unsigned char) *str++;
+      g = hval & ((unsigned long int) 0xf << 28);
+      if (g != 0)
+        {
+          hval ^= g >> 24;
+          hval ^= g;
+        }
+    }
+  return hval;
+}
+
+static int failed;
+
+/* Look up MSGID with and without its hash code, and print the result.  */
+static void
+test_gettext (const char *msgid)
+{
+  const char *hashed =
+    dcgettext_hashed ("tsthash", msgid, msgid_hash (msgid), LC_MESSAGES);
+  const char *plain = dcgettext ("tsthash", msgid, LC_MESSAGES);
+
+  if (strcmp (hashed, plain) != 0)
+    {
+      fprintf (stderr, "dcgettext_hashed: \"%s\" != \"%s\"\n", hashed, plain);
+      failed = 1;
+    }
+  /* This one is answered from the table of known translations.  */
+  if (strcmp (dcgettext_hashed ("tsthash", msgid, msgid_hash (msgid),
+                                LC_MESSAGES),
+              plain) != 0)
+    {
+      fprintf (stderr, "dcgettext_hashed: \"%s\" not found again\n", msgid);
+      failed = 1;
+    }
+  printf ("%s\n", hashed);
+}
+
+/* Likewise for MSGID, MSGID_PLURAL and N.  */
+static void
+test_ngettext (const char *msgid, const char *msgid_plural,
+               unsigned long int n)
+{
+  const char *hashed =
+    dcngettext_hashed ("tsthash", msgid, msgid_hash (msgid), msgid_plural, n,
+                       LC_MESSAGES);
+  const char *plain =
+    dcngettext ("tsthash", msgid, msgid_plural, n, LC_MESSAGES);
+
+  if (strcmp (hashed, plain) != 0)
+    {
+      fprintf (stderr, "dcngettext_hashed: \"%s\" != \"%s\"\n", hashed, plain);
+      failed = 1;
+    }
+  printf (hashed, (int) n);
+  printf ("\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("tsthash", ".");
+
+  test_gettext ("Open");
+  test_gettext ("menu\004Open");
+  test_gettext ("Close");
+  /* Not in the catalog.  */
+  test_gettext ("Unknown");
+
+  test_ngettext ("%d file", "%d files", 1);
+  test_ngettext ("%d file", "%d files", 2);
+  test_ngettext ("dialog\004%d item selected", "%d items selected", 0);
+  test_ngettext ("dialog\004%d item selected", "%d items selected", 5);
+  /* Not in the catalog.  */
+  test_ngettext ("%d folder", "%d folders", 1);
+  test_ngettext ("%d folder", "%d folders", 2);
+
+  return failed;
+}
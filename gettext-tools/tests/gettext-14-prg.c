@@ -0,0 +1,61 @@
+/* Test that catalogs are not looked for in missing locale directories.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include "xsetenv.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+int
+main (int argc, char *argv[])
+{
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("tstindex1", "gt-14-dir");
+  bindtextdomain ("tstindex2", "gt-14-dir");
+
+  /* This reads the entries of gt-14-dir, which has no locale directory.  */
+  printf ("%s\n", dgettext ("tstindex1", "Open"));
+
+  if (rename ("gt-14-new/fr", "gt-14-dir/fr") != 0)
+    return 1;
+
+  /* The catalog is not looked for, because the entries of gt-14-dir are
+     not read again until textdomain or bindtextdomain is called.  */
+  printf ("%s\n", dgettext ("tstindex2", "Open"));
+
+  /* Now they are.  */
+  bindtextdomain ("tstindex3", "gt-14-dir");
+  printf ("%s\n", dgettext ("tstindex3", "Open"));
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/* Test the dcgettext_batch function.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include "xsetenv.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+static const struct gettext_batch_item items[] =
+{
+  { NULL, "Open", NULL, 0 },
+  { "menu", "Open", NULL, 0 },
+  { "toolbar", "Open", NULL, 0 },
+  { NULL, "Close", NULL, 0 },
+  { NULL, "Quit", NULL, 0 },
+  { NULL, "%d file", "%d files", 1 },
+  { NULL, "%d file", "%d files", 5 },
+  { "dialog", "%d item selected", "%d items selected", 0 },
+  { "dialog", "%d item selected", "%d items selected", 2 },
+  { NULL, "%d item selected", "%d items selected", 2 },
+  { NULL, "%d folder", "%d folders", 1 },
+  { NULL, "%d folder", "%d folders", 3 }
+};
+#define NITEMS (sizeof (items) / sizeof (items[0]))
+
+/* Look up ITEM through dcgettext or dcngettext, like pgettext and
+   npgettext from "gettext.h" do.  */
+static const char *
+lookup (const struct gettext_batch_item *item)
+{
+  const char *msgid = item->msgid;
+  const char *translation;
+  char buf[100];
+
+  if (item->msgctxt != NULL)
+    {
+      sprintf (buf, "%s\004%s", item->msgctxt, item->msgid);
+      msgid = buf;
+    }
+  if (item->msgid_plural != NULL)
+    translation = dcngettext ("tstbatch", msgid, item->msgid_plural, item->n,
+                              LC_MESSAGES);
+  else
+    translation = dcgettext ("tstbatch", msgid, LC_MESSAGES);
+  if (translation == msgid)
+    translation = item->msgid;
+  return translation;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *translations[NITEMS];
+  int pass;
+  size_t i;
+
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("tstbatch", ".");
+
+  /* In the first pass, the catalog is loaded by dcgettext_batch.  In the
+     second pass, the translations come from the cache.  */
+  for (pass = 0; pass < 2; pass++)
+    {
+      dcgettext_batch ("tstbatch", items, NITEMS, translations, LC_MESSAGES);
+      for (i = 0; i < NITEMS; i++)
+        {
+          const char *expected = lookup (&items[i]);
+
+          if (strcmp (translations[i], expected) != 0)
+            {
+              fprintf (stderr, "item %u: got \"%s\", expected \"%s\"\n",
+                       (unsigned int) i, translations[i], expected);
+              return 1;
+            }
+          if (pass == 0)
+            printf ("%s\n", translations[i]);
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+/* Test the compiled evaluation of plural expressions.
+   Copyright (C) 2010 Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Usage: plural-3-prg LOCALE FORMULA
+
+   Compares, for many values of n, the value of the plural expression
+   FORMULA computed by plural_eval, by plural_eval_program on its compiled
+   form, and by the included libintl on the message catalog "plural", which
+   must have been compiled with FORMULA and msgstr[i] = "i".  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <locale.h>
+#include "xsetenv.h"
+
+#include "plural-exp.h"
+
+/* Make sure we use the included libintl, not the system's one. */
+#undef _LIBINTL_H
+#include "libgnuintl.h"
+
+/* Disable the override of setlocale that libgnuintl.h activates on MacOS X
+   and Windows.  This test relies on the fake setlocale function in
+   setlocale.c.  */
+#undef setlocale
+
+/* Values of n beyond 0..1000.  */
+static const unsigned long int boundary_values[] =
+{
+  9999, 10000, 10001, 99999, 100000, 1000000,
+  2147483646UL, 2147483647UL, 2147483648UL, 2147483649UL,
+  4294967294UL, 4294967295UL,
+#if ULONG_MAX > 4294967295UL
+  4294967296UL, 4294967297UL,
+#endif
+  ULONG_MAX - 10, ULONG_MAX - 1, ULONG_MAX
+};
+
+static int failed;
+
+static void
+check (const struct expression *plural,
+       const struct plural_program *program,
+       unsigned long int nplurals, unsigned long int n)
+{
+  unsigned long int expected = plural_eval (plural, n);
+  unsigned long int compiled = plural_eval_program (program, n);
+  const char *translation =
+    dcngettext ("plural", "X", "Y", n, LC_MESSAGES);
+  /* libintl takes form 0 for an index out of range.  */
+  unsigned long int index = (expected < nplurals ? expected : 0);
+
+  if (compiled != expected)
+    {
+      fprintf (stderr, "n = %lu: plural_eval_program returned %lu, "
+               "plural_eval %lu\n", n, compiled, expected);
+      failed = 1;
+    }
+  if (!(translation[0] == '0' + index && translation[1] == '\0'))
+    {
+      fprintf (stderr, "n = %lu: libintl returned \"%s\", plural_eval %lu\n",
+               n, translation, expected);
+      failed = 1;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *formula = argv[2];
+  char *header;
+  const struct expression *plural;
+  unsigned long int nplurals;
+  struct plural_program *program;
+  unsigned long int n;
+  size_t i;
+
+  xsetenv ("LC_ALL", argv[1], 1);
+  if (setlocale (LC_ALL, "") == NULL)
+    return 1;
+
+  bindtextdomain ("plural", ".");
+
+  header = (char *) malloc (strlen (formula) + 100);
+  if (header == NULL)
+    return 1;
+  sprintf (header, "Plural-Forms: nplurals=10; plural=%s;\n", formula);
+  extract_plural_expression (header, &plural, &nplurals);
+  if (nplurals != 10)
+    {
+      fprintf (stderr, "invalid formula: %s\n", formula);
+      return 1;
+    }
+
+  program = compile_plural_expression (plural);
+  if (program == NULL)
+    {
+      fprintf (stderr, "formula not compiled: %s\n", formula);
+      return 1;
+    }
+
+  for (n = 0; n <= 1000; n++)
+    check (plural, program, nplurals, n);
+  for (i = 0; i < sizeof (boundary_values) / sizeof (boundary_values[0]); i++)
+    check (plural, program, nplurals, boundary_values[i]);
+
+  return failed;
+}